@@ -0,0 +1,232 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AnalysisCache.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AnalysisCache.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+struct Header {
+  char magic[8];
+  std::uint64_t key;
+  std::uint64_t number_of_frames;
+  std::uint64_t number_of_keys;
+};
+
+const char magic[8] = {'O', 'V', 'E', 'R', 'K', 'E', 'Y', '1'};
+
+/**
+ * Keyboards of a cache entry that is mapped into memory.
+ */
+class CachedKeyboard : public KeyboardSource {
+public:
+  explicit CachedKeyboard(std::unique_ptr<MappedFile> file)
+      : file(std::move(file)) {
+    std::memcpy(&header, this->file->get_data(), sizeof(Header));
+    keyboard = std::make_shared<Vector>(header.number_of_keys);
+    read_frame();
+  }
+
+  std::shared_ptr<Vector> get_keyboard() const override { return keyboard; }
+
+  bool go_to_next_frame() override {
+    if (frame + 1 >= header.number_of_frames) {
+      return false;
+    }
+    ++frame;
+    read_frame();
+    return true;
+  }
+
+private:
+  std::unique_ptr<MappedFile> file;
+  Header header{};
+  std::uint64_t frame{};
+  std::shared_ptr<Vector> keyboard;
+
+  void read_frame() {
+    std::size_t size = header.number_of_keys * sizeof(double);
+    std::memcpy(keyboard->data(),
+                file->get_data() + sizeof(Header) + frame * size, size);
+    file->release(sizeof(Header) + frame * size);
+  }
+};
+
+/**
+ * Passes on the keyboards of another keyboard source and writes them into a
+ * temporary file, which gets renamed to the entry after the last keyboard.
+ */
+class RecordingKeyboard : public KeyboardSource {
+public:
+  RecordingKeyboard(std::shared_ptr<KeyboardSource> source, std::string path,
+                    std::uint64_t key)
+      : source(std::move(source)), path(std::move(path)),
+        temporary_path(this->path + ".tmp" + std::to_string(getpid())) {
+    file = std::fopen(temporary_path.c_str(), "wb");
+    if (file == nullptr) {
+      throw std::runtime_error("Couldn't create the cache file: " +
+                               temporary_path);
+    }
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.key = key;
+    header.number_of_keys = this->source->get_keyboard()->size();
+    write(&header, sizeof(Header));
+    write_frame();
+  }
+
+  RecordingKeyboard(const RecordingKeyboard &) = delete;
+  RecordingKeyboard &operator=(const RecordingKeyboard &) = delete;
+
+  ~RecordingKeyboard() override {
+    if (file != nullptr) {
+      std::fclose(file);
+      std::remove(temporary_path.c_str());
+    }
+  }
+
+  std::shared_ptr<Vector> get_keyboard() const override {
+    return source->get_keyboard();
+  }
+
+  bool go_to_next_frame() override {
+    if (!source->go_to_next_frame()) {
+      finish();
+      return false;
+    }
+    write_frame();
+    return true;
+  }
+
+private:
+  std::shared_ptr<KeyboardSource> source;
+  std::string path;
+  std::string temporary_path;
+  std::FILE *file;
+  Header header{};
+
+  void write(const void *data, std::size_t size) {
+    if (file != nullptr && std::fwrite(data, 1, size, file) != size) {
+      throw std::runtime_error("Couldn't write the cache file: " +
+                               temporary_path);
+    }
+  }
+
+  void write_frame() {
+    const Vector &keyboard = *source->get_keyboard();
+    if (keyboard.size() != header.number_of_keys) {
+      throw std::runtime_error("The number of keys has changed.");
+    }
+    write(keyboard.data(), keyboard.size() * sizeof(double));
+    ++header.number_of_frames;
+  }
+
+  void finish() {
+    if (file == nullptr) {
+      return;
+    }
+    bool failed = std::fseek(file, 0, SEEK_SET) != 0 ||
+                  std::fwrite(&header, sizeof(Header), 1, file) != 1;
+    failed = std::fclose(file) != 0 || failed;
+    file = nullptr;
+    if (failed || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+      std::remove(temporary_path.c_str());
+      throw std::runtime_error("Couldn't write the cache file: " + path);
+    }
+  }
+};
+} // namespace
+
+AnalysisCache::AnalysisCache(std::string directory,
+                             const std::string &input_file_path,
+                             const std::string &parameters)
+    : directory(std::move(directory)) {
+  MappedFile input_file(input_file_path);
+  // The input file is hashed in blocks, whose pages are released afterwards.
+  const std::size_t block_size = 1 << 22;
+  key = fnv_offset_basis;
+  for (std::size_t offset = 0; offset < input_file.get_size();
+       offset += block_size) {
+    std::size_t size = std::min(block_size, input_file.get_size() - offset);
+    key = hash(input_file.get_data() + offset, size, key);
+    input_file.release(offset + size);
+  }
+  std::string versioned_parameters =
+      parameters + ", cache version " + std::to_string(version);
+  key = hash(reinterpret_cast<const unsigned char *>(
+                 versioned_parameters.data()),
+             versioned_parameters.size(), key);
+}
+
+std::string AnalysisCache::get_path() const {
+  std::stringstream path;
+  path << directory << "/" << std::hex << std::setw(16) << std::setfill('0')
+       << key << ".keyboard";
+  return path.str();
+}
+
+std::shared_ptr<KeyboardSource>
+AnalysisCache::load(std::uint64_t *number_of_frames) const {
+  std::unique_ptr<MappedFile> file;
+  try {
+    file = std::make_unique<MappedFile>(get_path());
+  } catch (const std::runtime_error &) {
+    return nullptr;
+  }
+  if (file->get_size() < sizeof(Header)) {
+    return nullptr;
+  }
+  Header header{};
+  std::memcpy(&header, file->get_data(), sizeof(Header));
+  std::uint64_t size =
+      header.number_of_frames * header.number_of_keys * sizeof(double);
+  if (std::memcmp(header.magic, magic, sizeof(magic)) || header.key != key ||
+      header.number_of_frames == 0 || header.number_of_keys == 0 ||
+      file->get_size() != sizeof(Header) + size) {
+    return nullptr;
+  }
+  if (number_of_frames != nullptr) {
+    *number_of_frames = header.number_of_frames;
+  }
+  return std::make_shared<CachedKeyboard>(std::move(file));
+}
+
+std::shared_ptr<KeyboardSource>
+AnalysisCache::record(std::shared_ptr<KeyboardSource> keyboard) const {
+  return std::make_shared<RecordingKeyboard>(std::move(keyboard), get_path(),
+                                             key);
+}
+
+std::uint64_t AnalysisCache::hash(const unsigned char *data, std::size_t size,
+                                  std::uint64_t hash) {
+  for (std::size_t index = 0; index != size; ++index) {
+    hash ^= data[index];
+    hash *= fnv_prime;
+  }
+  return hash;
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AnalysisCache.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_ANALYSISCACHE_H
+#define OVERTONE_ANALYSISCACHE_H
+
+#include "KeyboardSource.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * On-disk cache of the keyboards of all video frames.
+ *
+ * An entry is keyed by a hash of the input file and of a description of the
+ * analysis parameters (frame rate, channels, band plan, ...) and of the
+ * version of the cache, so parameters that only affect the rendering (gain,
+ * gate, theme, history speed) reuse the entry. An entry is a binary file
+ * that can be mapped into memory: a header followed by number_of_frames *
+ * number_of_keys doubles in the byte order of the machine.
+ */
+class AnalysisCache {
+public:
+  // FNV-1a parameters
+  static constexpr std::uint64_t fnv_offset_basis = 14695981039346656037ull;
+  static constexpr std::uint64_t fnv_prime = 1099511628211ull;
+
+  // Version of the analysis and of the layout of the entries. It has to be
+  // incremented whenever a change of the code changes the keyboards of an
+  // analysis or the layout of an entry, so the old entries aren't used.
+  static constexpr unsigned version = 1;
+
+  /**
+   * Evaluates the key of the entry from the input file, the parameters, and
+   * the version.
+   * @param directory directory of the cache entries (has to exist)
+   * @param input_file_path path of the input file
+   * @param parameters description of the analysis parameters
+   */
+  AnalysisCache(std::string directory, const std::string &input_file_path,
+                const std::string &parameters);
+
+  std::uint64_t get_key() const { return key; }
+
+  /**
+   * @return path of the file of the entry
+   */
+  std::string get_path() const;
+
+  /**
+   * Maps the entry into memory.
+   * @param number_of_frames if not nullptr, receives the number of video
+   *                         frames of the entry
+   * @return keyboards of the entry, or nullptr if there's no valid entry
+   */
+  std::shared_ptr<KeyboardSource>
+  load(std::uint64_t *number_of_frames = nullptr) const;
+
+  /**
+   * Wraps a keyboard source, which writes each keyboard into the entry. The
+   * entry becomes visible when the last video frame has been reached.
+   * @param keyboard keyboard source at its first video frame
+   * @return keyboard source that provides the same keyboards
+   */
+  std::shared_ptr<KeyboardSource>
+  record(std::shared_ptr<KeyboardSource> keyboard) const;
+
+  /**
+   * 64-bit FNV-1a hash.
+   * @param data first byte
+   * @param size number of bytes
+   * @param hash hash of the previous bytes
+   * @return hash including the bytes
+   */
+  static std::uint64_t hash(const unsigned char *data, std::size_t size,
+                            std::uint64_t hash = fnv_offset_basis);
+
+private:
+  std::string directory;
+  std::uint64_t key;
+};
+
+#endif // OVERTONE_ANALYSISCACHE_H
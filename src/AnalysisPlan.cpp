@@ -0,0 +1,137 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AnalysisPlan.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AnalysisPlan.h"
+#include "KeyboardFrequencies.h"
+#include "SpectrumKernels.h"
+#include <algorithm>
+#include <cmath>
+
+AnalysisPlan::AnalysisPlan(KeyRange key_range, VectorSize number_of_samples,
+                           VectorSize sample_rate, Frequencies frequencies,
+                           bool dft_basis)
+    : number_of_samples(number_of_samples) {
+  // bin indices (non-integer for key-centered frequencies)
+  Vector bins;
+  if (frequencies == Frequencies::uniform) {
+    Vector all_frequencies =
+        evaluate_all_frequencies(number_of_samples, sample_rate);
+    frequency_range = KeyboardFrequencies::key_range_to_frequency_range(
+        key_range, all_frequencies);
+    auto all_frequencies_begin = all_frequencies.cbegin();
+    keys = KeyboardFrequencies::frequencies_to_keys(
+        Vector(all_frequencies_begin + frequency_range.first,
+               all_frequencies_begin + frequency_range.second));
+
+    bins.reserve(keys.size());
+    for (VectorSize frequency_index = frequency_range.first;
+         frequency_index != frequency_range.second; ++frequency_index) {
+      bins.push_back(frequency_index);
+    }
+  } else {
+    // Like the bins of the DFT, the frequencies end below the Nyquist
+    // frequency, since the frequencies above would alias.
+    frequency_range = {0, 0};
+    for (unsigned key = key_range.first; key != key_range.second; ++key) {
+      unsigned number_of_nodes =
+          evaluate_number_of_nodes(key, number_of_samples, sample_rate);
+      for (unsigned node = 0; node != number_of_nodes; ++node) {
+        double offset = (node + 0.5) / number_of_nodes - 0.5;
+        double bin = KeyboardFrequencies::key_to_frequency(key + offset) *
+                     number_of_samples / sample_rate;
+        if (2 * bin < number_of_samples) {
+          keys.push_back(key + offset);
+          bins.push_back(bin);
+        }
+      }
+    }
+  }
+  goertzel_coefficients =
+      SpectrumKernels::evaluate_goertzel_coefficients(bins, number_of_samples);
+  if (dft_basis) {
+    this->dft_basis =
+        SpectrumKernels::evaluate_dft_basis(bins, number_of_samples);
+  }
+
+  // Bins that don't belong to any key keep the weight 0.
+  bin_keys.assign(keys.size(), key_range.first);
+  bin_weights.assign(keys.size(), 0.);
+  VectorSize bin = 0;
+  for (unsigned char assigned_key = key_range.first;
+       assigned_key != key_range.second; ++assigned_key) {
+    VectorSize first_bin = bin;
+    double weight_accumulator = 0.0;
+    while (bin != keys.size() && assigned_key - 0.5 <= keys[bin] &&
+           keys[bin] < assigned_key + 0.5) {
+      bin_keys[bin] = assigned_key;
+      bin_weights[bin] = evaluate_weight(keys[bin], assigned_key);
+      weight_accumulator += bin_weights[bin];
+      ++bin;
+    }
+    for (VectorSize index = first_bin; index != bin; ++index) {
+      bin_weights[index] /= weight_accumulator;
+    }
+  }
+}
+
+void AnalysisPlan::project(const double *spectrum, double *keyboard) const {
+  for (VectorSize bin = 0; bin != bin_weights.size(); ++bin) {
+    keyboard[bin_keys[bin]] += bin_weights[bin] * spectrum[bin];
+  }
+}
+
+unsigned AnalysisPlan::evaluate_number_of_nodes(unsigned key,
+                                                VectorSize number_of_samples,
+                                                VectorSize sample_rate) {
+  // The spacing of the nodes in Hz grows within the key, its maximum is the
+  // derivative of the frequency at the upper end of the key,
+  // f ln(2) / 12 per key, divided by the number of nodes.
+  double maximum_spacing = KeyboardFrequencies::key_to_frequency(key + 0.5) *
+                           std::log(2.) / 12. * number_of_samples /
+                           sample_rate;
+  return std::max(minimum_nodes_per_key,
+                  static_cast<unsigned>(std::ceil(maximum_spacing)));
+}
+
+AnalysisPlan::Vector
+AnalysisPlan::evaluate_all_frequencies(VectorSize number_of_samples,
+                                       VectorSize sample_rate) {
+  Vector frequencies;
+  frequencies.reserve(number_of_samples / 2);
+  double frequency_step_size = 1. * sample_rate / number_of_samples;
+  for (VectorSize frequency_index = 0; frequency_index != number_of_samples / 2;
+       ++frequency_index) {
+    frequencies.push_back(frequency_index * frequency_step_size);
+  }
+  return frequencies;
+}
+
+double AnalysisPlan::evaluate_weight(const double &key,
+                                     const unsigned char &assigned_key) {
+  // The upwards shift by 0.01 is necessary to avoid divisions by zero.
+  if (key < assigned_key) {
+    return 2. * key + 1. - 2. * assigned_key + 0.01;
+  } else {
+    return -2. * key + 1. + 2. * assigned_key + 0.01;
+  }
+}
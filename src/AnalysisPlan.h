@@ -0,0 +1,160 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AnalysisPlan.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_ANALYSISPLAN_H
+#define OVERTONE_ANALYSISPLAN_H
+
+#include <utility>
+#include <vector>
+
+/**
+ * Everything about the analysis of a key range that only depends on the number
+ * of samples per audio frame: the evaluated bins, their positions on the
+ * keyboard, and the weights with which they get projected onto the keys.
+ * A plan is immutable, so it's evaluated once and shared by all the video
+ * frames whose audio frames have the same number of samples.
+ */
+class AnalysisPlan {
+public:
+  using Vector = std::vector<double>;
+  using VectorSize = Vector::size_type;
+  using VectorRange = std::pair<VectorSize, VectorSize>;
+  using KeyRange = std::pair<unsigned char, unsigned char>;
+
+  /**
+   * Frequencies at which the spectrum gets evaluated.
+   *   - uniform: all bins k sample_rate / N of the DFT within the key range,
+   *              whose number per key grows with N and with the key
+   *   - key_centered: nodes that are evenly spaced within each key, at
+   *                   least minimum_nodes_per_key per key and not sparser
+   *                   than the bins (see evaluate_number_of_nodes()), so
+   *                   each key of a low key range gets evaluated even if no
+   *                   bin falls into it
+   */
+  enum class Frequencies { uniform, key_centered };
+
+  // minimum number of key-centered frequencies per key
+  static constexpr unsigned minimum_nodes_per_key = 3;
+
+  /**
+   * @param key_range key range
+   * @param number_of_samples number of samples per audio frame
+   * @param sample_rate audio sample rate
+   * @param frequencies frequencies at which the spectrum gets evaluated
+   * @param dft_basis true if the basis of the batched DFT should be evaluated
+   */
+  AnalysisPlan(KeyRange key_range, VectorSize number_of_samples,
+               VectorSize sample_rate,
+               Frequencies frequencies = Frequencies::uniform,
+               bool dft_basis = false);
+
+  /**
+   * @return number of samples per audio frame
+   */
+  VectorSize get_number_of_samples() const { return number_of_samples; }
+
+  /**
+   * @return index range of the bins within the key range (empty for
+   *         key-centered frequencies)
+   */
+  const VectorRange &get_frequency_range() const { return frequency_range; }
+
+  /**
+   * @return positions of the evaluated frequencies on the keyboard, e.g.,
+   *         440 Hz would be at 48.0
+   */
+  const Vector &get_keys() const { return keys; }
+
+  /**
+   * @return Goertzel coefficients of the evaluated frequencies
+   */
+  const Vector &get_goertzel_coefficients() const {
+    return goertzel_coefficients;
+  }
+
+  /**
+   * @return basis of the batched DFT of the bins (see
+   *         SpectrumKernels::evaluate_dft_basis()), empty unless requested
+   *         by the constructor
+   */
+  const Vector &get_dft_basis() const { return dft_basis; }
+
+  /**
+   * Projects a spectrum onto the keyboard, i.e., adds the weighted average of
+   * the bins that belong to a key to the key.
+   * @param spectrum spectrum at the evaluated frequencies
+   * @param keyboard 88 keys of the keyboard
+   */
+  void project(const double *spectrum, double *keyboard) const;
+
+  /**
+   * Returns the number of key-centered frequencies of a key. The nodes sit at
+   * key - 0.5 + (n + 0.5) / number_of_nodes for n = 0, 1, ..., and there
+   * are enough of them that their spacing doesn't exceed the bin width
+   * sample_rate / N anywhere within the key, so a tone between two nodes
+   * doesn't fall into the nulls of both.
+   * @param key key
+   * @param number_of_samples number of samples N per audio frame
+   * @param sample_rate audio sample rate
+   * @return number of nodes (>= minimum_nodes_per_key)
+   */
+  static unsigned evaluate_number_of_nodes(unsigned key,
+                                           VectorSize number_of_samples,
+                                           VectorSize sample_rate);
+
+private:
+  VectorSize number_of_samples;
+  VectorRange frequency_range;
+  Vector keys;
+  Vector goertzel_coefficients;
+  Vector dft_basis;
+
+  // Sparse projection matrix: the bin `index` contributes with the weight
+  // bin_weights[index] to the key bin_keys[index].
+  std::vector<unsigned char> bin_keys;
+  Vector bin_weights;
+
+  /**
+   * Evaluates all the frequencies of the Fourier transform.
+   * @param number_of_samples number of samples per audio frame
+   * @param sample_rate audio sample rate
+   * @return all frequencies of the Fourier transform
+   */
+  static Vector evaluate_all_frequencies(VectorSize number_of_samples,
+                                         VectorSize sample_rate);
+
+  /**
+   * The projection evaluates the weighted average of all the bins that belong
+   * to a certain key on the keyboard. This function determines the weight of
+   * such a bin.
+   * @param key position of a certain frequency on the keyboard, e.g., 440 Hz
+   *            would be at 48.0
+   * @param assigned_key index of the key on the keyboard to which the signal
+   *                     belongs, i.e., an integer from 0 to 87
+   * @return weight
+   */
+  static double evaluate_weight(const double &key,
+                                const unsigned char &assigned_key);
+};
+
+#endif // OVERTONE_ANALYSISPLAN_H
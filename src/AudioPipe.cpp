@@ -0,0 +1,265 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AudioPipe.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AudioPipe.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+AudioPipe::AudioPipe(const std::string &command)
+    : pipe(popen(command.c_str(), "r")) {
+  if (!pipe) {
+    throw std::runtime_error("The audio pipe couldn't be opened.");
+  }
+  parse_headers();
+  channel_samples.resize(number_of_channels);
+}
+
+AudioPipe::~AudioPipe() = default;
+
+void AudioPipe::read_bytes(void *destination, std::size_t size) {
+  if (std::fread(destination, 1, size, pipe.get()) != size) {
+    throw std::runtime_error(
+        "The audio pipe ended within the headers of the WAVE stream.");
+  }
+}
+
+std::uint32_t AudioPipe::read_uint32() {
+  unsigned char bytes[4];
+  read_bytes(bytes, 4);
+  return bytes[0] | bytes[1] << 8 | bytes[2] << 16 |
+         static_cast<std::uint32_t>(bytes[3]) << 24;
+}
+
+std::uint16_t AudioPipe::read_uint16() {
+  unsigned char bytes[2];
+  read_bytes(bytes, 2);
+  return bytes[0] | bytes[1] << 8;
+}
+
+void AudioPipe::skip_bytes(std::size_t size) {
+  char buffer[256];
+  while (size != 0) {
+    std::size_t skipped = std::min(size, sizeof(buffer));
+    read_bytes(buffer, skipped);
+    size -= skipped;
+  }
+}
+
+void AudioPipe::parse_headers() {
+  char id[4];
+  read_bytes(id, 4);
+  read_uint32();
+  char format[4];
+  read_bytes(format, 4);
+  if (std::memcmp(id, "RIFF", 4) || std::memcmp(format, "WAVE", 4)) {
+    throw std::runtime_error("The audio pipe doesn't contain a WAVE stream.");
+  }
+
+  bool format_parsed = false;
+  std::uint32_t chunk_size;
+  while (true) {
+    read_bytes(id, 4);
+    chunk_size = read_uint32();
+    if (!std::memcmp(id, "data", 4)) {
+      break;
+    }
+    // Chunks are padded to an even number of bytes.
+    std::size_t padded_size = chunk_size + (chunk_size & 1);
+    if (std::memcmp(id, "fmt ", 4)) {
+      skip_bytes(padded_size);
+      continue;
+    }
+    if (chunk_size < 16) {
+      throw std::runtime_error("The format chunk is too small.");
+    }
+    std::uint16_t audio_format = read_uint16();
+    number_of_channels = read_uint16();
+    sample_rate = read_uint32();
+    read_uint32(); // byte rate
+    read_uint16(); // block align
+    std::uint16_t bits_per_sample = read_uint16();
+    std::size_t parsed_bytes = 16;
+    if (audio_format == 0xFFFE && chunk_size >= 26) {
+      // WAVE_FORMAT_EXTENSIBLE: the format is the first field of the
+      // subformat GUID.
+      skip_bytes(8);
+      audio_format = read_uint16();
+      parsed_bytes = 26;
+    }
+    skip_bytes(padded_size - parsed_bytes);
+    if (audio_format != 3 || bits_per_sample != 32) {
+      throw std::runtime_error(
+          "The WAVE stream doesn't contain 32 bit float samples.");
+    }
+    if (number_of_channels == 0 || sample_rate == 0) {
+      throw std::runtime_error("The WAVE stream doesn't contain any channel.");
+    }
+    format_parsed = true;
+  }
+  if (!format_parsed) {
+    throw std::runtime_error("The WAVE stream doesn't have a format chunk.");
+  }
+
+  // A stream doesn't know its length in advance, so FFmpeg writes 0 or
+  // 0xFFFFFFFF as the size of its data chunk, and the samples are read until
+  // the end of the pipe.
+  if (chunk_size == 0 || chunk_size == 0xFFFFFFFF) {
+    remaining_frames = std::numeric_limits<std::uint64_t>::max();
+  } else {
+    remaining_frames = chunk_size / (4 * number_of_channels);
+  }
+}
+
+void AudioPipe::read_until(VectorSize end) const {
+  const std::size_t frame_size = 4 * number_of_channels;
+  while (get_end() < end && remaining_frames != 0) {
+    std::size_t number_of_frames = static_cast<std::size_t>(
+        std::min<std::uint64_t>(block_size, remaining_frames));
+    std::size_t old_size = samples.size();
+    samples.resize(old_size + number_of_frames * number_of_channels);
+    std::size_t number_of_bytes =
+        std::fread(samples.data() + old_size, 1,
+                   number_of_frames * frame_size, pipe.get());
+    std::size_t read_frames = number_of_bytes / frame_size;
+    samples.resize(old_size + read_frames * number_of_channels);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (std::size_t index = old_size; index != samples.size(); ++index) {
+      std::uint32_t bits;
+      std::memcpy(&bits, &samples[index], 4);
+      bits = __builtin_bswap32(bits);
+      std::memcpy(&samples[index], &bits, 4);
+    }
+#endif
+    bool unknown_size =
+        remaining_frames == std::numeric_limits<std::uint64_t>::max();
+    if (read_frames == number_of_frames) {
+      if (!unknown_size) {
+        remaining_frames -= read_frames;
+      }
+      continue;
+    }
+
+    // end of the stream
+    remaining_frames = 0;
+    int status = pclose(pipe.release());
+    if (status != 0) {
+      throw std::runtime_error("The process of the audio pipe failed (status " +
+                               std::to_string(status) + ").");
+    }
+    if (number_of_bytes % frame_size != 0) {
+      throw std::runtime_error("The audio pipe ended within a sample frame.");
+    }
+    if (!unknown_size) {
+      throw std::runtime_error(
+          "The audio pipe ended before the end of the data chunk.");
+    }
+  }
+}
+
+AudioPipe::VectorSize AudioPipe::get_number_of_samples() const {
+  read_until(std::numeric_limits<VectorSize>::max());
+  return get_end();
+}
+
+AudioPipe::VectorSize AudioPipe::count_samples(VectorSize limit) {
+  read_until(limit);
+  return std::min(limit, get_end());
+}
+
+void AudioPipe::check_range(const VectorRange &time_range) {
+  if (time_range.first < first_sample) {
+    throw std::out_of_range("The sample " + std::to_string(time_range.first) +
+                            " has already been released from the audio "
+                            "pipe.");
+  }
+  read_until(time_range.second);
+  if (time_range.second > get_end()) {
+    throw std::out_of_range("The samples aren't available.");
+  }
+}
+
+void AudioPipe::copy_samples(VectorSize channel, const VectorRange &time_range,
+                             double *destination) const {
+  const float *source =
+      samples.data() + (time_range.first - first_sample) * number_of_channels +
+      channel;
+  for (VectorSize index = 0; index != time_range.second - time_range.first;
+       ++index) {
+    destination[index] = source[index * number_of_channels];
+  }
+}
+
+const double *AudioPipe::get_samples(VectorSize channel,
+                                     const VectorRange &time_range) {
+  check_range(time_range);
+  Vector &destination = channel_samples.at(channel);
+  destination.resize(time_range.second - time_range.first);
+  copy_samples(channel, time_range, destination.data());
+  return destination.data();
+}
+
+void AudioPipe::read(const VectorRange &time_range,
+                     double *const *destinations) {
+  check_range(time_range);
+  for (VectorSize channel = 0; channel != number_of_channels; ++channel) {
+    if (destinations[channel] != nullptr) {
+      copy_samples(channel, time_range, destinations[channel]);
+    }
+  }
+  // Reads move forward, so the samples in front of the range aren't needed
+  // anymore. They get erased once they make up half of the buffer, which
+  // keeps the moved samples proportional to the read ones.
+  VectorSize released = time_range.first - first_sample;
+  if (2 * released * number_of_channels >= samples.size()) {
+    samples.erase(samples.begin(),
+                  samples.begin() + released * number_of_channels);
+    first_sample = time_range.first;
+  }
+}
+
+std::vector<std::shared_ptr<AudioPipe::Vector>> AudioPipe::read_all() {
+  std::vector<std::shared_ptr<Vector>> signal;
+  std::vector<double *> destinations(number_of_channels);
+  for (VectorSize channel = 0; channel != number_of_channels; ++channel) {
+    signal.push_back(std::make_shared<Vector>());
+  }
+  // The samples get converted block by block while the process decodes the
+  // following ones.
+  const VectorSize start = first_sample;
+  VectorSize first = start;
+  while (true) {
+    VectorSize end = count_samples(first + 16 * block_size);
+    for (VectorSize channel = 0; channel != number_of_channels; ++channel) {
+      signal[channel]->resize(end - start);
+      destinations[channel] = signal[channel]->data() + (first - start);
+    }
+    read({first, end}, destinations.data());
+    if (end != first + 16 * block_size) {
+      return signal;
+    }
+    first = end;
+  }
+}
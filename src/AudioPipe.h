@@ -0,0 +1,163 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AudioPipe.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_AUDIOPIPE_H
+#define OVERTONE_AUDIOPIPE_H
+
+#include "AudioSource.h"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+/**
+ * Reads a PCM signal from the standard output of a process, e.g., an FFmpeg
+ * process that decodes the input file into a WAVE stream with 32 bit float
+ * samples (pcm_f32le).
+ *
+ * The process keeps decoding while the signal is analysed. The samples are
+ * read from the pipe on demand, so the analysis of the beginning of the
+ * signal can start before the process has decoded the rest of it. The length
+ * of the stream is unknown until the process has finished, which is why
+ * count_samples() only reads up to its limit, whereas get_number_of_samples()
+ * reads the whole stream. The samples in front of a read() get released, so
+ * a forward-moving reader (e.g., an AudioStream) needs a bounded amount of
+ * memory.
+ *
+ * A stream that ends within a sample frame or before the end of a data chunk
+ * of known size, or whose process fails, throws std::runtime_error when its
+ * end is read, so a failed decoder doesn't result in a truncated signal.
+ */
+class AudioPipe : public AudioSource {
+public:
+  /**
+   * Starts the process and parses the headers of its WAVE stream.
+   * @param command shell command that writes a WAVE stream of 32 bit float
+   *                samples into its standard output
+   */
+  explicit AudioPipe(const std::string &command);
+
+  AudioPipe(const AudioPipe &) = delete;
+  AudioPipe &operator=(const AudioPipe &) = delete;
+
+  /**
+   * Closes the pipe and waits for the process.
+   */
+  ~AudioPipe() override;
+
+  unsigned get_sample_rate() const override { return sample_rate; }
+
+  VectorSize get_number_of_channels() const override {
+    return number_of_channels;
+  }
+
+  /**
+   * Reads the rest of the stream.
+   * @return number of samples per channel
+   */
+  VectorSize get_number_of_samples() const override;
+
+  VectorSize count_samples(VectorSize limit) override;
+
+  /**
+   * Throws std::out_of_range if samples of the range have already been
+   * released or don't exist.
+   */
+  const double *get_samples(VectorSize channel,
+                            const VectorRange &time_range) override;
+
+  /**
+   * Copies the samples. The samples in front of the range aren't needed
+   * anymore and may get released. Throws std::out_of_range if samples of the
+   * range have already been released or don't exist.
+   */
+  void read(const VectorRange &time_range,
+            double *const *destinations) override;
+
+  /**
+   * Reads the rest of the stream.
+   * @return the samples of each channel after the released ones
+   */
+  std::vector<std::shared_ptr<Vector>> read_all();
+
+private:
+  // number of sample frames that get read from the pipe at once
+  static constexpr std::size_t block_size = 4096;
+
+  struct PipeCloser {
+    void operator()(FILE *pipe) const { pclose(pipe); }
+  };
+
+  unsigned sample_rate{};
+  VectorSize number_of_channels{};
+
+  // The stream gets read lazily, also by the const getters.
+
+  // pipe, which gets closed at the end of the stream
+  mutable std::unique_ptr<FILE, PipeCloser> pipe;
+
+  // interleaved samples that have been read and not released yet
+  mutable std::vector<float> samples;
+
+  // time index of the first sample in `samples`
+  mutable VectorSize first_sample{};
+
+  // number of sample frames that the data chunk may still contain
+  mutable std::uint64_t remaining_frames{};
+
+  // working buffers of get_samples()
+  std::vector<Vector> channel_samples;
+
+  void read_bytes(void *destination, std::size_t size);
+  std::uint32_t read_uint32();
+  std::uint16_t read_uint16();
+  void skip_bytes(std::size_t size);
+  void parse_headers();
+
+  /**
+   * @return time index after the last sample that has been read
+   */
+  VectorSize get_end() const {
+    return first_sample + samples.size() / number_of_channels;
+  }
+
+  /**
+   * Reads the samples up to `end`, or up to the end of the stream.
+   * Throws std::runtime_error if the stream is truncated or if the process
+   * has failed.
+   */
+  void read_until(VectorSize end) const;
+
+  /**
+   * Reads up to `end` and throws if the range isn't available.
+   */
+  void check_range(const VectorRange &time_range);
+
+  /**
+   * Converts the samples of a channel within a time index range.
+   */
+  void copy_samples(VectorSize channel, const VectorRange &time_range,
+                    double *destination) const;
+};
+
+#endif // OVERTONE_AUDIOPIPE_H
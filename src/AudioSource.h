@@ -0,0 +1,95 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AudioSource.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_AUDIOSOURCE_H
+#define OVERTONE_AUDIOSOURCE_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * Interface of the objects that provide the PCM signal for the analysis,
+ * e.g., a decoded WAVE file, an AudioPipe, or an AudioStream.
+ */
+class AudioSource {
+public:
+  using Vector = std::vector<double>;
+  using VectorSize = Vector::size_type;
+  using VectorRange = std::pair<VectorSize, VectorSize>;
+
+  virtual ~AudioSource() = default;
+
+  /**
+   * @return sample rate
+   */
+  virtual unsigned get_sample_rate() const = 0;
+
+  /**
+   * @return number of channels
+   */
+  virtual VectorSize get_number_of_channels() const = 0;
+
+  /**
+   * @return number of samples per channel
+   */
+  virtual VectorSize get_number_of_samples() const = 0;
+
+  /**
+   * Counts the samples up to a limit. Unlike get_number_of_samples(), a
+   * source that is still being decoded only waits until `limit` samples are
+   * available instead of until its end.
+   * @param limit maximum number of counted samples
+   * @return min(limit, number of samples per channel)
+   */
+  virtual VectorSize count_samples(VectorSize limit) {
+    return std::min(limit, get_number_of_samples());
+  }
+
+  /**
+   * Returns the samples of a channel within a time index range. The pointer
+   * stays valid until the next call of get_samples() or read().
+   * @param channel index of the channel
+   * @param time_range time index range
+   * @return pointer to the sample time_range.first
+   */
+  virtual const double *get_samples(VectorSize channel,
+                                    const VectorRange &time_range) = 0;
+
+  /**
+   * Copies the samples of all channels within a time index range.
+   * @param time_range time index range
+   * @param destinations destination of each channel
+   */
+  virtual void read(const VectorRange &time_range,
+                    double *const *destinations) {
+    for (VectorSize channel = 0; channel != get_number_of_channels();
+         ++channel) {
+      const double *samples = get_samples(channel, time_range);
+      std::copy(samples, samples + (time_range.second - time_range.first),
+                destinations[channel]);
+    }
+  }
+};
+
+#endif // OVERTONE_AUDIOSOURCE_H
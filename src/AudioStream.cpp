@@ -0,0 +1,87 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AudioStream.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AudioStream.h"
+#include <stdexcept>
+#include <string>
+
+AudioStream::AudioStream(std::shared_ptr<AudioSource> upstream,
+                         VectorSize capacity)
+    : upstream(std::move(upstream)), capacity(capacity), buffered_range(0, 0) {
+  if (capacity == 0) {
+    throw std::invalid_argument("The capacity of an audio stream is zero.");
+  }
+  buffers.assign(this->upstream->get_number_of_channels(),
+                 Vector(2 * capacity));
+  destinations.resize(buffers.size());
+}
+
+const double *AudioStream::get_samples(VectorSize channel,
+                                       const VectorRange &time_range) {
+  if (count_samples(time_range.second) != time_range.second ||
+      time_range.second - time_range.first > capacity) {
+    throw std::out_of_range(
+        "The audio stream can't buffer the samples " +
+        std::to_string(time_range.first) + " to " +
+        std::to_string(time_range.second) + ".");
+  }
+  if (time_range.second > buffered_range.second) {
+    fill(time_range.first, time_range.second);
+  }
+  if (time_range.first < buffered_range.first) {
+    throw std::out_of_range("The sample " + std::to_string(time_range.first) +
+                            " has already been evicted from the audio "
+                            "stream.");
+  }
+  return buffers.at(channel).data() + time_range.first % capacity;
+}
+
+void AudioStream::fill(VectorSize first, VectorSize end) {
+  // The samples between the buffered ones and `first` are skipped if they
+  // aren't needed.
+  VectorSize time_index = buffered_range.second;
+  if (first > time_index) {
+    time_index = first;
+    buffered_range.first = first;
+  }
+  while (time_index != end) {
+    VectorSize position = time_index % capacity;
+    VectorSize number_of_samples =
+        std::min(end - time_index, capacity - position);
+    for (VectorSize channel = 0; channel != buffers.size(); ++channel) {
+      destinations[channel] = buffers[channel].data() + position;
+    }
+    upstream->read({time_index, time_index + number_of_samples},
+                   destinations.data());
+    for (Vector &buffer : buffers) {
+      std::copy(buffer.begin() + position,
+                buffer.begin() + position + number_of_samples,
+                buffer.begin() + position + capacity);
+    }
+    time_index += number_of_samples;
+  }
+  buffered_range.second = end;
+  if (end - buffered_range.first > capacity) {
+    buffered_range.first = end - capacity;
+  }
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    AudioStream.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_AUDIOSTREAM_H
+#define OVERTONE_AUDIOSTREAM_H
+
+#include "AudioSource.h"
+#include <memory>
+
+/**
+ * Bounded-memory view of another audio source for analyses that move forward
+ * through the signal.
+ *
+ * The stream keeps at most `capacity` samples of each channel in a mirrored
+ * ring buffer, which stores the sample t at the positions t % capacity and
+ * t % capacity + capacity, so any range of up to `capacity` samples is
+ * contiguous. Requesting samples beyond the buffered ones reads them from the
+ * upstream source and evicts the oldest ones. The memory, therefore, doesn't
+ * depend on the length of the signal, but evicted samples can't be requested
+ * anymore, and a stream can't be shared by analyses that move independently
+ * of each other.
+ */
+class AudioStream : public AudioSource {
+public:
+  /**
+   * @param upstream source from which the samples get read
+   * @param capacity maximum number of buffered samples per channel
+   */
+  AudioStream(std::shared_ptr<AudioSource> upstream, VectorSize capacity);
+
+  unsigned get_sample_rate() const override {
+    return upstream->get_sample_rate();
+  }
+
+  VectorSize get_number_of_channels() const override {
+    return upstream->get_number_of_channels();
+  }
+
+  VectorSize get_number_of_samples() const override {
+    return upstream->get_number_of_samples();
+  }
+
+  VectorSize count_samples(VectorSize limit) override {
+    return upstream->count_samples(limit);
+  }
+
+  /**
+   * Returns buffered samples, and reads them from the upstream source if
+   * necessary. Throws std::out_of_range if the range exceeds the capacity or
+   * if samples of the range have already been evicted.
+   * @param channel index of the channel
+   * @param time_range time index range
+   * @return pointer to the sample time_range.first
+   */
+  const double *get_samples(VectorSize channel,
+                            const VectorRange &time_range) override;
+
+  /**
+   * @return maximum number of buffered samples per channel
+   */
+  VectorSize get_capacity() const { return capacity; }
+
+private:
+  std::shared_ptr<AudioSource> upstream;
+  VectorSize capacity;
+
+  // mirrored ring buffer of each channel (2 * capacity samples)
+  std::vector<Vector> buffers;
+
+  // time index range of the buffered samples
+  VectorRange buffered_range;
+
+  // destinations of the upstream reads
+  std::vector<double *> destinations;
+
+  /**
+   * Reads the samples up to `end` from the upstream source.
+   * @param first first sample that has to be buffered afterwards
+   * @param end time index after the last sample that has to be buffered
+   */
+  void fill(VectorSize first, VectorSize end);
+};
+
+#endif // OVERTONE_AUDIOSTREAM_H
@@ -30,10 +30,13 @@
 #include <stdexcept>
 #include <vector>
 
-ColorMap::ColorMap() : gain(1.), gate(0.) { initialize_themes(); }
+ColorMap::ColorMap() : gain(1.), gate(0.), scale(0.), edge_color() {
+  initialize_themes();
+}
 
 ColorMap::ColorMap(std::string theme, double gain, double gate)
-    : gain(gain), gate(gate), theme(std::move(theme)) {
+    : gain(gain), gate(gate), theme(std::move(theme)), scale(0.),
+      edge_color() {
   if (gain < 0) {
     throw std::out_of_range("The argument `gain` is negative.");
   }
@@ -58,6 +61,7 @@ ColorMap::ColorMap(std::string theme, double gain, double gate)
     throw std::invalid_argument(message.str());
   }
   determine_limits();
+  evaluate_table();
 }
 
 bool ColorMap::check_if_theme_exists(const std::string &theme_name) {
@@ -110,12 +114,24 @@ std::vector<std::string> ColorMap::get_theme_names() {
   return theme_names;
 }
 
-std::vector<unsigned char> ColorMap::operator()(double input_value) {
-  return evaluate_color(input_value);
+void ColorMap::evaluate_colors(const std::vector<double> &input_values,
+                               std::vector<Color> &colors) const {
+  colors.resize(input_values.size());
+  for (std::size_t index = 0; index != input_values.size(); ++index) {
+    colors[index] = (*this)(input_values[index]);
+  }
 }
 
-std::vector<unsigned char> ColorMap::get_edge_color() {
-  return edge_colors[theme];
+void ColorMap::evaluate_table() {
+  table.clear();
+  table.reserve(number_of_entries);
+  for (std::size_t index = 0; index != number_of_entries; ++index) {
+    table.push_back(
+        evaluate_color(static_cast<double>(index) / (number_of_entries - 1)));
+  }
+  scale = gain * (number_of_entries - 1);
+  const auto &edge = edge_colors[theme];
+  std::copy_n(edge.cbegin(), 3, edge_color.begin());
 }
 
 void ColorMap::determine_limits() {
@@ -129,16 +145,14 @@ void ColorMap::determine_limits() {
   }
 }
 
-std::vector<unsigned char> ColorMap::evaluate_color(double input_value) {
-  input_value *= gain;
-
+ColorMap::Color ColorMap::evaluate_color(double input_value) {
+  const auto &color_map = color_maps[theme];
+  Color color{};
   if (input_value <= gate) {
-    return color_maps[theme].front();
+    std::copy_n(color_map.front().cbegin(), 3, color.begin());
   } else if (input_value >= limits.back()) {
-    return color_maps[theme].back();
+    std::copy_n(color_map.back().cbegin(), 3, color.begin());
   } else {
-    std::vector<unsigned char> color;
-    const auto &color_map = color_maps[theme];
     for (size_t index = 0; index != (limits.size() - 1); ++index) {
       double lower_limit = limits[index];
       double upper_limit = limits[index + 1];
@@ -150,13 +164,13 @@ std::vector<unsigned char> ColorMap::evaluate_color(double input_value) {
           std::vector<double> upper_point{upper_limit, upper_value};
           double value = LinearInterpolation::interpolate(
               lower_point, upper_point, input_value);
-          color.push_back(value);
+          color[rgb_index] = static_cast<unsigned char>(value);
         }
-        continue;
+        break;
       }
     }
-    return color;
   }
+  return color;
 }
 
 std::vector<std::vector<unsigned char>>
@@ -23,12 +23,27 @@
 
 #ifndef OVERTONE_COLORMAP_H
 #define OVERTONE_COLORMAP_H
+#include <array>
+#include <cstddef>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+/**
+ * Maps the values of the keys to the colors of a theme.
+ *
+ * The constructor bakes the theme, the gain, and the gate into a table of
+ * `number_of_entries` colors, which are evenly spaced between the values
+ * 0 and 1 after the gain has been applied. A value is mapped to the color
+ * of the nearest entry.
+ */
 class ColorMap {
 public:
+  using Color = std::array<unsigned char, 3>;
+
+  // number of colors of the lookup table
+  static constexpr std::size_t number_of_entries = 4096;
+
   /**
    * This constructor exists to be able to get the theme names without being
    * forced to specify a certain theme, e.g.,  ColorMap ().get_theme_names ().
@@ -47,12 +62,30 @@ public:
    * @param input_value
    * @return color = { red, green, blue }
    */
-  std::vector<unsigned char> operator()(double input_value);
+  Color operator()(double input_value) const {
+    double position = input_value * scale;
+    // negative values and NaN
+    if (!(position > 0.)) {
+      return table.front();
+    }
+    if (position >= number_of_entries - 1) {
+      return table.back();
+    }
+    return table[static_cast<std::size_t>(position + 0.5)];
+  }
+
+  /**
+   * Converts the values of all keys to RGB colors.
+   * @param input_values values of the keys
+   * @param colors colors of the keys (resized to the number of keys)
+   */
+  void evaluate_colors(const std::vector<double> &input_values,
+                       std::vector<Color> &colors) const;
 
   /**
    * @return edge color = { red, green, blue }
    */
-  std::vector<unsigned char> get_edge_color();
+  Color get_edge_color() const { return edge_color; }
 
   /**
    * @return names of all available themes
@@ -72,6 +105,14 @@ private:
   // (darkest color = 0., brightest color = 1.)
   std::vector<double> limits;
 
+  // colors of the values index / (number_of_entries - 1)
+  std::vector<Color> table;
+
+  // converts an input value to a position in the table
+  double scale;
+
+  Color edge_color;
+
   std::unordered_map<std::string, std::vector<std::vector<unsigned char>>>
       color_maps;
 
@@ -89,12 +130,14 @@ private:
   convert_color_map(const std::vector<std::string> &string_color_map);
 
   /**
-   * @param input_value
+   * @param input_value value of a key multiplied by the gain
    * @return RGB values { red, green, blue}
    */
-  std::vector<unsigned char> evaluate_color(double input_value);
+  Color evaluate_color(double input_value);
 
   void determine_limits();
+
+  void evaluate_table();
 };
 
 #endif // OVERTONE_COLORMAP_H
@@ -0,0 +1,171 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    FFT.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "FFT.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+FFT::FFT(VectorSize size) : size(size), packed(size % 2 == 0 && size > 2) {
+  if (size == 0) {
+    throw std::invalid_argument("The length of the FFT has to be nonzero.");
+  }
+  half_size = packed ? size / 2 : size;
+  complex_transform = ComplexTransform(half_size);
+  buffer.resize(half_size);
+  if (packed) {
+    unpacking_twiddles.reserve(half_size + 1);
+    for (VectorSize index = 0; index != half_size + 1; ++index) {
+      unpacking_twiddles.push_back(
+          std::polar(1., -2. * M_PI * static_cast<double>(index) / size));
+    }
+  }
+}
+
+void FFT::transform(const double *input, ComplexVector &output) {
+  output.resize(size / 2 + 1);
+  if (!packed) {
+    for (VectorSize index = 0; index != size; ++index) {
+      buffer[index] = Complex(input[index], 0.);
+    }
+    complex_transform.transform(buffer);
+    for (VectorSize index = 0; index != output.size(); ++index) {
+      output[index] = buffer[index];
+    }
+    return;
+  }
+
+  // z_n = x_2n + i x_2n+1
+  for (VectorSize index = 0; index != half_size; ++index) {
+    buffer[index] = Complex(input[2 * index], input[2 * index + 1]);
+  }
+  complex_transform.transform(buffer);
+
+  // X_k = E_k + exp(-2 pi i k / N) O_k, where E and O are the transforms of
+  // the even and the odd samples respectively.
+  const Complex half_i(0., 0.5);
+  for (VectorSize index = 0; index != half_size + 1; ++index) {
+    Complex current = buffer[index % half_size];
+    Complex mirrored = std::conj(buffer[(half_size - index) % half_size]);
+    Complex even = 0.5 * (current + mirrored);
+    Complex odd = -half_i * (current - mirrored);
+    output[index] = even + unpacking_twiddles[index] * odd;
+  }
+}
+
+FFT::ComplexTransform::ComplexTransform(VectorSize size) : size(size) {
+  radix_2_size = 1;
+  while (radix_2_size < size) {
+    radix_2_size *= 2;
+  }
+  bool bluestein = radix_2_size != size;
+  if (bluestein) {
+    while (radix_2_size < 2 * size - 1) {
+      radix_2_size *= 2;
+    }
+  }
+
+  bit_reversal.resize(radix_2_size);
+  VectorSize number_of_bits = 0;
+  while ((VectorSize(1) << number_of_bits) < radix_2_size) {
+    ++number_of_bits;
+  }
+  for (VectorSize index = 0; index != radix_2_size; ++index) {
+    VectorSize reversed = 0;
+    for (VectorSize bit = 0; bit != number_of_bits; ++bit) {
+      reversed |= ((index >> bit) & 1) << (number_of_bits - 1 - bit);
+    }
+    bit_reversal[index] = reversed;
+  }
+
+  twiddles.reserve(radix_2_size / 2);
+  for (VectorSize index = 0; index != radix_2_size / 2; ++index) {
+    twiddles.push_back(std::polar(
+        1., -2. * M_PI * static_cast<double>(index) / radix_2_size));
+  }
+
+  if (bluestein) {
+    // The phase pi n^2 / size is evaluated modulo 2 pi to keep it accurate.
+    chirp.reserve(size);
+    for (VectorSize index = 0; index != size; ++index) {
+      unsigned long long square =
+          (static_cast<unsigned long long>(index) * index) % (2 * size);
+      chirp.push_back(
+          std::polar(1., -M_PI * static_cast<double>(square) / size));
+    }
+    chirp_transform.assign(radix_2_size, Complex());
+    chirp_transform[0] = std::conj(chirp[0]);
+    for (VectorSize index = 1; index != size; ++index) {
+      chirp_transform[index] = std::conj(chirp[index]);
+      chirp_transform[radix_2_size - index] = std::conj(chirp[index]);
+    }
+    radix_2_transform(chirp_transform, false);
+    buffer.resize(radix_2_size);
+  }
+}
+
+void FFT::ComplexTransform::transform(ComplexVector &data) {
+  if (chirp.empty()) {
+    radix_2_transform(data, false);
+    return;
+  }
+  for (VectorSize index = 0; index != size; ++index) {
+    buffer[index] = data[index] * chirp[index];
+  }
+  std::fill(buffer.begin() + size, buffer.end(), Complex());
+  radix_2_transform(buffer, false);
+  for (VectorSize index = 0; index != radix_2_size; ++index) {
+    buffer[index] *= chirp_transform[index];
+  }
+  radix_2_transform(buffer, true);
+  double normalization = 1. / radix_2_size;
+  for (VectorSize index = 0; index != size; ++index) {
+    data[index] = buffer[index] * chirp[index] * normalization;
+  }
+}
+
+void FFT::ComplexTransform::radix_2_transform(ComplexVector &data,
+                                              bool inverse) const {
+  for (VectorSize index = 0; index != radix_2_size; ++index) {
+    VectorSize reversed = bit_reversal[index];
+    if (index < reversed) {
+      std::swap(data[index], data[reversed]);
+    }
+  }
+  for (VectorSize length = 2; length <= radix_2_size; length *= 2) {
+    VectorSize half_length = length / 2;
+    VectorSize twiddle_step = radix_2_size / length;
+    for (VectorSize start = 0; start != radix_2_size; start += length) {
+      for (VectorSize index = 0; index != half_length; ++index) {
+        Complex twiddle = twiddles[index * twiddle_step];
+        if (inverse) {
+          twiddle = std::conj(twiddle);
+        }
+        Complex upper = data[start + index];
+        Complex lower = data[start + index + half_length] * twiddle;
+        data[start + index] = upper + lower;
+        data[start + index + half_length] = upper - lower;
+      }
+    }
+  }
+}
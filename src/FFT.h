@@ -0,0 +1,123 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    FFT.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_FFT_H
+#define OVERTONE_FFT_H
+
+#include <complex>
+#include <vector>
+
+/**
+ * Fast Fourier transform of a real signal of arbitrary length.
+ *
+ * Even lengths are packed into a complex transform of half the length.
+ * Lengths that are powers of two are transformed by an iterative radix-2
+ * transform, all the other lengths are evaluated via Bluestein's algorithm.
+ * The tables of a length are evaluated once in the constructor, so an FFT
+ * object should be reused for all the transforms of the same length.
+ *
+ * For signals with |x| <= 1 and lengths up to 10^6 samples, the normalized
+ * magnitudes 2 |X_k| / N agree with the direct evaluation of the discrete
+ * Fourier transform within an absolute tolerance of 1e-9.
+ */
+class FFT {
+public:
+  using Complex = std::complex<double>;
+  using ComplexVector = std::vector<Complex>;
+  using Vector = std::vector<double>;
+  using VectorSize = Vector::size_type;
+
+  FFT() : size(0), half_size(0) {}
+
+  /**
+   * Evaluates the tables for transforms of the length `size`.
+   * @param size number of samples of the transformed signals (size > 0)
+   */
+  explicit FFT(VectorSize size);
+
+  /**
+   * Returns the number of samples of the transformed signals.
+   * @return number of samples
+   */
+  VectorSize get_size() const { return size; }
+
+  /**
+   * Evaluates the discrete Fourier transform
+   * X_k = sum_n x_n exp(-2 pi i k n / N) of `size` real samples for
+   * k = 0, ..., size / 2.
+   * @param input pointer to the first sample
+   * @param output Fourier transform (resized to size / 2 + 1)
+   */
+  void transform(const double *input, ComplexVector &output);
+
+private:
+  // number of real samples
+  VectorSize size;
+
+  // length of the complex transform (size / 2 if size is even)
+  VectorSize half_size;
+
+  // true if the complex transform is packed from pairs of real samples
+  bool packed{};
+
+  // the complex transform of the length half_size
+  class ComplexTransform {
+  public:
+    ComplexTransform() = default;
+    explicit ComplexTransform(VectorSize size);
+    void transform(ComplexVector &data);
+
+  private:
+    VectorSize size{};
+
+    // length of the radix-2 transform (size if size is a power of two)
+    VectorSize radix_2_size{};
+
+    // bit-reversal permutation of the radix-2 transform
+    std::vector<VectorSize> bit_reversal;
+
+    // exp(-2 pi i k / radix_2_size) for k < radix_2_size / 2
+    ComplexVector twiddles;
+
+    // Bluestein's algorithm: chirp exp(-i pi n^2 / size)
+    ComplexVector chirp;
+
+    // Bluestein's algorithm: radix-2 transform of the conjugated chirp
+    ComplexVector chirp_transform;
+
+    // Bluestein's algorithm: zero-padded working buffer
+    ComplexVector buffer;
+
+    void radix_2_transform(ComplexVector &data, bool inverse) const;
+  };
+
+  ComplexTransform complex_transform;
+
+  // exp(-2 pi i k / size) for unpacking the real transform
+  ComplexVector unpacking_twiddles;
+
+  // working buffer of the complex transform
+  ComplexVector buffer;
+};
+
+#endif // OVERTONE_FFT_H
@@ -22,15 +22,11 @@
 ******************************************************************************/
 
 #include "FFmpeg.h"
-#include <algorithm>
 #include <sstream>
 
-FFmpeg::FFmpeg(std::string input_file_path, std::string audio_file_path,
-               std::string frames_directory_path, std::string video_path,
+FFmpeg::FFmpeg(std::string input_file_path, std::string video_path,
                const std::string &ffmpeg_executable_path, unsigned frame_rate)
     : input_file_path(std::move(input_file_path)),
-      audio_file_path(std::move(audio_file_path)),
-      frames_directory_path(std::move(frames_directory_path)),
       video_path(std::move(video_path)), frame_rate(frame_rate) {
   std::string command = ffmpeg_executable_path + " -version 1>/dev/null";
   if (std::system(command.c_str())) {
@@ -51,44 +47,17 @@ FFmpeg::FFmpeg(std::string input_file_path, std::string audio_file_path,
   }
 }
 
-void FFmpeg::convert_to_wave() {
-  std::string command = "'" + ffmpeg_executable_path + "' -y -i '" +
-                        input_file_path + "' '" + audio_file_path +
-                        "' 2>/dev/null";
-  int exit_code = std::system(command.c_str());
-  if (exit_code) {
-    throw FFmpeg::file_conversion_error("FFmpeg failed to convert '" +
-                                        input_file_path + "' to '" +
-                                        audio_file_path + "'.");
-  }
-}
-
-void FFmpeg::convert_to_mp4() {
-  std::string command = "'" + ffmpeg_executable_path +
-                        "' -pattern_type glob -framerate " +
-                        std::to_string(frame_rate) + " -i '" +
-                        add_backslashes_if_necessary(frames_directory_path) +
-                        "/*.png'" + " -i '" + audio_file_path +
-                        "' -b:v 20000k '" + video_path + "' 2>/dev/null";
-  int exit_code = std::system(command.c_str());
-  if (exit_code) {
-    throw FFmpeg::file_conversion_error(
-        "FFmpeg failed to create the video file '" + video_path + "'.");
-  }
+std::string FFmpeg::get_decoder_command() const {
+  return "'" + ffmpeg_executable_path + "' -i '" + input_file_path +
+         "' -map 0:a:0 -c:a pcm_f32le -f wav pipe:1 2>/dev/null";
 }
 
-std::string
-FFmpeg::add_backslashes_if_necessary(const std::string &input_string) {
-  std::string accumulator;
-  std::string bad_characters(" \n\t\\[]{}():;\"'<>?|=!$^&*`");
-  for (const char &character : input_string) {
-    auto search_result =
-        std::find(bad_characters.cbegin(), bad_characters.cend(), character);
-    bool bad_character(search_result != bad_characters.cend());
-    if (bad_character) {
-      accumulator += std::string("\\");
-    }
-    accumulator += character;
-  }
-  return accumulator;
+std::string FFmpeg::get_encoder_command(unsigned width,
+                                        unsigned height) const {
+  return "'" + ffmpeg_executable_path +
+         "' -f rawvideo -pixel_format rgb24 -video_size " +
+         std::to_string(width) + "x" + std::to_string(height) +
+         " -framerate " + std::to_string(frame_rate) + " -i pipe:0 -i '" +
+         input_file_path + "' -map 0:v:0 -map 1:a:0 -b:v 20000k '" +
+         video_path + "' 2>/dev/null";
 }
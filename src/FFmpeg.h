@@ -33,16 +33,13 @@ public:
 
   /**
    * Configures the file paths for the FFmpeg commands.
-   * @param input_file_path Video or audio file.
-   * @param audio_file_path WAVE file for the video
-   *                        (signed 16 bit linear-PCM).
-   * @param frames_directory_path Directory for the frames of the video.
+   * @param input_file_path Video or audio file, which also provides the
+   *                        audio of the video.
    * @param video_path Final video
    * @param ffmpeg_executable_path Path of the FFmpeg executable
    * @param frame_rate Video frame rate in frames per second
    */
-  FFmpeg(std::string input_file_path, std::string audio_file_path,
-         std::string frames_directory_path, std::string video_path,
+  FFmpeg(std::string input_file_path, std::string video_path,
          const std::string &ffmpeg_executable_path, unsigned frame_rate);
 
   /**
@@ -52,32 +49,37 @@ public:
   class file_conversion_error;
 
   /**
-   * Converts the file `input_file_path` to a WAVE file that contains a 16 bit
-   * linear-PCM signal (signed and little endian).
+   * Returns the command of an FFmpeg process that decodes the first audio
+   * stream of the file `input_file_path` and writes it as a WAVE stream with
+   * 32 bit float samples (pcm_f32le) into its standard output. The channels
+   * and the sample rate of the input file are kept.
+   * @return shell command
    */
-  void convert_to_wave();
+  std::string get_decoder_command() const;
 
   /**
-   * Converts the frames in `frames_directory_path` and the audio file
-   * `audio_file_path` to a video and saves it into the file `video_path`
+   * Returns the command of an FFmpeg process that reads raw RGB frames
+   * (rgb24, row by row) from its standard input, adds the first audio stream
+   * of the file `input_file_path`, and saves the video into the file
+   * `video_path`.
+   * @param width width of the frames in pixels
+   * @param height height of the frames in pixels
+   * @return shell command
    */
-  void convert_to_mp4();
-
-  std::string get_frames_directory_path() const {
-    return frames_directory_path;
-  }
+  std::string get_encoder_command(unsigned width, unsigned height) const;
 
   std::string get_ffmpeg_executable_path() const {
     return ffmpeg_executable_path;
   }
 
-private:
-  static std::string
-  add_backslashes_if_necessary(const std::string &input_string);
+  /**
+   * Changes the path of the video, e.g., to render several videos.
+   * @param path path of the video
+   */
+  void set_video_path(std::string path) { video_path = std::move(path); }
 
+private:
   std::string input_file_path;
-  std::string audio_file_path;
-  std::string frames_directory_path;
   std::string video_path;
   std::string ffmpeg_executable_path;
   unsigned frame_rate;
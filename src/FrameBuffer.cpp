@@ -0,0 +1,85 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    FrameBuffer.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "FrameBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+FrameBuffer::FrameBuffer(unsigned width, unsigned height)
+    : width(width), height(height) {
+  if (width == 0 || height == 0) {
+    throw std::invalid_argument("The size of the frame has to be nonzero.");
+  }
+  stride = (3ul * width + alignment - 1) / alignment * alignment;
+  std::size_t size = stride * height;
+  data.reset(static_cast<unsigned char *>(std::aligned_alloc(alignment, size)));
+  if (!data) {
+    throw std::bad_alloc();
+  }
+  std::memset(data.get(), 0, size);
+}
+
+void FrameBuffer::fill_span(unsigned row, unsigned column, unsigned length,
+                            const Color &color) {
+  if (length == 0) {
+    return;
+  }
+  unsigned char *first = get_row(row) + 3ul * column;
+  std::copy(color.cbegin(), color.cend(), first);
+  // Doubles the filled part until the span is complete.
+  std::size_t filled = 3;
+  std::size_t size = 3ul * length;
+  while (filled < size) {
+    std::size_t copied = std::min(filled, size - filled);
+    std::memcpy(first + filled, first, copied);
+    filled += copied;
+  }
+}
+
+void FrameBuffer::fill_rectangle(unsigned row, unsigned column,
+                                 unsigned height, unsigned width,
+                                 const Color &color) {
+  if (height == 0 || width == 0) {
+    return;
+  }
+  fill_span(row, column, width, color);
+  const unsigned char *first = get_row(row) + 3ul * column;
+  for (unsigned index = 1; index != height; ++index) {
+    std::memcpy(get_row(row + index) + 3ul * column, first, 3ul * width);
+  }
+}
+
+void FrameBuffer::copy_rows(unsigned destination, unsigned source,
+                            unsigned number_of_rows) {
+  std::memmove(get_row(destination), get_row(source), number_of_rows * stride);
+}
+
+void FrameBuffer::copy_row(unsigned row, const FrameBuffer &source,
+                           unsigned source_row) {
+  if (source.width != width) {
+    throw std::invalid_argument("The widths of the frames don't match.");
+  }
+  std::memcpy(get_row(row), source.get_row(source_row), 3ul * width);
+}
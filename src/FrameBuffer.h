@@ -0,0 +1,133 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    FrameBuffer.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_FRAMEBUFFER_H
+#define OVERTONE_FRAMEBUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+/**
+ * A video frame as a single contiguous RGB24 image.
+ *
+ * The rows are stored one after another. Each row starts at a multiple of
+ * `alignment` bytes, so the rows are padded if 3 * width isn't a multiple of
+ * the alignment.
+ */
+class FrameBuffer {
+public:
+  using Color = std::array<unsigned char, 3>;
+
+  // alignment of the rows in bytes
+  static constexpr std::size_t alignment = 64;
+
+  /**
+   * Allocates a black frame.
+   * @param width width of the frame in pixels (width > 0)
+   * @param height height of the frame in pixels (height > 0)
+   */
+  FrameBuffer(unsigned width, unsigned height);
+
+  unsigned get_width() const { return width; }
+
+  unsigned get_height() const { return height; }
+
+  /**
+   * @return distance between the first bytes of two adjacent rows in bytes
+   */
+  std::size_t get_stride() const { return stride; }
+
+  /**
+   * @return true if the rows aren't padded, i.e., the frame is a single
+   *         block of width * height pixels
+   */
+  bool is_contiguous() const { return stride == 3ul * width; }
+
+  /**
+   * @param row index of the row (row < height)
+   * @return first byte of the row
+   */
+  unsigned char *get_row(unsigned row) { return data.get() + row * stride; }
+
+  const unsigned char *get_row(unsigned row) const {
+    return data.get() + row * stride;
+  }
+
+  /**
+   * @return first byte of the frame
+   */
+  const unsigned char *get_data() const { return data.get(); }
+
+  /**
+   * Sets `length` pixels of a row, starting at `column`, to a color.
+   * @param row index of the row
+   * @param column index of the first pixel
+   * @param length number of pixels (column + length <= width)
+   * @param color color of the pixels
+   */
+  void fill_span(unsigned row, unsigned column, unsigned length,
+                 const Color &color);
+
+  /**
+   * Sets a rectangle of pixels to a color.
+   * @param row index of the top row of the rectangle
+   * @param column index of the left column of the rectangle
+   * @param height number of rows (row + height <= frame height)
+   * @param width number of columns (column + width <= frame width)
+   * @param color color of the pixels
+   */
+  void fill_rectangle(unsigned row, unsigned column, unsigned height,
+                      unsigned width, const Color &color);
+
+  /**
+   * Copies whole rows within the frame. The source and the destination rows
+   * may overlap.
+   * @param destination index of the first destination row
+   * @param source index of the first source row
+   * @param number_of_rows number of copied rows
+   */
+  void copy_rows(unsigned destination, unsigned source,
+                 unsigned number_of_rows);
+
+  /**
+   * Copies a row of another frame of the same width into this frame.
+   * @param row index of the destination row
+   * @param source frame that contains the source row
+   * @param source_row index of the source row
+   */
+  void copy_row(unsigned row, const FrameBuffer &source, unsigned source_row);
+
+private:
+  struct Deallocator {
+    void operator()(unsigned char *pointer) const { std::free(pointer); }
+  };
+
+  unsigned width;
+  unsigned height;
+  std::size_t stride;
+  std::unique_ptr<unsigned char[], Deallocator> data;
+};
+
+#endif // OVERTONE_FRAMEBUFFER_H
@@ -0,0 +1,116 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    FrameRenderer.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "FrameRenderer.h"
+#include <algorithm>
+#include <stdexcept>
+
+FrameRenderer::FrameRenderer(double gain, double gate, std::string theme,
+                             unsigned history_speed)
+    : history_speed(history_speed), window_size(0), geometry(),
+      color_map(std::move(theme), gain, gate),
+      background(Geometry::frame_width, Geometry::frame_height) {
+  if (history_speed == 0 || history_speed > Geometry::history_height) {
+    throw std::out_of_range(
+        "The argument `history_speed` is not within the interval [1, 786].");
+  }
+  // The oldest visible key row is row j = history_height - 1.
+  window_size =
+      std::max((Geometry::history_height - 1) / history_speed, 1u) + 1;
+
+  const unsigned width = Geometry::frame_width;
+  const unsigned height = Geometry::frame_height;
+  const unsigned border = Geometry::border;
+  const Color edge_color = color_map.get_edge_color();
+  background.fill_rectangle(0, 0, height, width, color_map(0));
+  background.fill_rectangle(0, 0, border, width, edge_color);
+  background.fill_rectangle(border, 0, height - 2 * border, border,
+                            edge_color);
+  background.fill_rectangle(border, width - border, height - 2 * border,
+                            border, edge_color);
+  background.fill_rectangle(height - border, 0, border, width, edge_color);
+  for (const auto &run : geometry.get_static_runs()) {
+    background.fill_span(run.row, run.column, run.length,
+                         run.role == Geometry::edge ? edge_color
+                                                    : color_map(0));
+  }
+
+  const auto &runs = geometry.get_key_runs();
+  for (std::size_t run = 0; run != runs.size(); ++run) {
+    if (runs[run].row == Geometry::key_row) {
+      key_row_runs.push_back(run);
+    }
+  }
+}
+
+void FrameRenderer::render(const std::vector<const Vector *> &keyboards,
+                           FrameBuffer &frame) const {
+  if (keyboards.empty() || keyboards.size() > window_size) {
+    throw std::invalid_argument(
+        "The number of keyboards doesn't match the window of the history.");
+  }
+  const unsigned key_row = Geometry::key_row;
+  for (unsigned row = 0; row != Geometry::history_row; ++row) {
+    frame.copy_row(row, background, row);
+  }
+  for (unsigned row = key_row; row != Geometry::frame_height; ++row) {
+    frame.copy_row(row, background, row);
+  }
+
+  // stripes of the history, from the newest to the oldest key row
+  const unsigned history_end = Geometry::history_height;
+  for (unsigned back = 1; back != window_size; ++back) {
+    unsigned first_j = back == 1 ? 1 : back * history_speed;
+    unsigned end_j = std::min((back + 1) * history_speed, history_end);
+    if (first_j >= end_j) {
+      break;
+    }
+    const Vector *keyboard = back < keyboards.size()
+                                 ? keyboards[keyboards.size() - 1 - back]
+                                 : nullptr;
+    draw_key_row(keyboard, key_row - first_j, frame);
+    for (unsigned j = first_j + 1; j != end_j; ++j) {
+      frame.copy_row(key_row - j, frame, key_row - first_j);
+    }
+  }
+
+  // the keys of the current video frame
+  std::vector<Color> key_colors;
+  color_map.evaluate_colors(*keyboards.back(), key_colors);
+  for (const auto &run : geometry.get_key_runs()) {
+    frame.fill_span(run.row, run.column, run.length, key_colors[run.role]);
+  }
+}
+
+void FrameRenderer::draw_key_row(const Vector *keyboard, unsigned row,
+                                 FrameBuffer &frame) const {
+  frame.copy_row(row, background, Geometry::key_row);
+  if (keyboard == nullptr) {
+    return;
+  }
+  const auto &runs = geometry.get_key_runs();
+  for (std::size_t run : key_row_runs) {
+    frame.fill_span(row, runs[run].column, runs[run].length,
+                    color_map((*keyboard)[runs[run].role]));
+  }
+}
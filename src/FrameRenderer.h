@@ -0,0 +1,101 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    FrameRenderer.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_FRAMERENDERER_H
+#define OVERTONE_FRAMERENDERER_H
+
+#include "ColorMap.h"
+#include "FrameBuffer.h"
+#include "KeyboardGeometry.h"
+#include <string>
+#include <vector>
+
+/**
+ * Renders a video frame from the keyboards of the video frame and of the
+ * previous video frames whose key rows are visible in the history.
+ *
+ * Unlike VideoFrame, which scrolls the history of a single frame buffer, the
+ * renderer doesn't keep any state between frames, so any number of threads
+ * may render video frames in any order.
+ *
+ * The key row of video frame N is row j = 0 of the history (counted upwards
+ * from the key row). The rows 1 <= j < 2 * history_speed show the key row of
+ * frame N - 1, and the rows b * history_speed <= j < (b + 1) * history_speed
+ * show the key row of frame N - b for b >= 2. The rows of frames before the
+ * first frame are blank.
+ */
+class FrameRenderer {
+public:
+  using Vector = std::vector<double>;
+  using Color = FrameBuffer::Color;
+  using Geometry = KeyboardGeometry;
+
+  /**
+   * @param gain multiplies each key of the keyboard by this value
+   * @param gate all keys below this threshold are set to 0
+   *             (0.0 <= gate <= 1.0)
+   * @param theme name of the color theme
+   * @param history_speed speed of the history in pixel rows per video frame
+   */
+  FrameRenderer(double gain, double gate, std::string theme,
+                unsigned history_speed);
+
+  /**
+   * @return number of keyboards that determine a video frame (its own
+   *         keyboard and the keyboards of the previous video frames)
+   */
+  unsigned get_window_size() const { return window_size; }
+
+  /**
+   * Renders a video frame.
+   * @param keyboards keyboards of the video frames N - keyboards.size() + 1,
+   *                  ..., N, where N is the rendered video frame. Fewer than
+   *                  get_window_size() keyboards are only passed at the
+   *                  beginning of the video.
+   * @param frame frame of Geometry::frame_width * Geometry::frame_height
+   *              pixels
+   */
+  void render(const std::vector<const Vector *> &keyboards,
+              FrameBuffer &frame) const;
+
+private:
+  unsigned history_speed;
+  unsigned window_size;
+  Geometry geometry;
+  ColorMap color_map;
+
+  // the video frame without the history and the keys
+  FrameBuffer background;
+
+  // indices of the runs of the keys in the key row
+  std::vector<std::size_t> key_row_runs;
+
+  /**
+   * Draws the key row of a keyboard into a row of the frame.
+   * @param keyboard keyboard, or nullptr for a blank key row
+   */
+  void draw_key_row(const Vector *keyboard, unsigned row,
+                    FrameBuffer &frame) const;
+};
+
+#endif // OVERTONE_FRAMERENDERER_H
@@ -22,59 +22,123 @@
 ******************************************************************************/
 
 #include "Keyboard.h"
+#include <algorithm>
 
 Keyboard::Keyboard(std::initializer_list<Spectrum> spectra)
     : spectra(spectra), keyboard(std::make_shared<Vector>()) {
   evaluate_keys();
 }
 
+Keyboard::Keyboard(std::vector<Spectrum> spectra)
+    : spectra(std::move(spectra)), keyboard(std::make_shared<Vector>()) {
+  evaluate_keys();
+}
+
+Keyboard::Keyboard(const Keyboard &keyboard) : spectra(keyboard.spectra) {
+  if (keyboard.keyboard) {
+    this->keyboard = std::make_shared<Vector>(*keyboard.keyboard);
+  }
+}
+
+Keyboard &Keyboard::operator=(const Keyboard &keyboard) {
+  if (this != &keyboard) {
+    *this = Keyboard(keyboard);
+  }
+  return *this;
+}
+
 void Keyboard::evaluate_keys() {
   keyboard->assign(88, 0.0);
-  KeyRange key_range;
-  double weighted_spectrum_accumulator, weight_accumulator, weight;
-  Vector::const_iterator key, keys_end, spectrum_value;
   for (const Spectrum &spectrum : spectra) {
-    key = spectrum.get_keys()->cbegin();
-    keys_end = spectrum.get_keys()->cend();
-    spectrum_value = spectrum.get_spectrum()->cbegin();
-    key_range = spectrum.get_key_range();
-    for (unsigned char assigned_key = key_range.first;
-         assigned_key != key_range.second; ++assigned_key) {
-      weighted_spectrum_accumulator = 0.0;
-      weight_accumulator = 0.0;
-      while (key != keys_end && assigned_key - 0.5 <= *key &&
-             *key < assigned_key + 0.5) {
-        weight = evaluate_weight(*key, assigned_key);
-        weighted_spectrum_accumulator += *spectrum_value * weight;
-        weight_accumulator += weight;
-        ++key;
-        ++spectrum_value;
-      }
-      if (weighted_spectrum_accumulator != 0.0) {
-        (*keyboard)[assigned_key] +=
-            weighted_spectrum_accumulator / weight_accumulator;
-      }
-    }
+    spectrum.get_plan()->project(spectrum.get_spectrum()->data(),
+                                 keyboard->data());
   }
 }
 
-double Keyboard::evaluate_weight(const double &key,
-                                 const unsigned char &assigned_key) {
-  // The upwards shift by 0.01 is necessary to avoid divisions by zero.
-  if (key < assigned_key) {
-    return 2. * key + 1. - 2. * assigned_key + 0.01;
-  } else {
-    return -2. * key + 1. + 2. * assigned_key + 0.01;
+bool Keyboard::go_to_next_frame() {
+  // The spectra may be evaluated at different sample rates, whose numbers of
+  // video frames can differ at the end of the signal.
+  valid_spectra.clear();
+  for (Spectrum &spectrum : spectra) {
+    valid_spectra.push_back(spectrum.begin_next_frame());
   }
+  return evaluate_frame();
 }
 
-bool Keyboard::go_to_next_frame() {
-  bool valid = false;
+bool Keyboard::go_to_frame(FrameIndex frame_index) {
+  // The spectra may be evaluated at different sample rates, whose numbers of
+  // video frames can differ at the end of the signal.
+  valid_spectra.clear();
   for (Spectrum &spectrum : spectra) {
-    valid = spectrum.go_to_next_frame();
+    valid_spectra.push_back(spectrum.begin_frame(frame_index));
+  }
+  return evaluate_frame();
+}
+
+bool Keyboard::evaluate_frame() {
+  if (task_pool) {
+    tasks.clear();
+    for (std::size_t index = 0; index != spectra.size(); ++index) {
+      if (!valid_spectra[index]) {
+        continue;
+      }
+      Spectrum::VectorSize number_of_channels =
+          spectra[index].get_number_of_selected_channels();
+      for (Spectrum::VectorSize channel = 0; channel != number_of_channels;
+           ++channel) {
+        tasks.emplace_back(index, channel);
+      }
+    }
+    // The pool deals out the longest audio frames first and the threads
+    // steal the shortest ones at the end. Unlike std::stable_sort, std::sort
+    // doesn't allocate a temporary buffer.
+    std::sort(tasks.begin(), tasks.end(),
+              [this](const auto &left, const auto &right) {
+                auto left_size =
+                    spectra[left.first].get_plan()->get_number_of_samples();
+                auto right_size =
+                    spectra[right.first].get_plan()->get_number_of_samples();
+                return left_size > right_size ||
+                       (left_size == right_size && left < right);
+              });
+    task_pool->run(tasks.size(), [this](std::size_t task) {
+      spectra[tasks[task].first].evaluate_channel(tasks[task].second);
+    });
+  } else {
+    for (std::size_t index = 0; index != spectra.size(); ++index) {
+      if (!valid_spectra[index]) {
+        continue;
+      }
+      Spectrum &spectrum = spectra[index];
+      for (Spectrum::VectorSize channel = 0;
+           channel != spectrum.get_number_of_selected_channels(); ++channel) {
+        spectrum.evaluate_channel(channel);
+      }
+    }
+  }
+
+  bool valid = true;
+  for (std::size_t index = 0; index != spectra.size(); ++index) {
+    if (valid_spectra[index]) {
+      spectra[index].finish_frame();
+    } else {
+      valid = false;
+    }
   }
   if (valid) {
     evaluate_keys();
   }
   return valid;
 }
+
+Keyboard::FrameIndex Keyboard::get_number_of_frames() const {
+  FrameIndex number_of_frames = 0;
+  for (auto spectrum = spectra.cbegin(); spectrum != spectra.cend();
+       ++spectrum) {
+    if (spectrum == spectra.cbegin() ||
+        spectrum->get_number_of_frames() < number_of_frames) {
+      number_of_frames = spectrum->get_number_of_frames();
+    }
+  }
+  return number_of_frames;
+}
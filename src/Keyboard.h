@@ -24,17 +24,19 @@
 #ifndef OVERTONE_KEYBOARD_H
 #define OVERTONE_KEYBOARD_H
 
+#include "KeyboardSource.h"
 #include "Spectrum.h"
+#include "TaskPool.h"
 #include <initializer_list>
 #include <memory>
 
 /**
  * This class projects the audio spectra onto the 88 keys of the keyboard.
  */
-class Keyboard {
+class Keyboard : public KeyboardSource {
 public:
-  using Vector = std::vector<double>;
   using KeyRange = std::pair<unsigned char, unsigned char>;
+  using FrameIndex = Spectrum::VectorSize;
 
   Keyboard() = default;
 
@@ -44,14 +46,53 @@ public:
    */
   Keyboard(std::initializer_list<Spectrum> spectra);
 
-  std::shared_ptr<Vector> get_keyboard() const { return keyboard; }
+  /**
+   * constructor that evaluates `keyboard` for the first frame of the video
+   * @param spectra audio spectra of the keyboard sections
+   */
+  explicit Keyboard(std::vector<Spectrum> spectra);
+
+  /**
+   * The copy doesn't share `keyboard` and the task pool with the original,
+   * so copies can be evaluated independently, e.g., by different threads.
+   */
+  Keyboard(const Keyboard &keyboard);
+  Keyboard &operator=(const Keyboard &keyboard);
+  Keyboard(Keyboard &&keyboard) = default;
+  Keyboard &operator=(Keyboard &&keyboard) = default;
+
+  std::shared_ptr<Vector> get_keyboard() const override { return keyboard; }
 
   /**
    * Evaluates `keyboard` for the next video frame if there is a next video
    * frame.
    * @return false if there is no next video frame
    */
-  bool go_to_next_frame();
+  bool go_to_next_frame() override;
+
+  /**
+   * Evaluates `keyboard` for an arbitrary video frame.
+   * @param frame_index index of the video frame
+   * @return false if the video frame doesn't exist
+   */
+  bool go_to_frame(FrameIndex frame_index);
+
+  /**
+   * @return number of video frames
+   */
+  FrameIndex get_number_of_frames() const;
+
+  /**
+   * Evaluates the channels of all spectra of a frame concurrently via the
+   * task pool instead of sequentially. The audio sources of the spectra have
+   * to keep the samples of a frame valid until the samples of the frame have
+   * been read from all sources, which holds for decoded WAVE files and for
+   * the sources of an AudioStream.
+   * @param task_pool task pool or nullptr for the sequential evaluation
+   */
+  void set_task_pool(std::shared_ptr<TaskPool> task_pool) {
+    this->task_pool = std::move(task_pool);
+  }
 
 private:
   // audio spectra of the keyboard sections
@@ -60,23 +101,26 @@ private:
   // vector that contains the signal of each key of the keyboard
   std::shared_ptr<Vector> keyboard;
 
+  // task pool that evaluates the channels of the spectra or nullptr
+  std::shared_ptr<TaskPool> task_pool;
+
+  // true for each spectrum that has been moved to a valid frame
+  std::vector<bool> valid_spectra;
+
+  // (spectrum, channel) tasks of the current frame
+  std::vector<std::pair<std::size_t, Spectrum::VectorSize>> tasks;
+
   /**
-   * Evaluates `keyboard`.
+   * Evaluates the spectra that have been moved to a valid frame and
+   * `keyboard` if all of them are valid.
+   * @return true if all spectra are valid
    */
-  void evaluate_keys();
+  bool evaluate_frame();
 
   /**
-   * evaluate_keys() evaluates the weighted average of all the signals that
-   * belong to a certain key on the keyboard. This function determines the
-   * weight of such a signal.
-   * @param key position of a certain frequency on the keyboard, e.g., 440 Hz
-   *            would be at 48.0
-   * @param assigned_key index of the key on the keyboard to which the signal
-   *                     belongs, i.e., an integer from 0 to 87
-   * @return weight
+   * Evaluates `keyboard` via the analysis plans of the spectra.
    */
-  inline static double evaluate_weight(const double &key,
-                                       const unsigned char &assigned_key);
+  void evaluate_keys();
 };
 
 #endif // OVERTONE_KEYBOARD_H
@@ -0,0 +1,133 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    KeyboardBroadcast.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "KeyboardBroadcast.h"
+#include <algorithm>
+#include <stdexcept>
+
+class KeyboardBroadcast::Subscriber : public KeyboardSource {
+public:
+  Subscriber(KeyboardBroadcast &broadcast, unsigned index,
+             const Vector &keyboard)
+      : broadcast(broadcast), index(index),
+        keyboard(std::make_shared<Vector>(keyboard)) {}
+
+  ~Subscriber() override { broadcast.unsubscribe(index); }
+
+  std::shared_ptr<Vector> get_keyboard() const override { return keyboard; }
+
+  bool go_to_next_frame() override {
+    return broadcast.receive(index, *keyboard);
+  }
+
+private:
+  KeyboardBroadcast &broadcast;
+  unsigned index;
+  std::shared_ptr<Vector> keyboard;
+};
+
+KeyboardBroadcast::KeyboardBroadcast(std::shared_ptr<KeyboardSource> source,
+                                     unsigned number_of_subscribers,
+                                     FrameIndex buffer_size)
+    : source(std::move(source)), positions(number_of_subscribers, 0),
+      finished(number_of_subscribers, false) {
+  if (number_of_subscribers == 0 || buffer_size == 0) {
+    throw std::invalid_argument("The number of subscribers and the buffer "
+                                "size have to be nonzero.");
+  }
+  keyboards.resize(buffer_size);
+  keyboards[0] = *this->source->get_keyboard();
+  number_of_keyboards = 1;
+}
+
+std::shared_ptr<KeyboardSource>
+KeyboardBroadcast::get_subscriber(unsigned subscriber) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (subscriber >= positions.size()) {
+    throw std::out_of_range("Invalid subscriber.");
+  }
+  return std::make_shared<Subscriber>(*this, subscriber, keyboards[0]);
+}
+
+bool KeyboardBroadcast::receive(unsigned subscriber, Vector &keyboard) {
+  std::unique_lock<std::mutex> lock(mutex);
+  FrameIndex frame_index = positions[subscriber] + 1;
+  while (true) {
+    if (source_exception) {
+      std::rethrow_exception(source_exception);
+    }
+    if (frame_index < number_of_keyboards) {
+      keyboard = keyboards[frame_index % keyboards.size()];
+      positions[subscriber] = frame_index;
+      lock.unlock();
+      progress.notify_all();
+      return true;
+    }
+    if (all_keyboards_read) {
+      return false;
+    }
+    // The next keyboard may only overwrite a slot that every subscriber has
+    // left behind.
+    FrameIndex slowest = number_of_keyboards;
+    for (std::size_t index = 0; index != positions.size(); ++index) {
+      if (!finished[index]) {
+        slowest = std::min(slowest, positions[index]);
+      }
+    }
+    if (reading || number_of_keyboards - slowest >= keyboards.size()) {
+      progress.wait(lock);
+      continue;
+    }
+
+    reading = true;
+    FrameIndex next_keyboard = number_of_keyboards;
+    lock.unlock();
+    bool has_next_frame = false;
+    std::exception_ptr exception;
+    try {
+      has_next_frame = source->go_to_next_frame();
+      if (has_next_frame) {
+        keyboards[next_keyboard % keyboards.size()] = *source->get_keyboard();
+      }
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    lock.lock();
+    reading = false;
+    source_exception = exception;
+    if (has_next_frame) {
+      ++number_of_keyboards;
+    } else {
+      all_keyboards_read = true;
+    }
+    progress.notify_all();
+  }
+}
+
+void KeyboardBroadcast::unsubscribe(unsigned subscriber) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    finished[subscriber] = true;
+  }
+  progress.notify_all();
+}
@@ -0,0 +1,109 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    KeyboardBroadcast.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_KEYBOARDBROADCAST_H
+#define OVERTONE_KEYBOARDBROADCAST_H
+
+#include "KeyboardSource.h"
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Passes the keyboards of a single keyboard source on to several
+ * subscribers, e.g., to the renderers of several videos, which run on their
+ * own threads.
+ *
+ * The keyboards are kept in a ring buffer until every subscriber has moved
+ * past them. The subscriber that needs a keyboard first reads it from the
+ * source, so the analysis runs once for all subscribers. A subscriber that
+ * is buffer_size video frames ahead of the slowest subscriber waits.
+ */
+class KeyboardBroadcast {
+public:
+  using Vector = KeyboardSource::Vector;
+  using FrameIndex = std::size_t;
+
+  /**
+   * @param source keyboard source at its first video frame
+   * @param number_of_subscribers number of subscribers (> 0)
+   * @param buffer_size capacity of the ring buffer in video frames (> 0)
+   */
+  KeyboardBroadcast(std::shared_ptr<KeyboardSource> source,
+                    unsigned number_of_subscribers,
+                    FrameIndex buffer_size = 64);
+
+  KeyboardBroadcast(const KeyboardBroadcast &) = delete;
+  KeyboardBroadcast &operator=(const KeyboardBroadcast &) = delete;
+
+  /**
+   * Creates the keyboard source of a subscriber, which has to be called once
+   * per subscriber. The keyboard source must not outlive the broadcast.
+   * @param subscriber index of the subscriber (< number_of_subscribers)
+   * @return keyboard source of the subscriber at the first video frame
+   */
+  std::shared_ptr<KeyboardSource> get_subscriber(unsigned subscriber);
+
+private:
+  class Subscriber;
+
+  std::shared_ptr<KeyboardSource> source;
+
+  // keyboards of the recent video frames (slot = frame index % size)
+  std::vector<Vector> keyboards;
+
+  // number of keyboards that have been read from the source
+  FrameIndex number_of_keyboards{};
+
+  // true if the source has passed its last video frame
+  bool all_keyboards_read{};
+
+  // true while a subscriber reads a keyboard from the source
+  bool reading{};
+
+  // current video frame of each subscriber (number_of_keyboards of a
+  // subscriber that has been destroyed doesn't hold back the others)
+  std::vector<FrameIndex> positions;
+  std::vector<bool> finished;
+
+  std::mutex mutex;
+  std::condition_variable progress;
+
+  // exception thrown by the source
+  std::exception_ptr source_exception;
+
+  /**
+   * Moves a subscriber to the next video frame.
+   * @param subscriber index of the subscriber
+   * @param keyboard receives the keyboard of the next video frame
+   * @return false if there is no next video frame
+   */
+  bool receive(unsigned subscriber, Vector &keyboard);
+
+  void unsubscribe(unsigned subscriber);
+};
+
+#endif // OVERTONE_KEYBOARDBROADCAST_H
@@ -0,0 +1,71 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    KeyboardGeometry.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "KeyboardGeometry.h"
+#include <algorithm>
+
+KeyboardGeometry::KeyboardGeometry() : first_runs() {
+  // Paints the roles of the rectangles, which leaves the role of each
+  // visible pixel of the keyboard.
+  constexpr auto rectangles = get_rectangles();
+  const unsigned number_of_rows = keys_end_row - key_row;
+  const int unpainted = background - 1;
+  std::vector<int> roles(number_of_rows * frame_width, unpainted);
+  for (const Rectangle &rectangle : rectangles) {
+    for (unsigned row = 0; row != rectangle.height; ++row) {
+      auto first = roles.begin() +
+                   (rectangle.row - key_row + row) * frame_width +
+                   rectangle.column;
+      std::fill(first, first + rectangle.width, rectangle.role);
+    }
+  }
+
+  for (unsigned row = 0; row != number_of_rows; ++row) {
+    const int *row_roles = roles.data() + row * frame_width;
+    unsigned column = 0;
+    while (column != frame_width) {
+      int role = row_roles[column];
+      unsigned length = 1;
+      while (column + length != frame_width &&
+             row_roles[column + length] == role) {
+        ++length;
+      }
+      Run run{key_row + row, column, length, role};
+      if (role >= 0) {
+        key_runs.push_back(run);
+      } else if (role != unpainted) {
+        static_runs.push_back(run);
+      }
+      column += length;
+    }
+  }
+
+  std::stable_sort(key_runs.begin(), key_runs.end(),
+                   [](const Run &a, const Run &b) { return a.role < b.role; });
+  for (const Run &run : key_runs) {
+    ++first_runs[run.role + 1];
+  }
+  for (unsigned key = 0; key != number_of_keys; ++key) {
+    first_runs[key + 1] += first_runs[key];
+  }
+}
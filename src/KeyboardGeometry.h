@@ -0,0 +1,207 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    KeyboardGeometry.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_KEYBOARDGEOMETRY_H
+#define OVERTONE_KEYBOARDGEOMETRY_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Pixel layout of the video frames: a border, the history, and the keyboard
+ * with 52 white and 36 black keys below the history.
+ *
+ * The layout is described by rectangles in drawing order, which are
+ * evaluated at compile time. The constructor compiles them into horizontal
+ * runs of the pixels that remain visible, grouped into the static runs
+ * (edges and separator) and the runs of each key.
+ */
+class KeyboardGeometry {
+public:
+  static constexpr unsigned frame_width = 1920;
+  static constexpr unsigned frame_height = 1080;
+
+  // width of the border around the frame
+  static constexpr unsigned border = 24;
+
+  static constexpr unsigned number_of_keys = 88;
+  static constexpr unsigned number_of_white_keys = 52;
+  static constexpr unsigned number_of_black_keys = 36;
+
+  // The history occupies the rows history_row ... key_row. The key row is
+  // the newest row of the history, it's drawn by the keys.
+  static constexpr unsigned history_row = border;
+  static constexpr unsigned key_row = 809;
+  static constexpr unsigned history_height = key_row - history_row + 1;
+
+  // horizontal separator between the history and the keyboard
+  static constexpr unsigned separator_row = key_row + 1;
+  static constexpr unsigned separator_height = 12;
+
+  // the keys below the separator
+  static constexpr unsigned keys_row = separator_row + separator_height;
+  static constexpr unsigned keys_end_row = frame_height - border;
+  static constexpr unsigned white_key_width = 36;
+  static constexpr unsigned white_key_edge = 2;
+  static constexpr unsigned black_key_width = 18;
+  static constexpr unsigned black_key_edge = 4;
+  static constexpr unsigned black_key_end_row = 980;
+
+  // roles of the rectangles besides the indices of the keys
+  static constexpr int edge = -1;
+  static constexpr int background = -2;
+
+  struct Rectangle {
+    unsigned row;
+    unsigned column;
+    unsigned height;
+    unsigned width;
+    int role;
+  };
+
+  // a horizontal run of pixels
+  struct Run {
+    unsigned row;
+    unsigned column;
+    unsigned length;
+    int role;
+  };
+
+  /**
+   * @param key index of the key (0 = A0, 87 = C8)
+   * @return true if the key is a black key
+   */
+  static constexpr bool is_black_key(unsigned key) {
+    unsigned note = key % 12;
+    return note == 1 || note == 4 || note == 6 || note == 9 || note == 11;
+  }
+
+  /**
+   * @param key index of the key
+   * @return number of white keys to the left of the key
+   */
+  static constexpr unsigned count_white_keys_below(unsigned key) {
+    unsigned count = 0;
+    for (unsigned index = 0; index != key; ++index) {
+      count += is_black_key(index) ? 0 : 1;
+    }
+    return count;
+  }
+
+  /**
+   * @param key index of the key
+   * @return leftmost column of the key including its edges
+   */
+  static constexpr unsigned get_key_column(unsigned key) {
+    unsigned boundary = border + white_key_width * count_white_keys_below(key);
+    // Black keys are centered on the boundary between two white keys.
+    return is_black_key(key) ? boundary - black_key_width / 2 : boundary;
+  }
+
+  static constexpr std::size_t number_of_rectangles =
+      3 * number_of_white_keys + 6 * number_of_black_keys + 1;
+
+  /**
+   * @return rectangles of the keyboard in drawing order
+   */
+  static constexpr std::array<Rectangle, number_of_rectangles>
+  get_rectangles() {
+    std::array<Rectangle, number_of_rectangles> rectangles{};
+    std::size_t index = 0;
+    const unsigned white_key_height = keys_end_row - key_row;
+    for (unsigned key = 0; key != number_of_keys; ++key) {
+      if (is_black_key(key)) {
+        continue;
+      }
+      unsigned column = get_key_column(key);
+      unsigned edge_height = keys_end_row - keys_row;
+      unsigned right_edge = column + white_key_width - white_key_edge;
+      rectangles[index++] = {keys_row, column, edge_height, white_key_edge,
+                             edge};
+      rectangles[index++] = {keys_row, right_edge, edge_height,
+                             white_key_edge, edge};
+      rectangles[index++] = {key_row, column + white_key_edge,
+                             white_key_height,
+                             white_key_width - 2 * white_key_edge,
+                             static_cast<int>(key)};
+    }
+    for (unsigned key = 0; key != number_of_keys; ++key) {
+      if (!is_black_key(key)) {
+        continue;
+      }
+      unsigned column = get_key_column(key);
+      unsigned edge_height = black_key_end_row - keys_row;
+      unsigned right_edge = column + black_key_width - black_key_edge;
+      unsigned interior_width = black_key_width - 2 * black_key_edge;
+      unsigned interior_end_row = black_key_end_row - black_key_edge;
+      // left and right edges, and the edge at the bottom
+      rectangles[index++] = {keys_row, column, edge_height, black_key_edge,
+                             edge};
+      rectangles[index++] = {keys_row, right_edge, edge_height,
+                             black_key_edge, edge};
+      rectangles[index++] = {interior_end_row, column + black_key_edge,
+                             black_key_edge, interior_width, edge};
+      // The sides of the key row are cleared.
+      rectangles[index++] = {key_row, column, 1, black_key_edge, background};
+      rectangles[index++] = {key_row, right_edge, 1, black_key_edge,
+                             background};
+      rectangles[index++] = {key_row, column + black_key_edge,
+                             interior_end_row - key_row, interior_width,
+                             static_cast<int>(key)};
+    }
+    rectangles[index++] = {separator_row, 0, separator_height, frame_width,
+                           edge};
+    return rectangles;
+  }
+
+  /**
+   * Compiles the rectangles into runs.
+   */
+  KeyboardGeometry();
+
+  /**
+   * @return runs of the edges and the cleared pixels, which don't change
+   */
+  const std::vector<Run> &get_static_runs() const { return static_runs; }
+
+  /**
+   * @return runs of all keys, sorted by the index of the key
+   */
+  const std::vector<Run> &get_key_runs() const { return key_runs; }
+
+  /**
+   * @param key index of the key
+   * @return index of the first run of the key in get_key_runs()
+   */
+  std::size_t get_first_run(unsigned key) const { return first_runs[key]; }
+
+private:
+  std::vector<Run> static_runs;
+  std::vector<Run> key_runs;
+
+  // key_runs[first_runs[key] ... first_runs[key + 1]] are the runs of a key
+  std::array<std::size_t, number_of_keys + 1> first_runs;
+};
+
+#endif // OVERTONE_KEYBOARDGEOMETRY_H
@@ -0,0 +1,54 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    KeyboardSource.h
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_KEYBOARDSOURCE_H
+#define OVERTONE_KEYBOARDSOURCE_H
+
+#include <memory>
+#include <vector>
+
+/**
+ * Interface of the objects that provide the 88 keys of the keyboard for each
+ * video frame, e.g., Keyboard.
+ */
+class KeyboardSource {
+public:
+  using Vector = std::vector<double>;
+
+  virtual ~KeyboardSource() = default;
+
+  /**
+   * Returns the keyboard of the current video frame.
+   * @return vector that contains the signal of each key of the keyboard
+   */
+  virtual std::shared_ptr<Vector> get_keyboard() const = 0;
+
+  /**
+   * Evaluates the keyboard of the next video frame if there is a next video
+   * frame.
+   * @return false if there is no next video frame
+   */
+  virtual bool go_to_next_frame() = 0;
+};
+
+#endif // OVERTONE_KEYBOARDSOURCE_H
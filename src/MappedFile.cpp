@@ -0,0 +1,72 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    MappedFile.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "MappedFile.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path) {
+  int file_descriptor = open(path.c_str(), O_RDONLY);
+  if (file_descriptor == -1) {
+    throw std::runtime_error("Couldn't open file: " + path);
+  }
+  struct stat status {};
+  if (fstat(file_descriptor, &status) == -1) {
+    close(file_descriptor);
+    throw std::runtime_error("Couldn't open file: " + path);
+  }
+  size = status.st_size;
+  if (size != 0) {
+    void *mapping =
+        mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if (mapping == MAP_FAILED) {
+      close(file_descriptor);
+      throw std::runtime_error("Couldn't map file: " + path);
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<const unsigned char *>(mapping);
+  }
+  close(file_descriptor);
+}
+
+MappedFile::~MappedFile() {
+  if (data != nullptr) {
+    munmap(const_cast<unsigned char *>(data), size);
+  }
+}
+
+void MappedFile::release(std::size_t end) {
+  // The pages get released in batches of at least 1 MiB.
+  const std::size_t minimum_release = 1 << 20;
+  std::size_t page_size = sysconf(_SC_PAGESIZE);
+  end = std::min(end, size) / page_size * page_size;
+  if (end >= released + minimum_release) {
+    madvise(const_cast<unsigned char *>(data) + released, end - released,
+            MADV_DONTNEED);
+    released = end;
+  }
+}
@@ -0,0 +1,72 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    MappedFile.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_MAPPEDFILE_H
+#define OVERTONE_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Read-only memory mapping of a whole file, which gets unmapped in the
+ * destructor.
+ */
+class MappedFile {
+public:
+  /**
+   * @param path path of the file
+   */
+  explicit MappedFile(const std::string &path);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile();
+
+  /**
+   * @return first byte of the file (nullptr if the file is empty)
+   */
+  const unsigned char *get_data() const { return data; }
+
+  /**
+   * @return size of the file in bytes
+   */
+  std::size_t get_size() const { return size; }
+
+  /**
+   * Releases the physical memory of the pages in front of `end`, which keeps
+   * the memory of a file that gets read forward bounded. Released pages get
+   * read from the file again if they're accessed afterwards.
+   * @param end offset behind the last byte that may be released
+   */
+  void release(std::size_t end);
+
+private:
+  const unsigned char *data{};
+  std::size_t size{};
+
+  // offset up to which the pages have been released
+  std::size_t released{};
+};
+
+#endif // OVERTONE_MAPPEDFILE_H
@@ -0,0 +1,253 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    MultirateSignal.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "MultirateSignal.h"
+#include "AudioStream.h"
+#include "KeyboardFrequencies.h"
+#include "WAVE.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+/**
+ * Decimates another audio source on demand.
+ */
+class DecimatedSource : public AudioSource {
+public:
+  /**
+   * @param parent signal that gets decimated
+   * @param chunk_size maximum number of samples that get decimated from one
+   *                   range of the parent
+   */
+  DecimatedSource(std::shared_ptr<AudioSource> parent, VectorSize chunk_size)
+      : parent(std::move(parent)), chunk_size(chunk_size),
+        decimated_samples(this->parent->get_number_of_channels()) {}
+
+  unsigned get_sample_rate() const override {
+    return parent->get_sample_rate() / 2;
+  }
+
+  VectorSize get_number_of_channels() const override {
+    return parent->get_number_of_channels();
+  }
+
+  VectorSize get_number_of_samples() const override {
+    return (parent->get_number_of_samples() + 1) / 2;
+  }
+
+  VectorSize count_samples(VectorSize limit) override {
+    return (parent->count_samples(2 * limit) + 1) / 2;
+  }
+
+  const double *get_samples(VectorSize channel,
+                            const VectorRange &time_range) override {
+    Vector &samples = decimated_samples.at(channel);
+    samples.resize(time_range.second - time_range.first);
+    destinations.assign(get_number_of_channels(), nullptr);
+    destinations[channel] = samples.data();
+    read(time_range, destinations.data());
+    return samples.data();
+  }
+
+  void read(const VectorRange &time_range,
+            double *const *destinations) override {
+    // The signal gets decimated in chunks, whose ranges of the parent are
+    // small enough for a parent stream. Within a chunk, all the channels are
+    // decimated from the same range of the parent, so a parent stream only
+    // moves forward.
+    // The parent is only counted up to the end of the range of a chunk, so a
+    // parent that is still being decoded doesn't have to be decoded further.
+    // The filters of the chunk don't reach beyond this end, so they are the
+    // same as with the full size of the parent.
+    const VectorSize reach = 2 * MultirateSignal::half_band_taps - 1;
+    for (VectorSize first = time_range.first; first < time_range.second;
+         first += chunk_size) {
+      VectorRange decimated_range(
+          first, std::min(first + chunk_size, time_range.second));
+      VectorSize parent_size =
+          parent->count_samples(2 * (decimated_range.second - 1) + reach + 1);
+      VectorRange parent_range(2 * first > reach ? 2 * first - reach : 0,
+                               parent_size);
+      for (VectorSize channel = 0; channel != get_number_of_channels();
+           ++channel) {
+        if (destinations[channel] == nullptr) {
+          continue;
+        }
+        MultirateSignal::decimate(
+            parent->get_samples(channel, parent_range), parent_range,
+            parent_size, decimated_range,
+            destinations[channel] + (first - time_range.first));
+      }
+    }
+  }
+
+private:
+  std::shared_ptr<AudioSource> parent;
+  VectorSize chunk_size;
+
+  // working buffers of get_samples()
+  std::vector<Vector> decimated_samples;
+  std::vector<double *> destinations;
+};
+} // namespace
+
+MultirateSignal::MultirateSignal(std::shared_ptr<AudioSource> source,
+                                 unsigned frame_rate,
+                                 VectorSize stream_capacity)
+    : frame_rate(frame_rate), stream_capacity(stream_capacity) {
+  if (frame_rate == 0 || source->get_sample_rate() % frame_rate) {
+    throw std::invalid_argument(
+        "This frame rate is not available. (sample rate % frame rate != 0)");
+  }
+  if (stream_capacity != 0) {
+    source = std::make_shared<AudioStream>(source,
+                                           stream_capacity + stream_margin);
+  }
+  levels.push_back(std::move(source));
+}
+
+unsigned MultirateSignal::find_level(KeyRange key_range) {
+  double maximum_frequency =
+      KeyboardFrequencies::key_to_frequency(key_range.second - 0.5);
+  unsigned level = 0;
+  while (true) {
+    if (level + 1 == levels.size() && !add_level()) {
+      return level;
+    }
+    double next_sample_rate = levels[level + 1]->get_sample_rate();
+    if (maximum_frequency > passband_edge * next_sample_rate) {
+      return level;
+    }
+    ++level;
+  }
+}
+
+bool MultirateSignal::add_level() {
+  unsigned sample_rate = levels.back()->get_sample_rate();
+  if (sample_rate % 2 || (sample_rate / 2) % frame_rate) {
+    return false;
+  }
+  VectorSize chunk_size = 4096;
+  if (stream_capacity != 0) {
+    // The range of a chunk, which reaches 2 half_band_taps - 1 samples beyond
+    // both ends, has to fit into the stream of the previous level.
+    VectorSize parent_capacity =
+        (stream_capacity >> (levels.size() - 1)) + stream_margin;
+    chunk_size =
+        std::min(chunk_size, parent_capacity / 2 - 2 * half_band_taps);
+  }
+  auto decimated_source =
+      std::make_shared<DecimatedSource>(levels.back(), chunk_size);
+  if (stream_capacity != 0) {
+    // Each stream buffers the same duration of the signal, and its margin
+    // covers the filters of the following levels.
+    VectorSize capacity = (stream_capacity >> levels.size()) + stream_margin;
+    levels.push_back(
+        std::make_shared<AudioStream>(decimated_source, capacity));
+    return true;
+  }
+
+  VectorSize size = decimated_source->get_number_of_samples();
+  std::vector<std::shared_ptr<Vector>> signal;
+  std::vector<double *> destinations;
+  for (VectorSize channel = 0;
+       channel != decimated_source->get_number_of_channels(); ++channel) {
+    signal.push_back(std::make_shared<Vector>(size));
+    destinations.push_back(signal.back()->data());
+  }
+  decimated_source->read({0, size}, destinations.data());
+  levels.push_back(std::make_shared<WAVE>(std::move(signal), sample_rate / 2));
+  return true;
+}
+
+MultirateSignal::Vector MultirateSignal::decimate(const Vector &signal) {
+  Vector decimated((signal.size() + 1) / 2);
+  decimate(signal.data(), {0, signal.size()}, signal.size(),
+           {0, decimated.size()}, decimated.data());
+  return decimated;
+}
+
+void MultirateSignal::decimate(const double *samples,
+                               const VectorRange &time_range, VectorSize size,
+                               const VectorRange &decimated_range,
+                               double *decimated) {
+  const Vector &filter = get_half_band_filter();
+  VectorSize margin = 2 * half_band_taps - 1;
+  for (VectorSize index = decimated_range.first;
+       index != decimated_range.second; ++index) {
+    VectorSize center = 2 * index;
+    // position of the center within `samples`
+    VectorSize position = center - time_range.first;
+    double sample = 0.5 * samples[position];
+    if (center >= margin && center + margin < size) {
+      for (unsigned tap = 0; tap != half_band_taps; ++tap) {
+        VectorSize offset = 2 * tap + 1;
+        sample += filter[tap] *
+                  (samples[position - offset] + samples[position + offset]);
+      }
+    } else {
+      for (unsigned tap = 0; tap != half_band_taps; ++tap) {
+        VectorSize offset = 2 * tap + 1;
+        if (center >= offset) {
+          sample += filter[tap] * samples[position - offset];
+        }
+        if (center + offset < size) {
+          sample += filter[tap] * samples[position + offset];
+        }
+      }
+    }
+    decimated[index - decimated_range.first] = sample;
+  }
+}
+
+const MultirateSignal::Vector &MultirateSignal::get_half_band_filter() {
+  static const Vector filter = evaluate_half_band_filter();
+  return filter;
+}
+
+MultirateSignal::Vector MultirateSignal::evaluate_half_band_filter() {
+  // The ideal half-band filter sin(pi n / 2) / (pi n) gets multiplied by a
+  // Kaiser window, whose parameter beta yields a stopband attenuation of about
+  // 90 dB.
+  const double beta = 8.96;
+  const double window_half_length = 2. * half_band_taps;
+  Vector filter;
+  filter.reserve(half_band_taps);
+  double sum = 0.;
+  for (unsigned tap = 0; tap != half_band_taps; ++tap) {
+    double index = 2. * tap + 1.;
+    double ideal = std::sin(M_PI * index / 2.) / (M_PI * index);
+    double ratio = index / window_half_length;
+    double window =
+        std::cyl_bessel_i(0., beta * std::sqrt(1. - ratio * ratio)) /
+        std::cyl_bessel_i(0., beta);
+    filter.push_back(ideal * window);
+    sum += filter.back();
+  }
+
+  // normalization to a gain of 1 at 0 Hz: 0.5 + 2 sum = 1
+  for (double &coefficient : filter) {
+    coefficient *= 0.25 / sum;
+  }
+  return filter;
+}
@@ -0,0 +1,149 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    MultirateSignal.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_MULTIRATESIGNAL_H
+#define OVERTONE_MULTIRATESIGNAL_H
+
+#include "AudioSource.h"
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Cascade of decimated versions of a PCM signal for the analysis of low key
+ * ranges.
+ *
+ * The level 0 is the original signal, and each further level halves the
+ * sample rate of the previous level via an anti-aliasing half-band filter.
+ * The filter is symmetric and centered (zero phase), so the sample m of the
+ * level l lies at the time of the sample m * 2^l of the original signal.
+ * A level only exists if its sample rate is still a multiple of the video
+ * frame rate, which keeps the audio frames aligned with the video frames.
+ * The levels get evaluated once, when they are requested the first time.
+ *
+ * In the streaming mode, each level is an AudioStream that decimates the
+ * stream of the previous level on demand, so the memory doesn't depend on
+ * the length of the signal. Otherwise, each level gets decoded completely and
+ * can be accessed in any order.
+ */
+class MultirateSignal {
+public:
+  using Vector = std::vector<double>;
+  using VectorSize = Vector::size_type;
+  using VectorRange = std::pair<VectorSize, VectorSize>;
+  using KeyRange = std::pair<unsigned char, unsigned char>;
+
+  // The half-band filter passes the frequencies up to passband_edge times the
+  // decimated sample rate with a deviation below 1e-4 and attenuates the
+  // frequencies that alias into this passband by more than 80 dB.
+  static constexpr double passband_edge = 0.4;
+
+  // number of nonzero filter coefficients on each side of the center tap
+  static constexpr unsigned half_band_taps = 16;
+
+  // additional samples per stream for the filters of the decimated levels
+  static constexpr VectorSize stream_margin = 128;
+
+  MultirateSignal() = default;
+
+  /**
+   * @param source PCM signal
+   * @param frame_rate video frame rate
+   * @param stream_capacity 0 for decoding the levels completely, otherwise
+   *                        the number of samples of the original sample rate
+   *                        that the streams of the levels have to buffer
+   */
+  MultirateSignal(std::shared_ptr<AudioSource> source, unsigned frame_rate,
+                  VectorSize stream_capacity = 0);
+
+  /**
+   * Returns the highest level, i.e., the lowest sample rate, whose passband
+   * still contains the key range, and evaluates the levels up to it.
+   * @param key_range key range
+   * @return level
+   */
+  unsigned find_level(KeyRange key_range);
+
+  /**
+   * Returns a level of the signal, which has to be evaluated already.
+   * @param level level (see find_level)
+   * @return decimated signal with the sample rate sample_rate / 2^level
+   */
+  std::shared_ptr<AudioSource> get_source(unsigned level) const {
+    return levels.at(level);
+  }
+
+  /**
+   * Halves the sample rate of a signal. The decimated signal has
+   * ceil(size / 2) samples, and the signal is zero-padded at both ends.
+   * @param signal PCM signal
+   * @return decimated PCM signal
+   */
+  static Vector decimate(const Vector &signal);
+
+  /**
+   * Evaluates a range of the decimated signal from a range of the signal.
+   * The signal has to be available from 2 decimated_range.first -
+   * 2 half_band_taps + 1 to 2 decimated_range.second + 2 half_band_taps - 2
+   * within the bounds of the signal.
+   * @param samples samples of the signal within `time_range`
+   * @param time_range time index range of `samples`
+   * @param size number of samples of the signal
+   * @param decimated_range time index range of the decimated signal
+   * @param decimated samples of the decimated signal within decimated_range
+   */
+  static void decimate(const double *samples, const VectorRange &time_range,
+                       VectorSize size, const VectorRange &decimated_range,
+                       double *decimated);
+
+  /**
+   * Returns the coefficients h_1, h_3, ..., h_(2 half_band_taps - 1) of the
+   * half-band filter. The center coefficient h_0 is 0.5, the coefficients with
+   * even nonzero indices are 0, and h_-n = h_n.
+   * @return odd filter coefficients
+   */
+  static const Vector &get_half_band_filter();
+
+private:
+  unsigned frame_rate{};
+
+  // number of samples per channel that the stream of the level 0 buffers
+  VectorSize stream_capacity{};
+
+  // the original signal followed by the decimated signals
+  std::vector<std::shared_ptr<AudioSource>> levels;
+
+  /**
+   * Evaluates the next level from the current highest level.
+   * @return false if the next level wouldn't be a multiple of the frame rate
+   */
+  bool add_level();
+
+  /**
+   * Evaluates the coefficients of the Kaiser-windowed half-band filter.
+   * @return odd filter coefficients
+   */
+  static Vector evaluate_half_band_filter();
+};
+
+#endif // OVERTONE_MULTIRATESIGNAL_H
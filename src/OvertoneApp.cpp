@@ -22,33 +22,87 @@
 ******************************************************************************/
 
 #include "OvertoneApp.h"
+#include "AnalysisCache.h"
+#include "AudioPipe.h"
 #include "ColorMap.h"
 #include "FFmpeg.h"
+#include "FrameRenderer.h"
 #include "Keyboard.h"
+#include "KeyboardBroadcast.h"
+#include "MultirateSignal.h"
+#include "ParallelKeyboard.h"
+#include "ParallelVideo.h"
+#include "ResonatorKeyboard.h"
 #include "Spectrum.h"
+#include "TaskPool.h"
+#include "VideoEncoder.h"
 #include "VideoFrame.h"
+#include "VideoPipeline.h"
+#include "VideoStatistics.h"
 #include "WAVE.h"
 
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <set>
+#include <sstream>
 #include <string>
-#include <sys/stat.h>
+#include <thread>
 #include <vector>
 
+namespace {
+// key ranges of the keyboard sections and their minimum numbers of samples per
+// audio frame
+const std::vector<std::pair<Spectrum::KeyRange, Spectrum::VectorSize>>
+    sections{{{0, 11}, 67000}, {{11, 22}, 44000}, {{22, 33}, 29000},
+             {{33, 46}, 15500}, {{46, 56}, 8500},  {{56, 74}, 5000},
+             {{74, 81}, 2500},  {{81, 88}, 1900}};
+
+// algorithm that evaluates all sections via a ResonatorKeyboard instead of
+// the spectra
+const std::string resonator_algorithm_name = "resonators";
+
+void print_statistics(const VideoStatistics &statistics) {
+  auto seconds = [](VideoStatistics::Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+  };
+  std::cout << std::fixed << std::setprecision(2);
+  for (unsigned stage = 0; stage != VideoStatistics::number_of_stages;
+       ++stage) {
+    const auto &stage_statistics = statistics.stages[stage];
+    std::cout << std::left << std::setw(10)
+              << VideoStatistics::get_stage_name(
+                     static_cast<VideoStatistics::Stage>(stage))
+              << std::right << std::setw(8)
+              << seconds(stage_statistics.busy_time) << " s busy"
+              << std::setw(8) << seconds(stage_statistics.waiting_time)
+              << " s waiting\n";
+  }
+  std::cout << "wall-clock time " << seconds(statistics.wall_clock_time)
+            << " s\n"
+            << "mean queue depths: keyboards "
+            << statistics.keyboard_queue.mean_depth << " / "
+            << statistics.keyboard_queue.capacity << ", frames "
+            << statistics.frame_queue.mean_depth << " / "
+            << statistics.frame_queue.capacity << std::endl;
+  std::cout << std::defaultfloat;
+}
+} // namespace
+
 OvertoneApp::OvertoneApp(int argc, char **argv)
-    : ffmpeg_executable_path("ffmpeg"), frame_rate(25), gain(35), gate(0),
-      theme("cyan"), history_speed(10) {
+    : ffmpeg_executable_path("ffmpeg"), frame_rate(25), algorithm("fft"),
+      number_of_threads(std::max(1u, std::thread::hardware_concurrency())),
+      streaming(false), decimation(true), print_pipeline_statistics(false),
+      gain(35), gate(0), theme("cyan"), history_speed(10),
+      number_of_video_frames(0) {
   for (int index = 0; index != argc; ++index) {
     arguments.emplace_back(argv[index]);
   }
   parse_arguments();
-  create_temporary_directory();
-  evaluate_the_file_paths();
-  create_frames_directory();
 }
 
-OvertoneApp::~OvertoneApp() { delete_temporary_files(); }
-
 void OvertoneApp::show_help_message() const {
   std::string title = "Overtone: A Music Visualizer (version 0.2.0)";
   std::string usage =
@@ -58,10 +112,21 @@ void OvertoneApp::show_help_message() const {
   descriptions_stream << std::left;
   int argument_length{25};
   std::string new_line = '\n' + std::string(argument_length, ' ');
-  descriptions_stream << std::setw(argument_length) << "  -c <channel>"
+  descriptions_stream << std::setw(argument_length) << "  -a <algorithm>"
+                      << "algorithm that evaluates the audio spectra"
+                      << new_line
+                      << "(or one per section, e.g., batched,batched,fft,...)"
+                      << new_line << "(default = " << algorithm << ")\n"
+
+                      << std::setw(argument_length) << "  -c <channel>"
                       << "use a specific audio channel instead of all channels"
                       << new_line << "(e.g., 0)\n"
 
+                      << std::setw(argument_length) << "  -C <directory>"
+                      << "cache the analysis of the audio in this directory"
+                      << new_line
+                      << "(skips the analysis if only -g, -G, -s, -t change)\n"
+
                       << std::setw(argument_length) << "  -f <frame rate>"
                       << "frame rate in frames per seconds (default = "
                       << frame_rate << ")\n"
@@ -82,10 +147,33 @@ void OvertoneApp::show_help_message() const {
                       << std::setw(argument_length) << "  -h, --help"
                       << "show this help message and exit\n"
 
+                      << std::setw(argument_length) << "  -j <threads>"
+                      << "number of threads that evaluate the audio spectra"
+                      << new_line << "and render the video frames (default = "
+                      << number_of_threads << ")\n"
+
+                      << std::setw(argument_length) << "  -M"
+                      << "analyse all sections at the full sample rate"
+                      << new_line
+                      << "(instead of decimating the low sections)\n"
+
+                      << std::setw(argument_length) << "  -o <theme:gain:file>"
+                      << "render another video from the same analysis"
+                      << new_line << "(e.g., fire:20:fire.mp4, repeatable)\n"
+
+                      << std::setw(argument_length) << "  -p"
+                      << "print the times of the stages of the video"
+                      << new_line << "(analysis, rendering, encoding)\n"
+
                       << std::setw(argument_length) << "  -s <history speed>"
                       << "speed of the history in pixels per video frame"
                       << new_line << "(default = " << history_speed << ")\n"
 
+                      << std::setw(argument_length) << "  -S"
+                      << "stream the audio with a bounded amount of memory"
+                      << new_line
+                      << "(analyses the sections of a frame concurrently)\n"
+
                       << std::setw(argument_length) << "  -t <theme>"
                       << "theme (default = " << theme << ")";
 
@@ -97,6 +185,12 @@ void OvertoneApp::show_help_message() const {
   for (const auto &theme_name : theme_names) {
     std::cout << "  -> " << theme_name << std::endl;
   }
+
+  std::cout << "\nAvailable algorithms:\n";
+  for (const auto &algorithm_name : Spectrum::get_algorithm_names()) {
+    std::cout << "  -> " << algorithm_name << std::endl;
+  }
+  std::cout << "  -> " << resonator_algorithm_name << std::endl;
 }
 
 void OvertoneApp::parse_arguments() {
@@ -107,7 +201,13 @@ void OvertoneApp::parse_arguments() {
   std::vector<std::string> positional_arguments;
   for (auto argument = ++arguments.cbegin(); argument != arguments.cend();
        ++argument) {
-    if (*argument == "-c") {
+    if (*argument == "-a") {
+      algorithm = parse_argument(argument, &OvertoneApp::to_string, false,
+                                 false, false);
+    } else if (*argument == "-C") {
+      cache_directory = parse_argument(argument, &OvertoneApp::to_string,
+                                       false, false, false);
+    } else if (*argument == "-c") {
       unsigned channel = parse_argument(argument, &OvertoneApp::to_unsigned,
                                         true, false, true);
       channels = {channel};
@@ -126,9 +226,21 @@ void OvertoneApp::parse_arguments() {
     } else if (*argument == "-h" || *argument == "--help") {
       show_help_message();
       std::exit(EXIT_SUCCESS);
+    } else if (*argument == "-j") {
+      number_of_threads =
+          parse_argument(argument, &OvertoneApp::to_unsigned, true, true, true);
+    } else if (*argument == "-M") {
+      decimation = false;
     } else if (*argument == "-s") {
       history_speed =
           parse_argument(argument, &OvertoneApp::to_unsigned, true, true, true);
+    } else if (*argument == "-o") {
+      additional_outputs.push_back(parse_argument(
+          argument, &OvertoneApp::to_output, false, false, false));
+    } else if (*argument == "-p") {
+      print_pipeline_statistics = true;
+    } else if (*argument == "-S") {
+      streaming = true;
     } else if (*argument == "-t") {
       theme = parse_argument(argument, &OvertoneApp::to_string, false, false,
                              false);
@@ -150,24 +262,63 @@ void OvertoneApp::parse_arguments() {
   } else {
     input_file_path.assign(positional_arguments[0]);
     video_path.assign(positional_arguments[1]);
-    std::ifstream video_file(video_path);
-    bool video_file_exists = video_file.good();
-    if (video_file_exists) {
-      std::cerr << "Error: The file '" + video_path + "' does already exist."
-                << std::endl;
-      std::exit(EXIT_FAILURE);
-    } else {
-      video_file.close();
-    }
-    if (!(video_path.size() >= 4 &&
-          std::string(video_path.cend() - 4, video_path.cend()) == ".mp4")) {
-      std::cerr << "Error: The name of the output file has to end with '.mp4'."
-                << std::endl;
-      std::exit(EXIT_FAILURE);
+    check_video_path(video_path);
+    std::set<std::string> video_paths{normalize_path(video_path)};
+    for (const auto &output : additional_outputs) {
+      check_video_path(output.video_path);
+      if (!video_paths.insert(normalize_path(output.video_path)).second) {
+        std::cerr << "Error: The file '" + output.video_path +
+                         "' is the output of several videos."
+                  << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
     }
   }
 }
 
+std::string OvertoneApp::normalize_path(const std::string &path) {
+  return std::filesystem::absolute(path).lexically_normal().string();
+}
+
+void OvertoneApp::check_video_path(const std::string &path) {
+  std::ifstream video_file(path);
+  bool video_file_exists = video_file.good();
+  if (video_file_exists) {
+    std::cerr << "Error: The file '" + path + "' does already exist."
+              << std::endl;
+    std::exit(EXIT_FAILURE);
+  } else {
+    video_file.close();
+  }
+  if (!(path.size() >= 4 &&
+        std::string(path.cend() - 4, path.cend()) == ".mp4")) {
+    std::cerr << "Error: The name of the output file has to end with '.mp4'."
+              << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+OvertoneApp::Output OvertoneApp::to_output(const std::string &s) {
+  // <theme>:<gain>:<video path>, where the video path may contain colons
+  auto first_colon = s.find(':');
+  auto second_colon = first_colon == std::string::npos
+                          ? std::string::npos
+                          : s.find(':', first_colon + 1);
+  if (second_colon == std::string::npos) {
+    throw std::invalid_argument(s);
+  }
+  Output output;
+  output.theme = s.substr(0, first_colon);
+  std::string gain = s.substr(first_colon + 1, second_colon - first_colon - 1);
+  std::size_t length = 0;
+  output.gain = std::stod(gain, &length);
+  if (length != gain.size() || output.gain < 0) {
+    throw std::invalid_argument(s);
+  }
+  output.video_path = s.substr(second_colon + 1);
+  return output;
+}
+
 template <typename T>
 T OvertoneApp::parse_argument(
     std::vector<std::string>::const_iterator &current_argument,
@@ -209,62 +360,105 @@ T OvertoneApp::parse_argument(
   return parsed_value;
 }
 
-void OvertoneApp::create_temporary_directory() {
-  char directory_template[] = "/tmp/Overtone.XXXXXX";
-  char *tmp_directory = mkdtemp(directory_template);
-  if (tmp_directory == nullptr) {
-    std::cerr << "The creation of the temporary directory failed." << std::endl;
-    std::exit(EXIT_FAILURE);
-  } else {
-    temporary_directory = std::string(tmp_directory);
-  }
-}
-
-void OvertoneApp::evaluate_the_file_paths() {
-  audio_file_path = temporary_directory + "/audio.wav";
-  frames_directory_path = temporary_directory + "/frames";
-}
-
-void OvertoneApp::create_frames_directory() {
-  if (mkdir(frames_directory_path.c_str(), 0775)) {
-    std::cerr << "Error: The directory '" << frames_directory_path
-              << "' does already exist. Please remove, move, or rename this "
-                 "directory."
-              << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-}
-
-void OvertoneApp::convert_input_file_to_wav() {
+void OvertoneApp::initialize_ffmpeg() {
   try {
-    ffmpeg = FFmpeg(input_file_path, audio_file_path, frames_directory_path,
-                    video_path, ffmpeg_executable_path, frame_rate);
+    ffmpeg =
+        FFmpeg(input_file_path, video_path, ffmpeg_executable_path, frame_rate);
   } catch (const std::exception &exception) {
     std::cerr << "Overtone: Error: " << exception.what() << std::endl;
     std::exit(EXIT_FAILURE);
   }
+}
 
-  // Converting the input file to a WAVE file via FFmpeg
+void OvertoneApp::decode_the_input_file() {
   try {
-    ffmpeg.convert_to_wave();
-  } catch (const FFmpeg::file_conversion_error &file_conversion_error) {
-    std::cout << file_conversion_error.what() << std::endl;
+    auto pipe = std::make_shared<AudioPipe>(ffmpeg.get_decoder_command());
+    if (streaming) {
+      audio = pipe;
+    } else {
+      // The samples get converted while FFmpeg decodes the following ones.
+      audio = std::make_shared<WAVE>(pipe->read_all(),
+                                     pipe->get_sample_rate());
+    }
+  } catch (const std::exception &exception) {
+    std::cerr << "Overtone: Error: FFmpeg failed to decode '"
+              << input_file_path << "': " << exception.what() << std::endl;
     std::exit(EXIT_FAILURE);
   }
 }
 
-void OvertoneApp::decode_wav_file() { wave = WAVE(audio_file_path); }
-
 void OvertoneApp::initialize_the_keyboard() {
   try {
-    keyboard = Keyboard({Spectrum(wave, channels, frame_rate, {0, 11}, 67000),
-                         Spectrum(wave, channels, frame_rate, {11, 22}, 44000),
-                         Spectrum(wave, channels, frame_rate, {22, 33}, 29000),
-                         Spectrum(wave, channels, frame_rate, {33, 46}, 15500),
-                         Spectrum(wave, channels, frame_rate, {46, 56}, 8500),
-                         Spectrum(wave, channels, frame_rate, {56, 74}, 5000),
-                         Spectrum(wave, channels, frame_rate, {74, 81}, 2500),
-                         Spectrum(wave, channels, frame_rate, {81, 88}, 1900)});
+    // The resonators process each sample once in ascending order, so they
+    // read a stream directly with a constant amount of memory (sequentially).
+    if (algorithm == resonator_algorithm_name) {
+      keyboard = std::make_shared<ResonatorKeyboard>(audio, channels,
+                                                     frame_rate, sections);
+      return;
+    }
+
+    // Either all sections use the same algorithm or each section has its
+    // own one.
+    std::vector<Spectrum::Algorithm> section_algorithms;
+    std::stringstream algorithm_names(algorithm);
+    std::string algorithm_name;
+    while (std::getline(algorithm_names, algorithm_name, ',')) {
+      section_algorithms.push_back(Spectrum::name_to_algorithm(algorithm_name));
+    }
+    if (section_algorithms.size() == 1) {
+      section_algorithms.resize(sections.size(), section_algorithms[0]);
+    } else if (section_algorithms.size() != sections.size()) {
+      throw std::invalid_argument(
+          "The number of algorithms has to be 1 or " +
+          std::to_string(sections.size()) + " (one per section).");
+    }
+
+    // A stream has to buffer the largest audio frame plus one video frame,
+    // or plus a batch of video frames for the batched algorithm.
+    Spectrum::VectorSize stream_capacity = 0;
+    if (streaming) {
+      Spectrum::VectorSize samples_per_video_frame =
+          audio->get_sample_rate() / frame_rate;
+      for (std::size_t index = 0; index != sections.size(); ++index) {
+        Spectrum::VectorSize video_frames =
+            section_algorithms[index] == Spectrum::Algorithm::batched
+                ? Spectrum::batch_size
+                : 1;
+        stream_capacity = std::max(
+            stream_capacity,
+            std::max(sections[index].second, samples_per_video_frame) +
+                video_frames * samples_per_video_frame);
+      }
+    }
+
+    // Each key range gets analysed at the lowest sample rate that still
+    // contains it (unless -M). The minimum numbers of samples refer to the
+    // original sample rate, so the audio frames keep their durations and the
+    // spectra keep their frequency resolutions.
+    MultirateSignal multirate_signal(audio, frame_rate, stream_capacity);
+    std::vector<Spectrum> spectra;
+    for (std::size_t index = 0; index != sections.size(); ++index) {
+      const auto &section = sections[index];
+      unsigned level =
+          decimation ? multirate_signal.find_level(section.first) : 0;
+      spectra.emplace_back(multirate_signal.get_source(level), channels,
+                           frame_rate, section.first, section.second >> level,
+                           section_algorithms[index]);
+    }
+    Keyboard sequential_keyboard(std::move(spectra));
+
+    // The frames of a stream have to be evaluated in ascending order, so the
+    // threads evaluate the channels of the sections of each frame instead.
+    if (number_of_threads > 1 && !streaming) {
+      keyboard = std::make_shared<ParallelKeyboard>(sequential_keyboard,
+                                                    number_of_threads);
+    } else {
+      if (number_of_threads > 1) {
+        sequential_keyboard.set_task_pool(
+            std::make_shared<TaskPool>(number_of_threads));
+      }
+      keyboard = std::make_shared<Keyboard>(std::move(sequential_keyboard));
+    }
   } catch (const std::exception &exception) {
     std::cerr << "Overtone: Error: " << exception.what() << std::endl;
     std::exit(EXIT_FAILURE);
@@ -272,46 +466,160 @@ void OvertoneApp::initialize_the_keyboard() {
 }
 
 unsigned OvertoneApp::evaluate_number_of_video_frames() {
-  auto number_of_audio_samples = wave.get_signal()[0]->size();
-  unsigned audio_sample_rate = wave.get_sample_rate();
+  // The length of a stream is unknown until it has been decoded.
+  if (streaming) {
+    return 0;
+  }
+  auto number_of_audio_samples = audio->get_number_of_samples();
+  unsigned audio_sample_rate = audio->get_sample_rate();
   double time_in_seconds = 1. * number_of_audio_samples / audio_sample_rate;
   unsigned number_of_frames = frame_rate * time_in_seconds;
   return number_of_frames;
 }
 
-void OvertoneApp::create_the_video() {
-  unsigned number_of_video_frames = evaluate_number_of_video_frames();
+bool OvertoneApp::load_the_analysis_cache() {
+  if (cache_directory.empty()) {
+    return false;
+  }
+  // everything that affects the keyboards besides the input file
+  std::stringstream parameters;
+  parameters << "frame rate " << frame_rate << ", algorithm " << algorithm
+             << ", channels";
+  for (unsigned channel : channels) {
+    parameters << " " << channel;
+  }
+  parameters << ", sections";
+  for (const auto &section : sections) {
+    parameters << " " << section.first.first << "-" << section.first.second
+               << ":" << section.second;
+  }
+  // The keys of the default analysis stay the same.
+  if (!decimation) {
+    parameters << ", full sample rate";
+  }
   try {
-    VideoFrame video_frame =
-        VideoFrame(ffmpeg, gain, gate, theme, history_speed, keyboard);
-    unsigned frame{1};
-    unsigned frame_index;
-    do {
-      unsigned percentage = frame * 100 / number_of_video_frames;
-      std::cout << percentage << " % (frame " << frame << " / "
-                << number_of_video_frames << ")          \r" << std::flush;
-      ++frame;
-      frame_index = frame - 2;
-    } while (video_frame.evaluate_frame(frame_index));
-    std::cout << std::endl;
+    analysis_cache = std::make_shared<AnalysisCache>(
+        cache_directory, input_file_path, parameters.str());
+    std::uint64_t number_of_cached_frames = 0;
+    auto cached_keyboard = analysis_cache->load(&number_of_cached_frames);
+    if (!cached_keyboard) {
+      return false;
+    }
+    keyboard = cached_keyboard;
+    number_of_video_frames = number_of_cached_frames;
   } catch (const std::exception &exception) {
     std::cerr << "Overtone: Error: " << exception.what() << std::endl;
     std::exit(EXIT_FAILURE);
   }
+  return true;
+}
 
-  ffmpeg.convert_to_mp4();
+void OvertoneApp::create_the_video() {
+  std::vector<Output> outputs{{theme, gain, video_path}};
+  outputs.insert(outputs.end(), additional_outputs.cbegin(),
+                 additional_outputs.cend());
+  try {
+    if (outputs.size() == 1) {
+      render_video(outputs.front(), keyboard, number_of_threads, true);
+    } else {
+      // The analysis is shared by all videos, which get rendered and encoded
+      // concurrently. The videos share the threads, the first ones get the
+      // remainder.
+      KeyboardBroadcast broadcast(keyboard, outputs.size());
+      std::vector<std::thread> threads;
+      std::vector<std::exception_ptr> exceptions(outputs.size());
+      unsigned number_of_outputs = outputs.size();
+      for (unsigned index = 0; index != number_of_outputs; ++index) {
+        unsigned number_of_render_threads =
+            std::max(1u, number_of_threads / number_of_outputs +
+                             (index < number_of_threads % number_of_outputs));
+        threads.emplace_back([&, index, number_of_render_threads] {
+          try {
+            render_video(outputs[index], broadcast.get_subscriber(index),
+                         number_of_render_threads, index == 0);
+          } catch (...) {
+            exceptions[index] = std::current_exception();
+          }
+        });
+      }
+      for (std::thread &thread : threads) {
+        thread.join();
+      }
+      for (const auto &exception : exceptions) {
+        if (exception) {
+          std::rethrow_exception(exception);
+        }
+      }
+    }
+  } catch (const std::exception &exception) {
+    std::cerr << "Overtone: Error: " << exception.what() << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
 }
 
-void OvertoneApp::delete_temporary_files() {
-  if (!temporary_directory.empty()) {
-    std::string command = "rm -r " + temporary_directory;
-    std::system(command.c_str());
+void OvertoneApp::render_video(const Output &output,
+                               std::shared_ptr<KeyboardSource> keyboard,
+                               unsigned number_of_render_threads,
+                               bool show_progress) {
+  auto print_progress = [&](unsigned frame) {
+    if (!show_progress) {
+      return;
+    }
+    if (number_of_video_frames == 0) {
+      std::cout << "frame " << frame << "          \r" << std::flush;
+      return;
+    }
+    unsigned percentage = frame * 100 / number_of_video_frames;
+    std::cout << percentage << " % (frame " << frame << " / "
+              << number_of_video_frames << ")          \r" << std::flush;
+  };
+  FFmpeg output_ffmpeg = ffmpeg;
+  output_ffmpeg.set_video_path(output.video_path);
+  auto encoder = std::make_shared<VideoEncoder>(output_ffmpeg, 1920, 1080);
+  if (number_of_render_threads > 1) {
+    // The video frames get rendered independently from the keyboards of the
+    // recent video frames.
+    auto renderer = std::make_shared<FrameRenderer>(
+        output.gain, gate, output.theme, history_speed);
+    ParallelVideo video(keyboard, renderer, encoder,
+                        number_of_render_threads);
+    video.run([&](ParallelVideo::FrameIndex number_of_written_frames) {
+      print_progress(number_of_written_frames);
+    });
+    if (show_progress) {
+      std::cout << std::endl;
+      if (print_pipeline_statistics) {
+        print_statistics(video.get_statistics());
+      }
+    }
+  } else {
+    // The keyboards, the video frames, and the encoding are evaluated
+    // concurrently.
+    auto video_frame = std::make_shared<VideoFrame>(
+        output.gain, gate, output.theme, history_speed);
+    VideoPipeline pipeline(keyboard, video_frame, encoder);
+    pipeline.run([&](VideoPipeline::FrameIndex number_of_written_frames) {
+      print_progress(number_of_written_frames);
+    });
+    if (show_progress) {
+      std::cout << std::endl;
+      if (print_pipeline_statistics) {
+        print_statistics(pipeline.get_statistics());
+      }
+    }
   }
+  encoder->finish();
 }
 
 void OvertoneApp::run() {
-  convert_input_file_to_wav();
-  decode_wav_file();
-  initialize_the_keyboard();
+  initialize_ffmpeg();
+  if (!load_the_analysis_cache()) {
+    decode_the_input_file();
+    initialize_the_keyboard();
+    number_of_video_frames = evaluate_number_of_video_frames();
+    if (analysis_cache) {
+      keyboard = analysis_cache->record(keyboard);
+    }
+  }
   create_the_video();
 }
@@ -24,15 +24,16 @@
 #ifndef OVERTONE_OVERTONEAPP_H
 #define OVERTONE_OVERTONEAPP_H
 
+#include "AnalysisCache.h"
+#include "AudioSource.h"
 #include "FFmpeg.h"
 #include "Keyboard.h"
+#include "KeyboardSource.h"
 #include "Spectrum.h"
-#include "WAVE.h"
 
 class OvertoneApp {
 public:
   OvertoneApp(int argc, char **argv);
-  ~OvertoneApp();
   void run();
 
 private:
@@ -68,15 +69,53 @@ private:
   static double to_double(const std::string &s) { return std::stod(s); };
   static std::string to_string(const std::string &s) { return s; };
 
-  void evaluate_the_file_paths();
-  void create_temporary_directory();
-  void create_frames_directory();
-  void convert_input_file_to_wav();
-  void decode_wav_file();
+  // a video that gets rendered from the analysis
+  struct Output {
+    std::string theme;
+    double gain;
+    std::string video_path;
+  };
+  static Output to_output(const std::string &s);
+
+  /**
+   * Exits if the video file already exists or isn't an MP4 file.
+   */
+  static void check_video_path(const std::string &path);
+
+  /**
+   * @return absolute path without "." and ".." elements, which is equal for
+   *         equal files
+   */
+  static std::string normalize_path(const std::string &path);
+
+  void initialize_ffmpeg();
+
+  /**
+   * Decodes the input file via an FFmpeg process, whose output gets read from
+   * a pipe (on demand if streaming).
+   */
+  void decode_the_input_file();
   void initialize_the_keyboard();
+
+  /**
+   * Opens the entry of the analysis cache if a cache directory is given.
+   * @return true if the keyboards have been loaded from the cache
+   */
+  bool load_the_analysis_cache();
   unsigned evaluate_number_of_video_frames();
   void create_the_video();
-  void delete_temporary_files();
+
+  /**
+   * Renders and encodes a video.
+   * @param output theme, gain, and path of the video
+   * @param keyboard provides the keyboard of each video frame
+   * @param number_of_render_threads number of threads that render the video
+   *                                 frames
+   * @param show_progress if true, prints the progress
+   */
+  void render_video(const Output &output,
+                    std::shared_ptr<KeyboardSource> keyboard,
+                    unsigned number_of_render_threads, bool show_progress);
 
   // command line arguments
   std::vector<std::string> arguments;
@@ -87,18 +126,33 @@ private:
   // path of the input file
   std::string input_file_path;
 
-  // path of the audio file that will be created fy FFmpeg
-  std::string audio_file_path;
-
-  // directory into which the frames will be saved
-  std::string frames_directory_path;
-
   // path of the final video
   std::string video_path;
 
   // video frame rate
   unsigned frame_rate;
 
+  // algorithm that evaluates the audio spectra
+  std::string algorithm;
+
+  // number of threads that evaluate the audio spectra
+  unsigned number_of_threads;
+
+  // if true, the audio gets decoded while it's analysed instead of at once
+  bool streaming;
+
+  // if true, the low key ranges get analysed at decimated sample rates
+  bool decimation;
+
+  // if true, the times of the stages of the video get printed
+  bool print_pipeline_statistics;
+
+  // directory of the analysis cache (no caching if empty)
+  std::string cache_directory;
+
+  // entry of the analysis cache of the input file
+  std::shared_ptr<AnalysisCache> analysis_cache;
+
   double gain;
   double gate;
   std::string theme;
@@ -106,19 +160,22 @@ private:
   // speed of the history in lines per video frame
   unsigned history_speed;
 
-  // decoded WAVE file
-  WAVE wave;
+  // videos besides the one of `video_path`, `theme`, and `gain`
+  std::vector<Output> additional_outputs;
+
+  // decoded audio signal (the pipe from FFmpeg if streaming)
+  std::shared_ptr<AudioSource> audio;
 
   FFmpeg ffmpeg;
 
   // audio spectrum projected onto the 88 keys of the keyboard
-  Keyboard keyboard;
+  std::shared_ptr<KeyboardSource> keyboard;
+
+  // number of video frames (0 if unknown)
+  unsigned number_of_video_frames;
 
   // indices of the audio channels used for the analysis
   std::vector<unsigned> channels;
-
-  // path of the temporary directory
-  std::string temporary_directory;
 };
 
 #endif // OVERTONE_OVERTONEAPP_H
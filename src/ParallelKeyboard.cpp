@@ -0,0 +1,133 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    ParallelKeyboard.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ParallelKeyboard.h"
+#include <algorithm>
+#include <stdexcept>
+
+ParallelKeyboard::ParallelKeyboard(const Keyboard &keyboard,
+                                   unsigned number_of_threads,
+                                   FrameIndex chunk_size,
+                                   FrameIndex buffer_size)
+    : number_of_frames(keyboard.get_number_of_frames()),
+      chunk_size(chunk_size),
+      keyboard(std::make_shared<Vector>(*keyboard.get_keyboard())) {
+  if (number_of_threads == 0 || chunk_size == 0) {
+    throw std::invalid_argument(
+        "The number of threads and the chunk size have to be nonzero.");
+  }
+  // The earliest unfinished chunk always fits into the buffer, so the workers
+  // can't block each other.
+  buffer_size = std::max(buffer_size, number_of_threads * chunk_size);
+  reorder_buffer.assign(buffer_size, {number_of_frames, Vector()});
+  workers.reserve(number_of_threads);
+  for (unsigned thread = 0; thread != number_of_threads; ++thread) {
+    workers.emplace_back(&ParallelKeyboard::work, this, keyboard);
+  }
+  // The keyboard of the first video frame is needed right away. If the signal
+  // is too short for a single video frame, `keyboard` keeps the keyboard that
+  // has been evaluated by the constructor of Keyboard.
+  receive(0);
+}
+
+ParallelKeyboard::~ParallelKeyboard() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  slot_freed.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+bool ParallelKeyboard::go_to_next_frame() {
+  return receive(current_frame + 1);
+}
+
+bool ParallelKeyboard::receive(FrameIndex frame_index) {
+  if (frame_index >= number_of_frames) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  // Moving the current video frame moves the window of the reorder buffer.
+  current_frame = frame_index;
+  slot_freed.notify_all();
+  Slot &slot = reorder_buffer[frame_index % reorder_buffer.size()];
+  slot_filled.wait(lock, [&] {
+    return slot.frame_index == frame_index || worker_exception;
+  });
+  if (worker_exception) {
+    std::rethrow_exception(worker_exception);
+  }
+  keyboard->swap(slot.keyboard);
+  slot.frame_index = number_of_frames;
+  lock.unlock();
+  slot_freed.notify_all();
+  return true;
+}
+
+void ParallelKeyboard::work(Keyboard keyboard) {
+  try {
+    while (true) {
+      FrameIndex first_frame;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        first_frame = next_chunk * chunk_size;
+        if (stopping || first_frame >= number_of_frames) {
+          return;
+        }
+        ++next_chunk;
+      }
+      FrameIndex last_frame =
+          std::min(first_frame + chunk_size, number_of_frames);
+      for (FrameIndex frame_index = first_frame; frame_index != last_frame;
+           ++frame_index) {
+        if (frame_index == first_frame) {
+          keyboard.go_to_frame(frame_index);
+        } else {
+          keyboard.go_to_next_frame();
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        Slot &slot = reorder_buffer[frame_index % reorder_buffer.size()];
+        slot_freed.wait(lock, [&] {
+          return stopping || (frame_index < current_frame +
+                                                reorder_buffer.size() &&
+                              slot.frame_index == number_of_frames);
+        });
+        if (stopping) {
+          return;
+        }
+        slot.keyboard.assign(keyboard.get_keyboard()->cbegin(),
+                             keyboard.get_keyboard()->cend());
+        slot.frame_index = frame_index;
+        lock.unlock();
+        slot_filled.notify_all();
+      }
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    worker_exception = std::current_exception();
+    slot_filled.notify_all();
+  }
+}
@@ -0,0 +1,121 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    ParallelKeyboard.h
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_PARALLELKEYBOARD_H
+#define OVERTONE_PARALLELKEYBOARD_H
+
+#include "Keyboard.h"
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+/**
+ * Evaluates the keyboards of the video frames in parallel.
+ *
+ * The keyboard of a video frame only depends on the audio samples of its own
+ * audio frame, so the video frames are split into chunks of consecutive video
+ * frames that the worker threads evaluate independently with their own copies
+ * of a Keyboard. The results are passed on in the order of the video frames
+ * through a bounded reorder buffer, which keeps the workers from running too
+ * far ahead of the consumer.
+ */
+class ParallelKeyboard : public KeyboardSource {
+public:
+  using FrameIndex = Keyboard::FrameIndex;
+
+  /**
+   * Starts the worker threads and waits for the keyboard of the first video
+   * frame.
+   * @param keyboard keyboard that gets copied by each worker thread
+   * @param number_of_threads number of worker threads (> 0)
+   * @param chunk_size number of consecutive video frames per chunk (> 0)
+   * @param buffer_size capacity of the reorder buffer in video frames (gets
+   *                    increased to number_of_threads * chunk_size if
+   *                    necessary)
+   */
+  ParallelKeyboard(const Keyboard &keyboard, unsigned number_of_threads,
+                   FrameIndex chunk_size = 16, FrameIndex buffer_size = 256);
+
+  ~ParallelKeyboard() override;
+
+  ParallelKeyboard(const ParallelKeyboard &) = delete;
+  ParallelKeyboard &operator=(const ParallelKeyboard &) = delete;
+
+  std::shared_ptr<Vector> get_keyboard() const override { return keyboard; }
+
+  bool go_to_next_frame() override;
+
+private:
+  // slot of the reorder buffer
+  struct Slot {
+    // index of the video frame whose keyboard is stored in the slot
+    // (number_of_frames if the slot is empty)
+    FrameIndex frame_index;
+    Vector keyboard;
+  };
+
+  const FrameIndex number_of_frames;
+  const FrameIndex chunk_size;
+
+  // keyboard of the current video frame
+  std::shared_ptr<Vector> keyboard;
+
+  // index of the current video frame (the workers only evaluate the video
+  // frames current_frame, ..., current_frame + reorder_buffer.size() - 1)
+  FrameIndex current_frame{};
+
+  // index of the next chunk that a worker thread will evaluate
+  FrameIndex next_chunk{};
+
+  std::vector<Slot> reorder_buffer;
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+
+  // notifies the workers that the consumer has freed a slot
+  std::condition_variable slot_freed;
+
+  // notifies the consumer that a worker has filled a slot
+  std::condition_variable slot_filled;
+
+  bool stopping{};
+
+  // exception thrown by a worker thread
+  std::exception_ptr worker_exception;
+
+  /**
+   * Evaluates chunks until all chunks have been evaluated.
+   * @param keyboard worker copy of the keyboard
+   */
+  void work(Keyboard keyboard);
+
+  /**
+   * Makes `frame_index` the current video frame, waits until its keyboard has
+   * been evaluated, and moves it into `keyboard`.
+   * @return false if there is no such frame
+   */
+  bool receive(FrameIndex frame_index);
+};
+
+#endif // OVERTONE_PARALLELKEYBOARD_H
@@ -0,0 +1,209 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    ParallelVideo.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ParallelVideo.h"
+#include <stdexcept>
+
+ParallelVideo::ParallelVideo(std::shared_ptr<KeyboardSource> keyboard,
+                             std::shared_ptr<const FrameRenderer> renderer,
+                             std::shared_ptr<VideoEncoder> encoder,
+                             unsigned number_of_threads)
+    : keyboard(std::move(keyboard)), renderer(std::move(renderer)),
+      encoder(std::move(encoder)), number_of_threads(number_of_threads) {
+  if (number_of_threads == 0) {
+    throw std::invalid_argument("The number of threads has to be nonzero.");
+  }
+  // Each worker renders at most one video frame ahead of the written ones,
+  // so the ring buffer holds the windows of all video frames in flight and
+  // one keyboard per worker that the reader may read ahead.
+  keyboards.resize(this->renderer->get_window_size() + 2 * number_of_threads);
+  statistics.keyboard_queue.capacity = keyboards.size();
+  statistics.frame_queue.capacity = number_of_threads;
+}
+
+void ParallelVideo::run(const std::function<void(FrameIndex)> &frame_written) {
+  const auto start = Clock::now();
+  std::vector<std::thread> workers;
+  workers.reserve(number_of_threads);
+  for (unsigned thread = 0; thread != number_of_threads; ++thread) {
+    workers.emplace_back(&ParallelVideo::work, this, std::cref(frame_written));
+  }
+  try {
+    read_keyboards();
+    std::unique_lock<std::mutex> lock(mutex);
+    progress.wait(lock, [&] {
+      return worker_exception ||
+             number_of_written_frames == number_of_keyboards;
+    });
+  } catch (...) {
+    stop();
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+    throw;
+  }
+  stop();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  if (worker_exception) {
+    std::rethrow_exception(worker_exception);
+  }
+
+  // The encoder waits whenever it doesn't write.
+  statistics.wall_clock_time = Clock::now() - start;
+  auto &encoding = statistics.stages[VideoStatistics::encoding];
+  encoding.waiting_time = statistics.wall_clock_time - encoding.busy_time;
+  if (number_of_keyboards != 0) {
+    statistics.keyboard_queue.mean_depth =
+        keyboard_depth_sum / number_of_keyboards;
+    statistics.frame_queue.mean_depth = frame_depth_sum / number_of_keyboards;
+  }
+}
+
+void ParallelVideo::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  progress.notify_all();
+}
+
+void ParallelVideo::read_keyboards() {
+  const auto start = Clock::now();
+  Clock::duration waiting_time{};
+  const FrameIndex window_size = renderer->get_window_size();
+  FrameIndex frame_index = 0;
+  do {
+    {
+      // The slot is free if the video frames that need its previous keyboard
+      // have been written.
+      const auto waiting_start = Clock::now();
+      std::unique_lock<std::mutex> lock(mutex);
+      progress.wait(lock, [&] {
+        return worker_exception || frame_index < keyboards.size() ||
+               frame_index - keyboards.size() + window_size <=
+                   number_of_written_frames;
+      });
+      waiting_time += Clock::now() - waiting_start;
+      if (worker_exception) {
+        return;
+      }
+    }
+    const Vector &current_keyboard = *keyboard->get_keyboard();
+    keyboards[frame_index % keyboards.size()].assign(
+        current_keyboard.cbegin(), current_keyboard.cend());
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      number_of_keyboards = ++frame_index;
+      keyboard_depth_sum += number_of_keyboards - next_frame;
+    }
+    progress.notify_all();
+  } while (keyboard->go_to_next_frame());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    all_keyboards_read = true;
+    auto &analysis = statistics.stages[VideoStatistics::analysis];
+    analysis.busy_time = Clock::now() - start - waiting_time;
+    analysis.waiting_time = waiting_time;
+  }
+  progress.notify_all();
+}
+
+void ParallelVideo::work(
+    const std::function<void(FrameIndex)> &frame_written) {
+  try {
+    const FrameIndex window_size = renderer->get_window_size();
+    FrameBuffer frame(KeyboardGeometry::frame_width,
+                      KeyboardGeometry::frame_height);
+    std::vector<const Vector *> window;
+    VideoStatistics::StageStatistics rendering;
+    Clock::duration encoding_time{};
+    while (true) {
+      FrameIndex frame_index;
+      auto time = Clock::now();
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        progress.wait(lock, [&] {
+          return stopping || next_frame < number_of_keyboards ||
+                 all_keyboards_read;
+        });
+        if (stopping || next_frame == number_of_keyboards) {
+          break;
+        }
+        frame_index = next_frame++;
+      }
+      auto previous_time = time;
+      time = Clock::now();
+      rendering.waiting_time += time - previous_time;
+
+      window.clear();
+      FrameIndex first_frame =
+          frame_index + 1 >= window_size ? frame_index + 1 - window_size : 0;
+      for (FrameIndex index = first_frame; index <= frame_index; ++index) {
+        window.push_back(&keyboards[index % keyboards.size()]);
+      }
+      renderer->render(window, frame);
+      previous_time = time;
+      time = Clock::now();
+      rendering.busy_time += time - previous_time;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++number_of_rendered_frames;
+        frame_depth_sum += number_of_rendered_frames - number_of_written_frames;
+        progress.wait(lock, [&] {
+          return stopping || number_of_written_frames == frame_index;
+        });
+        if (stopping) {
+          break;
+        }
+      }
+      previous_time = time;
+      time = Clock::now();
+      rendering.waiting_time += time - previous_time;
+
+      // Only the worker of the next video frame gets here.
+      encoder->write_rows(frame, 0, KeyboardGeometry::frame_height);
+      frame_written(frame_index + 1);
+      encoding_time += Clock::now() - time;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        number_of_written_frames = frame_index + 1;
+      }
+      progress.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &stages = statistics.stages;
+    stages[VideoStatistics::rendering].busy_time += rendering.busy_time;
+    stages[VideoStatistics::rendering].waiting_time += rendering.waiting_time;
+    stages[VideoStatistics::encoding].busy_time += encoding_time;
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!worker_exception) {
+      worker_exception = std::current_exception();
+    }
+    stopping = true;
+    progress.notify_all();
+  }
+}
@@ -0,0 +1,143 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    ParallelVideo.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_PARALLELVIDEO_H
+#define OVERTONE_PARALLELVIDEO_H
+
+#include "FrameRenderer.h"
+#include "KeyboardSource.h"
+#include "VideoEncoder.h"
+#include "VideoStatistics.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Renders the video frames in parallel and passes them to the encoder in
+ * order.
+ *
+ * The calling thread reads the keyboards of the video frames one after
+ * another and keeps the keyboards of the recent video frames in a ring
+ * buffer. The worker threads render the video frames from these keyboards
+ * with a shared FrameRenderer. A rendered video frame waits until all
+ * previous video frames have been written (an ordered sink), so each worker
+ * has at most one video frame in flight.
+ */
+class ParallelVideo {
+public:
+  using Vector = KeyboardSource::Vector;
+  using FrameIndex = std::size_t;
+  using Clock = VideoStatistics::Clock;
+
+  /**
+   * @param keyboard provides the keyboard of each video frame
+   * @param renderer renders the video frames
+   * @param encoder encodes the video frames
+   * @param number_of_threads number of worker threads (> 0)
+   */
+  ParallelVideo(std::shared_ptr<KeyboardSource> keyboard,
+                std::shared_ptr<const FrameRenderer> renderer,
+                std::shared_ptr<VideoEncoder> encoder,
+                unsigned number_of_threads);
+
+  ParallelVideo(const ParallelVideo &) = delete;
+  ParallelVideo &operator=(const ParallelVideo &) = delete;
+
+  /**
+   * Renders and encodes all video frames.
+   * @param frame_written gets called with the number of written video frames
+   *                      after each video frame
+   */
+  void run(const std::function<void(FrameIndex)> &frame_written);
+
+  /**
+   * Returns the statistics of the stages and queues after run(). The times
+   * of the rendering stage are summed over the worker threads. The keyboard
+   * queue is the ring buffer of keyboards that haven't been taken by a
+   * worker yet, and the frame queue holds the rendered video frames that
+   * wait for their turn. The encoder waits while the next video frame isn't
+   * rendered yet.
+   * @return statistics
+   */
+  const VideoStatistics &get_statistics() const { return statistics; }
+
+private:
+  std::shared_ptr<KeyboardSource> keyboard;
+  std::shared_ptr<const FrameRenderer> renderer;
+  std::shared_ptr<VideoEncoder> encoder;
+  unsigned number_of_threads;
+
+  // keyboards of the recent video frames (slot = frame index % size)
+  std::vector<Vector> keyboards;
+
+  // number of keyboards that have been read
+  FrameIndex number_of_keyboards{};
+
+  // true if the keyboard of the last video frame has been read
+  bool all_keyboards_read{};
+
+  // index of the next video frame that a worker thread will render
+  FrameIndex next_frame{};
+
+  // number of video frames that the worker threads have rendered
+  FrameIndex number_of_rendered_frames{};
+
+  // number of video frames that have been passed to the encoder
+  FrameIndex number_of_written_frames{};
+
+  std::mutex mutex;
+
+  // notifies the threads that a keyboard has been read, a video frame has
+  // been written, or a thread has failed
+  std::condition_variable progress;
+
+  bool stopping{};
+
+  // exception thrown by a worker thread
+  std::exception_ptr worker_exception;
+
+  VideoStatistics statistics;
+
+  // sums of the queue depths right after each push
+  double keyboard_depth_sum{};
+  double frame_depth_sum{};
+
+  /**
+   * Renders and writes video frames until all video frames have been
+   * written.
+   */
+  void work(const std::function<void(FrameIndex)> &frame_written);
+
+  /**
+   * Reads the keyboards of all video frames into the ring buffer.
+   */
+  void read_keyboards();
+
+  void stop();
+};
+
+#endif // OVERTONE_PARALLELVIDEO_H
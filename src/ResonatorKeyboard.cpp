@@ -0,0 +1,253 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    ResonatorKeyboard.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ResonatorKeyboard.h"
+#include "KeyboardFrequencies.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <string>
+
+ResonatorKeyboard::ResonatorKeyboard(std::shared_ptr<AudioSource> source,
+                                     const std::vector<unsigned> &channels,
+                                     unsigned frame_rate,
+                                     const std::vector<Section> &sections)
+    : source(std::move(source)),
+      samples_per_video_frame(this->source->get_sample_rate() / frame_rate) {
+  if (frame_rate == 0 || this->source->get_sample_rate() % frame_rate) {
+    throw std::invalid_argument(
+        "This frame rate is not available. (sample rate % frame rate != 0)");
+  }
+  VectorSize number_of_channels = this->source->get_number_of_channels();
+  for (auto channel : channels) {
+    if (channel >= number_of_channels) {
+      throw std::invalid_argument("Channel " + std::to_string(channel) +
+                                  " does not exist.");
+    }
+  }
+  std::vector<unsigned> unique_channels = channels;
+  std::sort(unique_channels.begin(), unique_channels.end());
+  auto unique_end = std::unique(unique_channels.begin(), unique_channels.end());
+  if (unique_end != unique_channels.cend()) {
+    throw std::invalid_argument("The elements of channels are not unique.");
+  }
+  if (channels.empty()) {
+    for (unsigned channel = 0; channel != number_of_channels; ++channel) {
+      this->channels.push_back(channel);
+    }
+  } else {
+    this->channels = channels;
+  }
+
+  std::vector<bool> covered_keys(88);
+  for (const auto &section : sections) {
+    const KeyRange &key_range = section.first;
+    if (key_range.first > 87 || key_range.second > 88 ||
+        key_range.second <= key_range.first) {
+      throw std::invalid_argument(
+          "0 <= key_range.first < key_range.second <= 88 not fulfilled.");
+    }
+    for (unsigned key = key_range.first; key != key_range.second; ++key) {
+      if (covered_keys[key]) {
+        throw std::invalid_argument("The sections overlap.");
+      }
+      covered_keys[key] = true;
+    }
+  }
+
+  // The audio frames of the sections are the ones of Spectrum, and each
+  // resonator gets sampled at the end of the audio frame, since the mean
+  // delay of the leaky integrator, lambda / (1 - lambda), is the one of a
+  // rectangular window of N samples.
+  std::vector<Section> sorted_sections = sections;
+  auto half_missing_samples = [this](const Section &section) {
+    VectorSize minimum_samples = section.second;
+    return samples_per_video_frame >= minimum_samples
+               ? VectorSize(0)
+               : (minimum_samples - samples_per_video_frame) / 2;
+  };
+  std::stable_sort(sorted_sections.begin(), sorted_sections.end(),
+                   [&](const Section &lhs, const Section &rhs) {
+                     return half_missing_samples(lhs) <
+                            half_missing_samples(rhs);
+                   });
+  double sample_rate = this->source->get_sample_rate();
+  for (const auto &section : sorted_sections) {
+    VectorSize half_missing = half_missing_samples(section);
+    VectorSize number_of_samples = samples_per_video_frame + 2 * half_missing;
+    double lambda = (number_of_samples - 1.) / (number_of_samples + 1.);
+    VectorSize first = resonator_keys.size();
+    for (unsigned key = section.first.first; key != section.first.second;
+         ++key) {
+      double frequency = KeyboardFrequencies::key_to_frequency(key);
+      // Keys at or above the Nyquist frequency would alias and remain 0.
+      if (2. * frequency >= sample_rate) {
+        continue;
+      }
+      double omega = 2. * M_PI * frequency / sample_rate;
+      resonator_keys.push_back(static_cast<unsigned char>(key));
+      rotation_real_parts.push_back(lambda * std::cos(omega));
+      rotation_imaginary_parts.push_back(lambda * std::sin(omega));
+      input_gains.push_back(1. - lambda);
+    }
+    VectorSize first_sampling_time = samples_per_video_frame + half_missing;
+    if (!groups.empty() &&
+        groups.back().first_sampling_time == first_sampling_time) {
+      groups.back().last = resonator_keys.size();
+    } else if (first != resonator_keys.size()) {
+      groups.push_back({first, resonator_keys.size(), first_sampling_time, 0});
+    }
+  }
+
+  real_parts.assign(this->channels.size(), Vector(resonator_keys.size()));
+  imaginary_parts = real_parts;
+
+  // A video frame is complete when the last group samples it, by then the
+  // other groups have sampled at most the frames in between.
+  VectorSize number_of_pending_keyboards = 1;
+  if (!groups.empty()) {
+    number_of_pending_keyboards +=
+        (groups.back().first_sampling_time -
+         groups.front().first_sampling_time) /
+            samples_per_video_frame +
+        1;
+  }
+  pending_keyboards.assign(number_of_pending_keyboards, Vector(88));
+
+  buffers.assign(number_of_channels, Vector(samples_per_video_frame));
+  for (auto &buffer : buffers) {
+    destinations.push_back(buffer.data());
+  }
+
+  evaluate_frame(0);
+}
+
+bool ResonatorKeyboard::go_to_next_frame() {
+  FrameIndex next_frame_index = frame_index + 1;
+  VectorSize end = (next_frame_index + 1) * samples_per_video_frame;
+  if (source->count_samples(end) != end) {
+    return false;
+  }
+  evaluate_frame(next_frame_index);
+  frame_index = next_frame_index;
+  return true;
+}
+
+void ResonatorKeyboard::evaluate_frame(FrameIndex frame_index) {
+  Vector &pending_keyboard =
+      pending_keyboards[frame_index % pending_keyboards.size()];
+  auto sampling_time = [this](const Group &group) {
+    return group.next_frame * samples_per_video_frame +
+           group.first_sampling_time;
+  };
+  if (!groups.empty()) {
+    while (groups.back().next_frame <= frame_index) {
+      // The group that samples next, the earliest group wins a tie.
+      Group *next_group = &groups.front();
+      for (auto &group : groups) {
+        if (sampling_time(group) < sampling_time(*next_group)) {
+          next_group = &group;
+        }
+      }
+      process(sampling_time(*next_group));
+      sample(*next_group, next_group->next_frame);
+      ++next_group->next_frame;
+    }
+  }
+  if (keyboard && keyboard.use_count() == 1) {
+    *keyboard = pending_keyboard;
+  } else {
+    keyboard = std::make_shared<Vector>(pending_keyboard);
+  }
+}
+
+void ResonatorKeyboard::process(VectorSize end) {
+  VectorSize number_of_resonators = resonator_keys.size();
+  const double *rotation_real = rotation_real_parts.data();
+  const double *rotation_imaginary = rotation_imaginary_parts.data();
+  const double *gains = input_gains.data();
+  VectorSize signal_end = source->count_samples(end);
+  while (time_index < signal_end) {
+    VectorSize chunk_end =
+        std::min(signal_end, time_index + samples_per_video_frame);
+    source->read({time_index, chunk_end}, destinations.data());
+    for (VectorSize index = 0; index != channels.size(); ++index) {
+      const double *samples = buffers[channels[index]].data();
+      double *real = real_parts[index].data();
+      double *imaginary = imaginary_parts[index].data();
+      for (VectorSize time = 0; time != chunk_end - time_index; ++time) {
+        double sample = samples[time];
+        // y = lambda exp(i omega) y + (1 - lambda) x
+        for (VectorSize resonator = 0; resonator != number_of_resonators;
+             ++resonator) {
+          double re = real[resonator];
+          double im = imaginary[resonator];
+          real[resonator] = rotation_real[resonator] * re -
+                            rotation_imaginary[resonator] * im +
+                            gains[resonator] * sample;
+          imaginary[resonator] = rotation_imaginary[resonator] * re +
+                                 rotation_real[resonator] * im;
+        }
+      }
+    }
+    time_index = chunk_end;
+  }
+
+  // The samples after the end of the signal are zero, like the samples
+  // outside of the clipped audio frames of Spectrum, so the states only get
+  // rotated and decay: y = (lambda exp(i omega))^k y.
+  if (time_index < end) {
+    double number_of_zeros = static_cast<double>(end - time_index);
+    for (VectorSize resonator = 0; resonator != number_of_resonators;
+         ++resonator) {
+      std::complex<double> rotation = std::pow(
+          std::complex<double>(rotation_real[resonator],
+                               rotation_imaginary[resonator]),
+          number_of_zeros);
+      for (VectorSize index = 0; index != channels.size(); ++index) {
+        std::complex<double> state =
+            rotation * std::complex<double>(real_parts[index][resonator],
+                                            imaginary_parts[index][resonator]);
+        real_parts[index][resonator] = state.real();
+        imaginary_parts[index][resonator] = state.imag();
+      }
+    }
+    time_index = end;
+  }
+}
+
+void ResonatorKeyboard::sample(const Group &group, FrameIndex frame_index) {
+  Vector &pending_keyboard =
+      pending_keyboards[frame_index % pending_keyboards.size()];
+  double normalization = 2. / channels.size();
+  for (VectorSize resonator = group.first; resonator != group.last;
+       ++resonator) {
+    double magnitude = 0.;
+    for (VectorSize index = 0; index != channels.size(); ++index) {
+      magnitude += std::hypot(real_parts[index][resonator],
+                              imaginary_parts[index][resonator]);
+    }
+    pending_keyboard[resonator_keys[resonator]] = normalization * magnitude;
+  }
+}
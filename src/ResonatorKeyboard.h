@@ -0,0 +1,153 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    ResonatorKeyboard.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_RESONATORKEYBOARD_H
+#define OVERTONE_RESONATORKEYBOARD_H
+
+#include "AudioSource.h"
+#include "KeyboardSource.h"
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Time-domain alternative to Keyboard, which evaluates the keys via a bank of
+ * 88 complex resonators instead of windowed transforms.
+ *
+ * The resonator of a key demodulates the signal with a leaky integrator,
+ * y_n = lambda exp(i omega) y_n-1 + (1 - lambda) x_n, so a sinusoid with the
+ * amplitude A at the center of the key yields 2 |y| = A. The bandwidth of a
+ * resonator matches the audio frame of its section: lambda = (N - 1) / (N + 1)
+ * has the same equivalent noise bandwidth as a rectangular window of N
+ * samples. The resonators of a section get sampled half an audio frame after
+ * the center of each video frame, so the keys stay aligned with the centered
+ * audio frames of Spectrum.
+ *
+ * Each sample gets processed once, at a cost of O(88) per sample and channel
+ * regardless of the lengths of the audio frames, and the samples are read
+ * in chunks of one video frame in ascending order, so the memory is constant
+ * and the source may be a stream.
+ */
+class ResonatorKeyboard : public KeyboardSource {
+public:
+  using VectorSize = Vector::size_type;
+  using KeyRange = std::pair<unsigned char, unsigned char>;
+  using FrameIndex = VectorSize;
+
+  // key range and minimum number of samples per audio frame of a section
+  using Section = std::pair<KeyRange, VectorSize>;
+
+  /**
+   * Evaluates the keyboard of the first video frame.
+   * @param source PCM signal
+   * @param channels selected channels (all channels if empty)
+   * @param frame_rate video frame rate
+   * @param sections non-overlapping sections of the keyboard, like the
+   *                 spectra of a Keyboard (keys outside of the sections
+   *                 remain 0)
+   */
+  ResonatorKeyboard(std::shared_ptr<AudioSource> source,
+                    const std::vector<unsigned> &channels, unsigned frame_rate,
+                    const std::vector<Section> &sections);
+
+  std::shared_ptr<Vector> get_keyboard() const override { return keyboard; }
+
+  bool go_to_next_frame() override;
+
+  /**
+   * @return number of video frames
+   */
+  FrameIndex get_number_of_frames() const {
+    return source->get_number_of_samples() / samples_per_video_frame;
+  }
+
+private:
+  // resonators whose keys get sampled at the same time
+  struct Group {
+    // first and last index of the resonators
+    VectorSize first;
+    VectorSize last;
+
+    // time index of the sampling of the video frame 0
+    VectorSize first_sampling_time;
+
+    // next video frame that gets sampled
+    FrameIndex next_frame;
+  };
+
+  std::shared_ptr<AudioSource> source;
+  std::vector<unsigned> channels;
+  const VectorSize samples_per_video_frame;
+
+  // keys of the resonators and their coefficients lambda cos(omega),
+  // lambda sin(omega), and 1 - lambda
+  std::vector<unsigned char> resonator_keys;
+  Vector rotation_real_parts;
+  Vector rotation_imaginary_parts;
+  Vector input_gains;
+
+  // states y of the resonators of each selected channel
+  std::vector<Vector> real_parts;
+  std::vector<Vector> imaginary_parts;
+
+  // groups sorted by their sampling times
+  std::vector<Group> groups;
+
+  // time index of the next sample that gets processed
+  VectorSize time_index{};
+
+  // keyboards of the video frames that have been sampled by some groups but
+  // not yet by the last group
+  std::vector<Vector> pending_keyboards;
+
+  FrameIndex frame_index{};
+
+  std::shared_ptr<Vector> keyboard;
+
+  // working buffers of the reads of all channels
+  std::vector<Vector> buffers;
+  std::vector<double *> destinations;
+
+  /**
+   * Samples the groups until the keyboard of a video frame is complete.
+   * @param frame_index index of the video frame
+   */
+  void evaluate_frame(FrameIndex frame_index);
+
+  /**
+   * Runs the resonators up to a time index, the samples after the end of
+   * the signal are zero.
+   * @param end time index of the first sample that doesn't get processed
+   */
+  void process(VectorSize end);
+
+  /**
+   * Stores the magnitudes of the resonators of a group, averaged over the
+   * channels, in the pending keyboard of a video frame.
+   * @param group group
+   * @param frame_index index of the video frame
+   */
+  void sample(const Group &group, FrameIndex frame_index);
+};
+
+#endif // OVERTONE_RESONATORKEYBOARD_H
@@ -0,0 +1,195 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    SPSCQueue.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_SPSCQUEUE_H
+#define OVERTONE_SPSCQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/**
+ * Bounded lock-free queue between a single producer thread and a single
+ * consumer thread, whose items are preallocated slots that are reused.
+ *
+ * The producer fills the slot returned by get_free_slot() in place and
+ * publishes it with push(). The consumer reads the slot returned by front()
+ * in place and hands it back with pop(). The positions of both sides are
+ * atomic counters, so neither side ever takes a lock. A side that has to
+ * wait (empty or full queue) spins briefly and then backs off by sleeping,
+ * and its waiting time is accumulated for the statistics.
+ */
+template <typename T> class SPSCQueue {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param slots preallocated items (slots.size() > 0)
+   */
+  explicit SPSCQueue(std::vector<T> slots) : slots(std::move(slots)) {
+    if (this->slots.empty()) {
+      throw std::invalid_argument("The queue needs at least one slot.");
+    }
+  }
+
+  SPSCQueue(const SPSCQueue &) = delete;
+  SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+  std::size_t get_capacity() const { return slots.size(); }
+
+  /**
+   * Producer: waits until a slot is free.
+   * @return the free slot, or nullptr if the queue has been cancelled
+   */
+  T *get_free_slot() {
+    const std::size_t position = tail.load(std::memory_order_relaxed);
+    if (!wait(producer_waiting_time, [&] {
+          return position - head.load(std::memory_order_acquire) <
+                 slots.size();
+        })) {
+      return nullptr;
+    }
+    return &slots[position % slots.size()];
+  }
+
+  /**
+   * Producer: publishes the slot returned by get_free_slot().
+   */
+  void push() {
+    const std::size_t position = tail.load(std::memory_order_relaxed) + 1;
+    tail.store(position, std::memory_order_release);
+    depth_sum += position - head.load(std::memory_order_acquire);
+    ++number_of_pushes;
+  }
+
+  /**
+   * Producer: signals that no further items will be pushed.
+   */
+  void close() { closed.store(true, std::memory_order_release); }
+
+  /**
+   * Consumer: waits until an item is available.
+   * @return the oldest item, or nullptr if the queue has been closed and is
+   *         empty, or if it has been cancelled
+   */
+  T *front() {
+    const std::size_t position = head.load(std::memory_order_relaxed);
+    if (!wait(consumer_waiting_time, [&] {
+          return tail.load(std::memory_order_acquire) != position ||
+                 closed.load(std::memory_order_acquire);
+        })) {
+      return nullptr;
+    }
+    // The tail has to be read again, since the queue may have been closed
+    // after the last push.
+    if (tail.load(std::memory_order_acquire) == position) {
+      return nullptr;
+    }
+    return &slots[position % slots.size()];
+  }
+
+  /**
+   * Consumer: hands the item returned by front() back to the producer.
+   */
+  void pop() {
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+  /**
+   * Either side: wakes up and stops both sides, e.g., after an exception.
+   */
+  void cancel() { cancelled.store(true, std::memory_order_release); }
+
+  /**
+   * @return mean number of items in the queue right after a push
+   *         (read it after the producer has finished)
+   */
+  double get_mean_depth() const {
+    return number_of_pushes ? static_cast<double>(depth_sum) / number_of_pushes
+                            : 0.;
+  }
+
+  /**
+   * @return time that the producer has waited for free slots
+   */
+  Clock::duration get_producer_waiting_time() const {
+    return producer_waiting_time;
+  }
+
+  /**
+   * @return time that the consumer has waited for items
+   */
+  Clock::duration get_consumer_waiting_time() const {
+    return consumer_waiting_time;
+  }
+
+private:
+  std::vector<T> slots;
+
+  // number of popped items (written by the consumer)
+  alignas(64) std::atomic<std::size_t> head{0};
+
+  // number of pushed items (written by the producer)
+  alignas(64) std::atomic<std::size_t> tail{0};
+
+  std::atomic<bool> closed{false};
+  std::atomic<bool> cancelled{false};
+
+  // statistics of the producer
+  alignas(64) std::size_t depth_sum{};
+  std::size_t number_of_pushes{};
+  Clock::duration producer_waiting_time{};
+
+  // statistics of the consumer
+  alignas(64) Clock::duration consumer_waiting_time{};
+
+  /**
+   * Waits until `ready` returns true.
+   * @return false if the queue has been cancelled
+   */
+  template <typename Predicate>
+  bool wait(Clock::duration &waiting_time, const Predicate &ready) {
+    if (ready()) {
+      return !cancelled.load(std::memory_order_acquire);
+    }
+    const auto start = Clock::now();
+    for (unsigned attempt = 0; !ready(); ++attempt) {
+      if (cancelled.load(std::memory_order_acquire)) {
+        break;
+      }
+      if (attempt < 64) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+    waiting_time += Clock::now() - start;
+    return !cancelled.load(std::memory_order_acquire);
+  }
+};
+
+#endif // OVERTONE_SPSCQUEUE_H
@@ -0,0 +1,95 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    SlidingDFT.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "SlidingDFT.h"
+#include "SpectrumKernels.h"
+#include <cmath>
+
+SlidingDFT::SlidingDFT(VectorSize size, VectorRange frequency_range,
+                       std::shared_ptr<const FFT::ComplexVector> twiddles)
+    : size(size), frequency_range(std::move(frequency_range)),
+      twiddles(std::move(twiddles)),
+      bins(this->frequency_range.second - this->frequency_range.first) {}
+
+std::shared_ptr<const FFT::ComplexVector>
+SlidingDFT::evaluate_twiddles(VectorSize size) {
+  auto twiddles = std::make_shared<FFT::ComplexVector>();
+  twiddles->reserve(size);
+  for (VectorSize index = 0; index != size; ++index) {
+    twiddles->push_back(
+        std::polar(1., -2. * M_PI * static_cast<double>(index) / size));
+  }
+  return twiddles;
+}
+
+void SlidingDFT::anchor(const double *samples, const VectorRange &time_range,
+                        FFT &fft, FFT::ComplexVector &fourier_transform) {
+  fft.transform(samples, fourier_transform);
+
+  // The FFT uses the beginning of the audio frame as the phase origin.
+  for (VectorSize frequency_index = frequency_range.first;
+       frequency_index != frequency_range.second; ++frequency_index) {
+    VectorSize twiddle_index = (frequency_index * time_range.first) % size;
+    bins[frequency_index - frequency_range.first] =
+        fourier_transform[frequency_index] * (*twiddles)[twiddle_index];
+  }
+}
+
+void SlidingDFT::slide(const double *samples,
+                       const VectorRange &previous_time_range,
+                       const VectorRange &time_range) {
+  accumulate(samples, {previous_time_range.first, time_range.first}, -1.);
+  accumulate(samples + (previous_time_range.second - previous_time_range.first),
+             {previous_time_range.second, time_range.second}, 1.);
+}
+
+void SlidingDFT::accumulate(const double *samples,
+                            const VectorRange &time_range, double sign) {
+  const FFT::Complex *twiddle_table = twiddles->data();
+  for (VectorSize frequency_index = frequency_range.first;
+       frequency_index != frequency_range.second; ++frequency_index) {
+    VectorSize twiddle_index = (frequency_index * time_range.first) % size;
+    VectorSize twiddle_step = frequency_index % size;
+    double real_part = 0.;
+    double imaginary_part = 0.;
+    for (VectorSize time_index = time_range.first;
+         time_index != time_range.second; ++time_index) {
+      const FFT::Complex &twiddle = twiddle_table[twiddle_index];
+      double sample = samples[time_index - time_range.first];
+      real_part += sample * twiddle.real();
+      imaginary_part += sample * twiddle.imag();
+      twiddle_index += twiddle_step;
+      if (twiddle_index >= size) {
+        twiddle_index -= size;
+      }
+    }
+    bins[frequency_index - frequency_range.first] +=
+        sign * FFT::Complex(real_part, imaginary_part);
+  }
+}
+
+void SlidingDFT::evaluate_spectrum(Vector &spectrum) const {
+  spectrum.resize(bins.size());
+  SpectrumKernels::magnitudes(reinterpret_cast<const double *>(bins.data()),
+                              bins.size(), size, spectrum.data());
+}
@@ -0,0 +1,113 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    SlidingDFT.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_SLIDINGDFT_H
+#define OVERTONE_SLIDINGDFT_H
+
+#include "FFT.h"
+#include <memory>
+
+/**
+ * Sliding discrete Fourier transform of a single channel.
+ *
+ * The bins X_k = sum_t x_t exp(-2 pi i k t / N) are evaluated with the
+ * absolute time index t as the phase origin. Moving the audio frame by h
+ * samples, therefore, only requires subtracting the h samples that leave the
+ * audio frame and adding the h samples that enter it, which costs O(h) instead
+ * of O(N) per bin. The rounding errors of these updates accumulate, so the bins
+ * should be re-anchored from time to time via anchor().
+ */
+class SlidingDFT {
+public:
+  using Vector = std::vector<double>;
+  using VectorSize = Vector::size_type;
+  using VectorRange = std::pair<VectorSize, VectorSize>;
+
+  SlidingDFT() = default;
+
+  /**
+   * @param size number of samples per audio frame
+   * @param frequency_range index range of the evaluated bins
+   * @param twiddles exp(-2 pi i m / size) for m = 0, ..., size - 1
+   *                 (shared between the channels)
+   */
+  SlidingDFT(VectorSize size, VectorRange frequency_range,
+             std::shared_ptr<const FFT::ComplexVector> twiddles);
+
+  /**
+   * Evaluates exp(-2 pi i m / size) for m = 0, ..., size - 1.
+   * @param size number of samples per audio frame
+   * @return twiddle factors
+   */
+  static std::shared_ptr<const FFT::ComplexVector>
+  evaluate_twiddles(VectorSize size);
+
+  /**
+   * Evaluates the bins from scratch.
+   * @param samples PCM signal of the channel within `time_range`
+   * @param time_range time index range of the audio frame
+   * @param fft FFT of the length time_range.second - time_range.first
+   * @param fourier_transform working buffer of the FFT
+   */
+  void anchor(const double *samples, const VectorRange &time_range, FFT &fft,
+              FFT::ComplexVector &fourier_transform);
+
+  /**
+   * Moves the audio frame from `previous_time_range` to `time_range`. Both
+   * ranges have to contain `size` samples and have to overlap.
+   * @param samples PCM signal of the channel from previous_time_range.first
+   *                to time_range.second
+   * @param previous_time_range current time index range of the audio frame
+   * @param time_range new time index range of the audio frame
+   */
+  void slide(const double *samples, const VectorRange &previous_time_range,
+             const VectorRange &time_range);
+
+  /**
+   * Evaluates the spectrum 2 |X_k| / N of the bins.
+   * @param spectrum spectrum (resized to the number of bins)
+   */
+  void evaluate_spectrum(Vector &spectrum) const;
+
+private:
+  // number of samples per audio frame
+  VectorSize size{};
+
+  // index range of the evaluated bins
+  VectorRange frequency_range;
+
+  // exp(-2 pi i m / size) for m = 0, ..., size - 1
+  std::shared_ptr<const FFT::ComplexVector> twiddles;
+
+  // the bins X_k for k within frequency_range
+  FFT::ComplexVector bins;
+
+  /**
+   * Adds sign * x_t exp(-2 pi i k t / N) to each bin for each t within
+   * `time_range`, where `samples` points to x_(time_range.first).
+   */
+  void accumulate(const double *samples, const VectorRange &time_range,
+                  double sign);
+};
+
+#endif // OVERTONE_SLIDINGDFT_H
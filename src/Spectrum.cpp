@@ -22,27 +22,27 @@
 ******************************************************************************/
 
 #include "Spectrum.h"
-#include "KeyboardFrequencies.h"
 #include <cmath>
 
-Spectrum::Spectrum(const WAVE &wave, const std::vector<unsigned> &channels,
+Spectrum::Spectrum(std::shared_ptr<AudioSource> source,
+                   const std::vector<unsigned> &channels,
                    const unsigned &frame_rate, KeyRange key_range,
-                   const VectorSize &minimum_samples)
-    : wave(wave), samples_per_video_frame(wave.get_sample_rate() / frame_rate),
+                   const VectorSize &minimum_samples, Algorithm algorithm)
+    : source(std::move(source)),
+      samples_per_video_frame(this->source->get_sample_rate() / frame_rate),
       time_range_video_frame(0, samples_per_video_frame),
       key_range(std::move(key_range)), minimum_samples(minimum_samples),
-      time_size(wave.get_signal()[0]->size()),
-      frequencies(std::make_shared<Vector>()) {
+      algorithm(algorithm) {
   if (key_range.first > 87 || key_range.second > 88 ||
       key_range.second <= key_range.first) {
     throw std::invalid_argument(
         "0 <= key_range.first < key_range.second <= 88 not fulfilled.");
   }
-  if (wave.get_sample_rate() % frame_rate) {
+  if (this->source->get_sample_rate() % frame_rate) {
     throw std::invalid_argument(
         "This frame rate is not available. (sample rate % frame rate != 0)");
   }
-  VectorSize number_of_channels = wave.get_signal().size();
+  VectorSize number_of_channels = this->source->get_number_of_channels();
   for (auto channel : channels) {
     if (channel >= number_of_channels) {
       throw std::invalid_argument("Channel " + std::to_string(channel) +
@@ -64,31 +64,177 @@ Spectrum::Spectrum(const WAVE &wave, const std::vector<unsigned> &channels,
   evaluate_frame();
 }
 
+Spectrum::Algorithm Spectrum::name_to_algorithm(const std::string &name) {
+  if (name == "direct") {
+    return Algorithm::direct;
+  } else if (name == "fft") {
+    return Algorithm::fft;
+  } else if (name == "sliding") {
+    return Algorithm::sliding;
+  } else if (name == "goertzel") {
+    return Algorithm::goertzel;
+  } else if (name == "batched") {
+    return Algorithm::batched;
+  } else if (name == "centered") {
+    return Algorithm::centered;
+  } else {
+    throw std::invalid_argument("Algorithm '" + name + "' not found.");
+  }
+}
+
+std::vector<std::string> Spectrum::get_algorithm_names() {
+  return {"direct", "fft", "sliding", "goertzel", "batched", "centered"};
+}
+
 bool Spectrum::go_to_next_frame() {
+  if (!begin_next_frame()) {
+    return false;
+  }
+  for (VectorSize index = 0; index != channels.size(); ++index) {
+    evaluate_channel(index);
+  }
+  finish_frame();
+  return true;
+}
+
+bool Spectrum::go_to_frame(VectorSize frame_index) {
+  if (!begin_frame(frame_index)) {
+    return false;
+  }
+  for (VectorSize index = 0; index != channels.size(); ++index) {
+    evaluate_channel(index);
+  }
+  finish_frame();
+  return true;
+}
+
+bool Spectrum::begin_next_frame() {
   time_range_video_frame.first += samples_per_video_frame;
   time_range_video_frame.second += samples_per_video_frame;
-  if (time_range_video_frame.second <= time_size) {
-    evaluate_frame();
+  if (source->count_samples(time_range_video_frame.second) ==
+      time_range_video_frame.second) {
+    prepare_frame();
     return true;
   } else {
     return false;
   }
 }
 
+bool Spectrum::begin_frame(VectorSize frame_index) {
+  VectorSize end = (frame_index + 1) * samples_per_video_frame;
+  if (source->count_samples(end) != end) {
+    return false;
+  }
+  time_range_video_frame.first = frame_index * samples_per_video_frame;
+  time_range_video_frame.second = end;
+  prepare_frame();
+  return true;
+}
+
 void Spectrum::evaluate_frame() {
-  VectorRange time_range = evaluate_time_range();
-  Vector all_frequencies =
-      evaluate_all_frequencies(time_range, wave.get_sample_rate());
-  VectorRange frequency_range =
-      KeyboardFrequencies::key_range_to_frequency_range(key_range,
-                                                        all_frequencies);
-  auto all_frequencies_begin = all_frequencies.cbegin();
-  frequencies->assign(all_frequencies_begin + frequency_range.first,
-                      all_frequencies_begin + frequency_range.second);
-  keys = std::make_shared<Vector>(
-      KeyboardFrequencies::frequencies_to_keys(*frequencies));
-  spectrum = std::make_shared<Vector>(evaluate_spectrum(
-      wave.get_signal(), channels, time_range, frequency_range));
+  prepare_frame();
+  for (VectorSize index = 0; index != channels.size(); ++index) {
+    evaluate_channel(index);
+  }
+  finish_frame();
+}
+
+void Spectrum::prepare_frame() {
+  audio_frame_range = evaluate_time_range();
+  plan = get_plan(audio_frame_range.second - audio_frame_range.first);
+  const VectorRange &frequency_range = plan->get_frequency_range();
+  anchor = algorithm == Algorithm::sliding &&
+           prepare_sliding_dfts(audio_frame_range, frequency_range);
+  if (algorithm == Algorithm::fft) {
+    prepare_fft(audio_frame_range.second - audio_frame_range.first);
+  }
+  channel_samples.resize(channels.size());
+  channel_spectra.resize(channels.size());
+  if (algorithm == Algorithm::batched) {
+    VectorRange batch_range = prepare_batch();
+    batch_dfts.resize(channels.size());
+    for (VectorSize index = 0; index != channels.size(); ++index) {
+      channel_samples[index] =
+          evaluate_batch ? source->get_samples(channels[index], batch_range)
+                         : nullptr;
+    }
+    return;
+  }
+  for (VectorSize index = 0; index != channels.size(); ++index) {
+    if (algorithm == Algorithm::sliding && !anchor) {
+      // the samples that leave and the samples that enter the audio frame
+      channel_samples[index] = source->get_samples(
+          channels[index],
+          {sliding_time_range.first, audio_frame_range.second});
+    } else {
+      channel_samples[index] =
+          source->get_samples(channels[index], audio_frame_range);
+    }
+  }
+}
+
+void Spectrum::evaluate_channel(VectorSize index) {
+  const VectorRange &frequency_range = plan->get_frequency_range();
+  const double *samples = channel_samples[index];
+  switch (algorithm) {
+  case Algorithm::direct:
+    evaluate_channel_spectrum(samples, audio_frame_range, frequency_range,
+                              channel_spectra[index]);
+    break;
+  case Algorithm::fft:
+    evaluate_channel_spectrum_fft(index, samples, audio_frame_range,
+                                  frequency_range, channel_spectra[index]);
+    break;
+  case Algorithm::sliding:
+    if (anchor) {
+      sliding_dfts[index].anchor(samples, audio_frame_range, ffts[index],
+                                 fourier_transforms[index]);
+    } else {
+      sliding_dfts[index].slide(samples, sliding_time_range, audio_frame_range);
+    }
+    sliding_dfts[index].evaluate_spectrum(channel_spectra[index]);
+    break;
+  case Algorithm::goertzel:
+  case Algorithm::centered:
+    evaluate_channel_spectrum_goertzel(samples, channel_spectra[index]);
+    break;
+  case Algorithm::batched:
+    evaluate_channel_spectrum_batched(index, samples, channel_spectra[index]);
+    break;
+  }
+}
+
+void Spectrum::finish_frame() {
+  sliding_time_range = audio_frame_range;
+
+  // Evaluating the average spectrum. The spectrum gets overwritten unless
+  // it's shared with a copy of this object or with a caller of
+  // get_spectrum().
+  spectrum_pointers.clear();
+  for (const Vector &current_spectrum : channel_spectra) {
+    spectrum_pointers.push_back(current_spectrum.data());
+  }
+  if (!spectrum || spectrum.use_count() != 1) {
+    spectrum = std::make_shared<Vector>();
+  }
+  spectrum->resize(channel_spectra[0].size());
+  SpectrumKernels::average(spectrum_pointers.data(), channels.size(),
+                           spectrum->size(), spectrum->data());
+}
+
+std::shared_ptr<const AnalysisPlan>
+Spectrum::get_plan(const VectorSize &number_of_samples) {
+  auto &cached_plan = plans[number_of_samples];
+  if (!cached_plan) {
+    AnalysisPlan::Frequencies frequencies =
+        algorithm == Algorithm::centered
+            ? AnalysisPlan::Frequencies::key_centered
+            : AnalysisPlan::Frequencies::uniform;
+    cached_plan = std::make_shared<AnalysisPlan>(
+        key_range, number_of_samples, source->get_sample_rate(), frequencies,
+        algorithm == Algorithm::batched);
+  }
+  return cached_plan;
 }
 
 Spectrum::VectorRange Spectrum::evaluate_time_range() {
@@ -104,96 +250,145 @@ Spectrum::VectorRange Spectrum::evaluate_time_range() {
       time_range.first = 0;
     }
     VectorSize new_index = time_range_video_frame.second + half_missing_samples;
-    if (new_index < time_size) {
-      time_range.second = new_index;
-    } else {
-      time_range.second = time_size;
-    }
+    // The source gets counted only up to new_index, so a source that is still
+    // being decoded doesn't have to be decoded until its end.
+    time_range.second = source->count_samples(new_index);
     return time_range;
   }
 }
 
-Spectrum::Vector
-Spectrum::evaluate_spectrum(const std::vector<std::shared_ptr<Vector>> &signal,
-                            const std::vector<unsigned> &channels,
-                            const VectorRange &time_range,
-                            const VectorRange &frequency_range) {
-  auto number_of_channels = channels.size();
+void Spectrum::evaluate_channel_spectrum(const double *samples,
+                                         const VectorRange &time_range,
+                                         const VectorRange &frequency_range,
+                                         Vector &spectrum) {
+  VectorSize number_of_samples = time_range.second - time_range.first;
+  // The phase origin is the beginning of the audio frame instead of the
+  // absolute time index, which doesn't change the absolute values.
+  spectrum.resize(frequency_range.second - frequency_range.first);
+  SpectrumKernels::direct(samples, number_of_samples, frequency_range.first,
+                          spectrum.size(), spectrum.data());
+}
+
+void Spectrum::evaluate_channel_spectrum_fft(
+    VectorSize index, const double *samples, const VectorRange &time_range,
+    const VectorRange &frequency_range, Vector &spectrum) {
+  VectorSize number_of_samples = time_range.second - time_range.first;
+  FFT::ComplexVector &fourier_transform = fourier_transforms[index];
+  ffts[index].transform(samples, fourier_transform);
 
-  std::vector<Vector> spectra;
-  spectra.reserve(number_of_channels);
-  for (const unsigned &channel : channels) {
-    spectra.emplace_back(evaluate_channel_spectrum(*signal[channel], time_range,
-                                                   frequency_range));
-  }
+  // The values of a std::complex are its real and imaginary parts.
+  spectrum.resize(frequency_range.second - frequency_range.first);
+  SpectrumKernels::magnitudes(
+      reinterpret_cast<const double *>(fourier_transform.data() +
+                                       frequency_range.first),
+      spectrum.size(), number_of_samples, spectrum.data());
+}
 
-  Vector returned_spectrum;
-  auto spectrum_size = spectra[0].size();
-  returned_spectrum.reserve(spectrum_size);
+void Spectrum::evaluate_channel_spectrum_goertzel(const double *samples,
+                                                  Vector &spectrum) {
+  const Vector &coefficients = plan->get_goertzel_coefficients();
+  spectrum.resize(coefficients.size());
+  SpectrumKernels::goertzel(samples,
+                            plan->get_number_of_samples(), coefficients.data(),
+                            coefficients.size(), spectrum.data());
+}
 
-  // Evaluating the average spectrum.
-  double accumulator;
-  for (VectorSize index = 0; index != spectrum_size; ++index) {
-    accumulator = 0;
-    for (const Vector &current_spectrum : spectra) {
-      accumulator += current_spectrum[index];
-    }
-    returned_spectrum.push_back(accumulator / number_of_channels);
+Spectrum::VectorRange Spectrum::prepare_batch() {
+  VectorSize frame_index =
+      time_range_video_frame.first / samples_per_video_frame;
+  evaluate_batch = plan != batch_plan || frame_index < batch_first_frame ||
+                   frame_index >= batch_first_frame + batch_number_of_frames;
+  if (!evaluate_batch) {
+    return {};
   }
-  return returned_spectrum;
-}
 
-Spectrum::Vector
-Spectrum::evaluate_channel_spectrum(const Vector &channel,
-                                    const VectorRange &time_range,
-                                    const VectorRange &frequency_range) {
-  Vector spectrum;
-  VectorSize number_of_samples = time_range.second - time_range.first;
-  spectrum.reserve(frequency_range.second - frequency_range.first);
-  double fourier_negative_imaginary_part;
-  double fourier_real_part;
-  double constant = 2 * M_PI / number_of_samples;
-  double current_sample;
-  double frequency_index_double;
-  for (VectorSize frequency_index = frequency_range.first;
-       frequency_index != frequency_range.second; ++frequency_index) {
-    fourier_negative_imaginary_part = 0;
-    fourier_real_part = 0;
-    frequency_index_double = frequency_index;
-    for (VectorSize time_index = time_range.first;
-         time_index != time_range.second; ++time_index) {
-      current_sample = channel[time_index];
-      fourier_negative_imaginary_part +=
-          (current_sample *
-           sin(constant * frequency_index_double * time_index));
-      fourier_real_part +=
-          (current_sample *
-           cos(constant * frequency_index_double * time_index));
-    }
-    spectrum.push_back(2. *
-                       abs(fourier_real_part, fourier_negative_imaginary_part) /
-                       number_of_samples);
+  // The following video frames belong to the batch as long as their audio
+  // frames are the current one shifted by whole video frames, i.e., as long
+  // as they aren't clipped at the end of the signal. An audio frame that is
+  // clipped at the beginning of the signal forms a batch of its own.
+  VectorSize number_of_samples =
+      audio_frame_range.second - audio_frame_range.first;
+  VectorSize unclipped_number_of_samples =
+      samples_per_video_frame >= minimum_samples
+          ? samples_per_video_frame
+          : samples_per_video_frame +
+                2 * ((minimum_samples - samples_per_video_frame) / 2);
+  batch_plan = plan;
+  batch_first_frame = frame_index;
+  batch_number_of_frames = 1;
+  if (number_of_samples == unclipped_number_of_samples) {
+    VectorSize end = audio_frame_range.second +
+                     (batch_size - 1) * samples_per_video_frame;
+    batch_number_of_frames +=
+        (source->count_samples(end) - audio_frame_range.second) /
+        samples_per_video_frame;
   }
-  return spectrum;
+  return {audio_frame_range.first,
+          audio_frame_range.second +
+              (batch_number_of_frames - 1) * samples_per_video_frame};
 }
 
-Spectrum::Vector
-Spectrum::evaluate_all_frequencies(const VectorRange &time_range,
-                                   const VectorSize &sample_rate) {
-  Vector frequencies;
-  VectorSize number_of_samples = time_range.second - time_range.first;
+void Spectrum::evaluate_channel_spectrum_batched(VectorSize index,
+                                                 const double *samples,
+                                                 Vector &spectrum) {
+  VectorSize number_of_bins =
+      plan->get_frequency_range().second - plan->get_frequency_range().first;
+  VectorSize number_of_samples = plan->get_number_of_samples();
+  Vector &dfts = batch_dfts[index];
+  if (evaluate_batch) {
+    dfts.resize(batch_number_of_frames * 2 * number_of_bins);
+    SpectrumKernels::dft_batch(samples, samples_per_video_frame,
+                               batch_number_of_frames,
+                               plan->get_dft_basis().data(),
+                               2 * number_of_bins, number_of_samples,
+                               dfts.data());
+  }
+  VectorSize frame_index =
+      time_range_video_frame.first / samples_per_video_frame;
+  const double *dft =
+      dfts.data() + (frame_index - batch_first_frame) * 2 * number_of_bins;
+  spectrum.resize(number_of_bins);
+  SpectrumKernels::magnitudes(dft, number_of_bins, number_of_samples,
+                              spectrum.data());
+}
 
-  frequencies.reserve(number_of_samples / 2);
-  double frequency_step_size = 1. * sample_rate / number_of_samples;
-  for (VectorSize frequency_index = 0; frequency_index != number_of_samples / 2;
-       ++frequency_index) {
-    frequencies.push_back(frequency_index * frequency_step_size);
+void Spectrum::prepare_fft(const VectorSize &number_of_samples) {
+  // The number of samples only changes at the beginning and at the end of
+  // the signal, where the audio frame gets clipped. Each channel gets its own
+  // copy of the FFT, whose working buffers can't be shared by concurrent
+  // transforms.
+  if (ffts.size() != channels.size() ||
+      ffts[0].get_size() != number_of_samples) {
+    ffts.assign(channels.size(), FFT(number_of_samples));
+    fourier_transforms.resize(channels.size());
   }
-  return frequencies;
 }
 
-double Spectrum::sqr(double value) { return value * value; }
+bool Spectrum::prepare_sliding_dfts(const VectorRange &time_range,
+                                    const VectorRange &frequency_range) {
+  VectorSize number_of_samples = time_range.second - time_range.first;
+  VectorSize previous_number_of_samples =
+      sliding_time_range.second - sliding_time_range.first;
+  bool resized = number_of_samples != previous_number_of_samples ||
+                 sliding_dfts.empty();
+
+  // Sliding the audio frame is only cheaper than evaluating it from scratch if
+  // the audio frames overlap by more than half of their size.
+  bool overlapping =
+      time_range.first >= sliding_time_range.first &&
+      2 * (time_range.first - sliding_time_range.first) < number_of_samples;
 
-double Spectrum::abs(double real_part, double imaginary_part) {
-  return sqrt(sqr(real_part) + sqr(imaginary_part));
+  if (!resized && overlapping && frames_since_anchor < sliding_anchor_period) {
+    ++frames_since_anchor;
+    return false;
+  }
+  if (resized) {
+    prepare_fft(number_of_samples);
+    auto twiddles = SlidingDFT::evaluate_twiddles(number_of_samples);
+    sliding_dfts.assign(
+        channels.size(),
+        SlidingDFT(number_of_samples, frequency_range, twiddles));
+  }
+  frames_since_anchor = 0;
+  return true;
 }
@@ -24,10 +24,16 @@
 #ifndef OVERTONE_SPECTRUM_H
 #define OVERTONE_SPECTRUM_H
 
+#include "AnalysisPlan.h"
+#include "AudioSource.h"
+#include "FFT.h"
+#include "SlidingDFT.h"
+#include "SpectrumKernels.h"
 #include "WAVE.h"
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <map>
 /**
  * Class for evaluating the audio spectra for each video frame
  */
@@ -38,6 +44,50 @@ public:
   using VectorRange = std::pair<VectorSize, VectorSize>;
   using KeyRange = std::pair<unsigned char, unsigned char>;
 
+  /**
+   * Algorithms for evaluating the spectrum of a channel.
+   *   - direct: evaluates each frequency separately via the definition of the
+   *             discrete Fourier transform
+   *   - fft: evaluates the whole spectrum via a single fast Fourier transform
+   *          and selects the frequencies within the key range afterwards
+   *          (see FFT for the tolerance)
+   *   - sliding: updates the bins of the previous video frame with the
+   *              samples that enter and leave the audio frame (see SlidingDFT)
+   *              and re-anchors them via the FFT every sliding_anchor_period
+   *              video frames
+   *   - goertzel: evaluates only the bins within the key range via Goertzel
+   *               filters, several bins per pass over the samples (see
+   *               SpectrumKernels)
+   *   - batched: evaluates only the bins within the key range for up to
+   *              batch_size consecutive video frames at once, as a product
+   *              of a cosine and sine basis and the audio frames (see
+   *              SpectrumKernels::dft_batch())
+   *   - centered: evaluates evenly spaced frequencies within each key
+   *               instead of the bins via Goertzel filters, at least three
+   *               per key and not sparser than the bins (see
+   *               AnalysisPlan::Frequencies::key_centered)
+   */
+  enum class Algorithm { direct, fft, sliding, goertzel, batched, centered };
+
+  // number of video frames after which the sliding DFT gets re-anchored
+  static constexpr unsigned sliding_anchor_period = 64;
+
+  // maximum number of video frames whose spectra get evaluated at once by
+  // the batched algorithm (the default chunk size of ParallelKeyboard)
+  static constexpr VectorSize batch_size = 16;
+
+  /**
+   * Converts the name of an algorithm, e.g., "fft", to the algorithm.
+   * @param name name of the algorithm
+   * @return algorithm
+   */
+  static Algorithm name_to_algorithm(const std::string &name);
+
+  /**
+   * @return names of all available algorithms
+   */
+  static std::vector<std::string> get_algorithm_names();
+
   /**
    * Evaluates the spectrum of the first frame. The spectrum is the average of
    * the spectra of the selected channels. The spectrum gets evaluated for
@@ -45,15 +95,38 @@ public:
    * key_range.second + 0.5. If the number of audio samples within a video frame
    * is smaller than minimum_samples, the range of an audio frame gets extended
    * on both sides.
+   * The source is shared by the copies of the Spectrum object. If it's an
+   * AudioStream, the frames have to be evaluated in ascending order, and the
+   * stream has to buffer the audio frame plus one video frame, or plus
+   * batch_size video frames for the batched algorithm.
+   * @param source PCM signal
+   * @param channels selected channels (all channels if empty)
+   * @param frame_rate video frame rate
+   * @param key_range key range
+   * @param minimum_samples minimum audio samples per video frame
+   * @param algorithm algorithm that evaluates the spectra of the channels
+   */
+  Spectrum(std::shared_ptr<AudioSource> source,
+           const std::vector<unsigned> &channels, const unsigned &frame_rate,
+           KeyRange key_range, const VectorSize &minimum_samples,
+           Algorithm algorithm = Algorithm::fft);
+
+  /**
+   * Evaluates the spectrum of the first frame of a decoded WAVE file (see
+   * above).
    * @param wave WAVE object that contains the PCM signal.
    * @param channels selected channels (all channels if empty)
    * @param frame_rate video frame rate
    * @param key_range key range
    * @param minimum_samples minimum audio samples per video frame
+   * @param algorithm algorithm that evaluates the spectra of the channels
    */
   explicit Spectrum(const WAVE &wave, const std::vector<unsigned> &channels,
                     const unsigned &frame_rate, KeyRange key_range,
-                    const VectorSize &minimum_samples);
+                    const VectorSize &minimum_samples,
+                    Algorithm algorithm = Algorithm::fft)
+      : Spectrum(std::make_shared<WAVE>(wave), channels, frame_rate,
+                 std::move(key_range), minimum_samples, algorithm) {}
 
   /**
    * Evaluates the next frame.
@@ -62,6 +135,59 @@ public:
    */
   bool go_to_next_frame();
 
+  /**
+   * Evaluates an arbitrary frame.
+   * @param frame_index index of the video frame
+   * @return False if the video frame doesn't exist.
+   */
+  bool go_to_frame(VectorSize frame_index);
+
+  /**
+   * Moves to the next frame like go_to_next_frame(), but only prepares the
+   * evaluation of its spectrum, which gets completed by evaluate_channel()
+   * for each selected channel and by finish_frame() afterwards.
+   * @return False if there is no next video frame.
+   */
+  bool begin_next_frame();
+
+  /**
+   * Moves to an arbitrary frame like go_to_frame(), but only prepares the
+   * evaluation of its spectrum (see begin_next_frame()).
+   * @param frame_index index of the video frame
+   * @return False if the video frame doesn't exist.
+   */
+  bool begin_frame(VectorSize frame_index);
+
+  /**
+   * Returns the number of selected channels.
+   * @return number of selected channels
+   */
+  VectorSize get_number_of_selected_channels() const {
+    return channels.size();
+  }
+
+  /**
+   * Evaluates the spectrum of a selected channel within the prepared frame.
+   * Different channels, also of different Spectrum objects, may be evaluated
+   * concurrently, since the samples have already been read from the source.
+   * @param index index of the channel within the selected channels
+   */
+  void evaluate_channel(VectorSize index);
+
+  /**
+   * Averages the spectra of the selected channels, which all have to be
+   * evaluated.
+   */
+  void finish_frame();
+
+  /**
+   * Returns the number of video frames.
+   * @return number of video frames
+   */
+  VectorSize get_number_of_frames() const {
+    return source->get_number_of_samples() / samples_per_video_frame;
+  }
+
   /**
    * Returns the spectrum.
    * @return spectrum
@@ -69,10 +195,11 @@ public:
   std::shared_ptr<Vector> get_spectrum() const { return spectrum; }
 
   /**
-   * Returns the keyboard of the spectrum.
-   * @return keys
+   * Returns the analysis plan of the current frame, which contains the
+   * positions of the bins of the spectrum on the keyboard.
+   * @return analysis plan
    */
-  std::shared_ptr<Vector> get_keys() const { return keys; }
+  std::shared_ptr<const AnalysisPlan> get_plan() const { return plan; }
 
   /**
    * Returns the key range within which the spectrum has been evaluated.
@@ -81,8 +208,8 @@ public:
   KeyRange get_key_range() const { return key_range; }
 
 private:
-  // WAVE object that contains the PCM signal.
-  WAVE wave;
+  // PCM signal
+  std::shared_ptr<AudioSource> source;
 
   // the number of audio samples per video frame
   const VectorSize samples_per_video_frame;
@@ -96,26 +223,88 @@ private:
   // The minimum number of audio samples.
   VectorSize minimum_samples;
 
-  // the number of audio samples in the PCM signal
-  VectorSize time_size;
-
   // the selected channels for which the spectrum gets evaluated
   std::vector<unsigned> channels;
 
-  // the frequencies of the current spectrum
-  std::shared_ptr<Vector> frequencies;
+  // algorithm that evaluates the spectra of the channels
+  Algorithm algorithm;
+
+  // FFT of each selected channel for the current number of samples per audio
+  // frame
+  std::vector<FFT> ffts;
+
+  // working buffer of the FFT of each selected channel
+  std::vector<FFT::ComplexVector> fourier_transforms;
+
+  // sliding DFTs of the selected channels
+  std::vector<SlidingDFT> sliding_dfts;
+
+  // time index range of the bins of the sliding DFTs
+  VectorRange sliding_time_range;
+
+  // number of video frames since the sliding DFTs have been re-anchored
+  unsigned frames_since_anchor{};
+
+  // the analysis plans of all the numbers of samples per audio frame that
+  // have occurred so far
+  std::map<VectorSize, std::shared_ptr<const AnalysisPlan>> plans;
 
-  // the keyboard of the current spectrum
-  std::shared_ptr<Vector> keys;
+  // the analysis plan of the current frame
+  std::shared_ptr<const AnalysisPlan> plan;
 
   // the spectrum of the current video frame
   std::shared_ptr<Vector> spectrum;
 
+  // time index range of the audio frame of the prepared frame
+  VectorRange audio_frame_range;
+
+  // true if the sliding DFTs get re-anchored within the prepared frame
+  bool anchor{};
+
+  // samples of each selected channel within the prepared audio frame, which
+  // start at the previous audio frame if the sliding DFTs get moved
+  std::vector<const double *> channel_samples;
+
+  // spectrum of each selected channel within the prepared frame
+  std::vector<Vector> channel_spectra;
+
+  // working buffer of finish_frame()
+  std::vector<const double *> spectrum_pointers;
+
+  // batched algorithm: plan, first video frame, and number of video frames of
+  // the current batch
+  std::shared_ptr<const AnalysisPlan> batch_plan;
+  VectorSize batch_first_frame{};
+  VectorSize batch_number_of_frames{};
+
+  // batched algorithm: true if the batch gets evaluated within the prepared
+  // frame
+  bool evaluate_batch{};
+
+  // batched algorithm: DFTs of the bins of each video frame of the batch
+  // (see SpectrumKernels::dft_batch()) for each selected channel
+  std::vector<Vector> batch_dfts;
+
   /**
    * Evaluates the spectrum of the current video frame.
    */
   void evaluate_frame();
 
+  /**
+   * Prepares the evaluation of the spectrum of the current video frame and
+   * reads the samples of the selected channels.
+   */
+  void prepare_frame();
+
+  /**
+   * Returns the analysis plan for audio frames with `number_of_samples`
+   * samples and evaluates it if it doesn't exist yet.
+   * @param number_of_samples number of samples per audio frame
+   * @return analysis plan
+   */
+  std::shared_ptr<const AnalysisPlan>
+  get_plan(const VectorSize &number_of_samples);
+
   /**
    * Evaluates the time index range of the current video frame. The time range
    * gets extended if samples_per_video_frame >= minimum_samples.
@@ -126,45 +315,72 @@ private:
   /**
    * Evaluates the spectrum of a single channel within a specified time and
    * frequency range.
-   * @param channel PCM signal of the channel.
+   * @param samples PCM signal of the channel within the time range
+   * @param time_range time index range
+   * @param frequency_range frequency range
+   * @param spectrum spectrum of the selected channel (resized)
+   */
+  static void evaluate_channel_spectrum(const double *samples,
+                                        const VectorRange &time_range,
+                                        const VectorRange &frequency_range,
+                                        Vector &spectrum);
+
+  /**
+   * Evaluates the spectrum of a single channel via the FFT.
+   * @param index index of the channel within the selected channels
+   * @param samples PCM signal of the channel within the time range
    * @param time_range time index range
    * @param frequency_range frequency range
-   * @return spectrum of the selected channel
+   * @param spectrum spectrum of the selected channel (resized)
    */
-  static Vector evaluate_channel_spectrum(const Vector &channel,
-                                          const VectorRange &time_range,
-                                          const VectorRange &frequency_range);
-  static Spectrum::Vector
-  evaluate_spectrum(const std::vector<std::shared_ptr<Vector>> &signal,
-                    const std::vector<unsigned> &channels,
-                    const VectorRange &time_range,
-                    const VectorRange &frequency_range);
+  void evaluate_channel_spectrum_fft(VectorSize index, const double *samples,
+                                     const VectorRange &time_range,
+                                     const VectorRange &frequency_range,
+                                     Vector &spectrum);
 
   /**
-   * Evaluates all the frequencies of the Fourier transform. The Fourier
-   * transform gets then evaluated only for the frequencies within the
-   * selected key range.
-   * @param time_range time index range of the current frame
-   * @param sample_rate audio sample rate
-   * @return all frequencies of the Fourier transform
+   * Evaluates the spectrum of a single channel via Goertzel filters.
+   * @param samples PCM signal of the channel within the time range
+   * @param spectrum spectrum of the selected channel (resized)
    */
-  static Vector evaluate_all_frequencies(const VectorRange &time_range,
-                                         const VectorSize &sample_rate);
+  void evaluate_channel_spectrum_goertzel(const double *samples,
+                                          Vector &spectrum);
 
   /**
-   * Square root.
-   * @param value input value
-   * @return square root of value
+   * Starts a new batch at the current video frame unless the current batch
+   * already contains it.
+   * @return time index range of the samples of the batch, or an empty range
+   *         if the current batch contains the video frame
    */
-  inline static double sqr(double value);
+  VectorRange prepare_batch();
 
   /**
-   * Absolute value of a complex number.
-   * @param real_part real part of the complex number
-   * @param imaginary_part imaginary part of the complex number
-   * @return absolute value of the complex number
+   * Evaluates the spectrum of a single channel via the DFTs of the batch and
+   * evaluates the batch first if necessary.
+   * @param index index of the channel within the selected channels
+   * @param samples PCM signal of the channel within the batch
+   * @param spectrum spectrum of the selected channel (resized)
+   */
+  void evaluate_channel_spectrum_batched(VectorSize index,
+                                         const double *samples,
+                                         Vector &spectrum);
+
+  /**
+   * Evaluates the FFT tables if the number of samples per audio frame has
+   * changed.
+   * @param number_of_samples number of samples per audio frame
+   */
+  void prepare_fft(const VectorSize &number_of_samples);
+
+  /**
+   * Prepares the sliding DFTs for the audio frame `time_range`.
+   * @param time_range time index range
+   * @param frequency_range frequency range
+   * @return true if the sliding DFTs have to be re-anchored, false if they can
+   *         be moved to `time_range`
    */
-  inline static double abs(double real_part, double imaginary_part);
+  bool prepare_sliding_dfts(const VectorRange &time_range,
+                            const VectorRange &frequency_range);
 };
 
 #endif // OVERTONE_SPECTRUM_H
@@ -0,0 +1,878 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    SpectrumKernels.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "SpectrumKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define OVERTONE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+using VectorSize = SpectrumKernels::VectorSize;
+using Implementation = SpectrumKernels::Implementation;
+
+using GoertzelKernel = void (*)(const double *, VectorSize, const double *,
+                                VectorSize, double *);
+using DirectKernel = void (*)(const double *, VectorSize, VectorSize,
+                              VectorSize, double *);
+using MagnitudesKernel = void (*)(const double *, VectorSize, VectorSize,
+                                  double *);
+using AverageKernel = void (*)(const double *const *, VectorSize, VectorSize,
+                               double *);
+using DFTBatchKernel = void (*)(const double *, VectorSize, VectorSize,
+                                const double *, VectorSize, VectorSize,
+                                double *);
+
+/**
+ * Runs `block_size` Goertzel filters simultaneously over the audio frame.
+ */
+template <VectorSize block_size>
+void goertzel_block(const double *samples, VectorSize number_of_samples,
+                    const double *coefficients, double *spectrum) {
+  double state_1[block_size] = {};
+  double state_2[block_size] = {};
+  for (VectorSize time_index = 0; time_index != number_of_samples;
+       ++time_index) {
+    double sample = samples[time_index];
+    for (VectorSize bin = 0; bin != block_size; ++bin) {
+      double state_0 = sample + coefficients[bin] * state_1[bin] - state_2[bin];
+      state_2[bin] = state_1[bin];
+      state_1[bin] = state_0;
+    }
+  }
+  for (VectorSize bin = 0; bin != block_size; ++bin) {
+    // |X_k|^2 = s_1^2 + s_2^2 - 2 cos(2 pi k / N) s_1 s_2
+    double power = state_1[bin] * state_1[bin] + state_2[bin] * state_2[bin] -
+                   coefficients[bin] * state_1[bin] * state_2[bin];
+    spectrum[bin] = 2. * std::sqrt(std::fmax(power, 0.)) / number_of_samples;
+  }
+}
+
+void goertzel_scalar(const double *samples, VectorSize number_of_samples,
+                     const double *coefficients, VectorSize number_of_bins,
+                     double *spectrum) {
+  constexpr VectorSize block_size = SpectrumKernels::goertzel_block_size;
+  VectorSize bin = 0;
+  for (; bin + block_size <= number_of_bins; bin += block_size) {
+    goertzel_block<block_size>(samples, number_of_samples, coefficients + bin,
+                               spectrum + bin);
+  }
+  // The remaining bins are processed in blocks of 4, 2, and 1 bins.
+  for (; bin + 4 <= number_of_bins; bin += 4) {
+    goertzel_block<4>(samples, number_of_samples, coefficients + bin,
+                      spectrum + bin);
+  }
+  for (; bin + 2 <= number_of_bins; bin += 2) {
+    goertzel_block<2>(samples, number_of_samples, coefficients + bin,
+                      spectrum + bin);
+  }
+  for (; bin != number_of_bins; ++bin) {
+    goertzel_block<1>(samples, number_of_samples, coefficients + bin,
+                      spectrum + bin);
+  }
+}
+
+/**
+ * Evaluates the phasors exp(i 2 pi k n / N) of `number_of_bins` consecutive
+ * bins k at the time index n.
+ */
+void evaluate_phasors(VectorSize first_bin, VectorSize number_of_bins,
+                      VectorSize time_index, VectorSize number_of_samples,
+                      double *real_parts, double *imaginary_parts) {
+  for (VectorSize bin = 0; bin != number_of_bins; ++bin) {
+    // The phase is reduced modulo 2 pi in integers, so it stays exact for
+    // long audio frames.
+    VectorSize cycles = (first_bin + bin) * time_index % number_of_samples;
+    double phase = 2. * M_PI * cycles / number_of_samples;
+    real_parts[bin] = std::cos(phase);
+    imaginary_parts[bin] = std::sin(phase);
+  }
+}
+
+/**
+ * Evaluates `block_size` bins of the direct DFT simultaneously.
+ */
+template <VectorSize block_size>
+void direct_block(const double *samples, VectorSize number_of_samples,
+                  VectorSize first_bin, double *spectrum) {
+  double rotation_real[block_size], rotation_imaginary[block_size];
+  evaluate_phasors(first_bin, block_size, 1, number_of_samples, rotation_real,
+                   rotation_imaginary);
+  double real_part[block_size] = {};
+  double imaginary_part[block_size] = {};
+  double phasor_real[block_size], phasor_imaginary[block_size];
+  constexpr VectorSize period = SpectrumKernels::direct_phasor_period;
+  for (VectorSize first = 0; first < number_of_samples; first += period) {
+    evaluate_phasors(first_bin, block_size, first, number_of_samples,
+                     phasor_real, phasor_imaginary);
+    VectorSize last = std::min(first + period, number_of_samples);
+    for (VectorSize time_index = first; time_index != last; ++time_index) {
+      double sample = samples[time_index];
+      for (VectorSize bin = 0; bin != block_size; ++bin) {
+        real_part[bin] += sample * phasor_real[bin];
+        imaginary_part[bin] += sample * phasor_imaginary[bin];
+        double real = phasor_real[bin];
+        phasor_real[bin] = real * rotation_real[bin] -
+                           phasor_imaginary[bin] * rotation_imaginary[bin];
+        phasor_imaginary[bin] = real * rotation_imaginary[bin] +
+                                phasor_imaginary[bin] * rotation_real[bin];
+      }
+    }
+  }
+  for (VectorSize bin = 0; bin != block_size; ++bin) {
+    spectrum[bin] = 2. *
+                    std::sqrt(real_part[bin] * real_part[bin] +
+                              imaginary_part[bin] * imaginary_part[bin]) /
+                    number_of_samples;
+  }
+}
+
+void direct_scalar(const double *samples, VectorSize number_of_samples,
+                   VectorSize first_bin, VectorSize number_of_bins,
+                   double *spectrum) {
+  constexpr VectorSize block_size = SpectrumKernels::goertzel_block_size;
+  VectorSize bin = 0;
+  for (; bin + block_size <= number_of_bins; bin += block_size) {
+    direct_block<block_size>(samples, number_of_samples, first_bin + bin,
+                             spectrum + bin);
+  }
+  for (; bin + 4 <= number_of_bins; bin += 4) {
+    direct_block<4>(samples, number_of_samples, first_bin + bin,
+                    spectrum + bin);
+  }
+  for (; bin + 2 <= number_of_bins; bin += 2) {
+    direct_block<2>(samples, number_of_samples, first_bin + bin,
+                    spectrum + bin);
+  }
+  for (; bin != number_of_bins; ++bin) {
+    direct_block<1>(samples, number_of_samples, first_bin + bin,
+                    spectrum + bin);
+  }
+}
+
+/**
+ * Evaluates the magnitudes within the index range [first, last).
+ */
+void magnitudes_scalar(const double *values, VectorSize first, VectorSize last,
+                       VectorSize number_of_samples, double *magnitudes) {
+  for (VectorSize index = first; index != last; ++index) {
+    double real_part = values[2 * index];
+    double imaginary_part = values[2 * index + 1];
+    magnitudes[index] =
+        2. *
+        std::sqrt(real_part * real_part + imaginary_part * imaginary_part) /
+        number_of_samples;
+  }
+}
+
+/**
+ * Blocks of the batched DFT: `rows` rows of the basis times `frames` audio
+ * frames over `length` samples, added to the DFTs.
+ */
+struct ScalarDFTBlocks {
+  template <VectorSize rows, VectorSize frames>
+  static void block(const double *basis, VectorSize number_of_samples,
+                    const double *samples, VectorSize hop, VectorSize length,
+                    double *dft, VectorSize number_of_rows) {
+    double accumulators[rows][frames] = {};
+    for (VectorSize time_index = 0; time_index != length; ++time_index) {
+      for (VectorSize row = 0; row != rows; ++row) {
+        double value = basis[row * number_of_samples + time_index];
+        for (VectorSize frame = 0; frame != frames; ++frame) {
+          accumulators[row][frame] += value * samples[frame * hop + time_index];
+        }
+      }
+    }
+    for (VectorSize row = 0; row != rows; ++row) {
+      for (VectorSize frame = 0; frame != frames; ++frame) {
+        dft[frame * number_of_rows + row] += accumulators[row][frame];
+      }
+    }
+  }
+};
+
+/**
+ * Applies `rows` rows of the basis to all the audio frames, 4 frames at a
+ * time.
+ */
+template <class Blocks, VectorSize rows>
+void dft_rows(const double *basis, VectorSize number_of_samples,
+              const double *samples, VectorSize hop,
+              VectorSize number_of_frames, VectorSize length, double *dft,
+              VectorSize number_of_rows) {
+  VectorSize frame = 0;
+  for (; frame + 4 <= number_of_frames; frame += 4) {
+    Blocks::template block<rows, 4>(basis, number_of_samples,
+                                    samples + frame * hop, hop, length,
+                                    dft + frame * number_of_rows,
+                                    number_of_rows);
+  }
+  for (; frame != number_of_frames; ++frame) {
+    Blocks::template block<rows, 1>(basis, number_of_samples,
+                                    samples + frame * hop, hop, length,
+                                    dft + frame * number_of_rows,
+                                    number_of_rows);
+  }
+}
+
+template <class Blocks>
+void dft_batch_blocked(const double *samples, VectorSize hop,
+                       VectorSize number_of_frames, const double *basis,
+                       VectorSize number_of_rows, VectorSize number_of_samples,
+                       double *dft) {
+  std::fill(dft, dft + number_of_frames * number_of_rows, 0.);
+  constexpr VectorSize block_size = SpectrumKernels::dft_block_size;
+  for (VectorSize first = 0; first < number_of_samples; first += block_size) {
+    VectorSize length = std::min(block_size, number_of_samples - first);
+    VectorSize row = 0;
+    for (; row + 4 <= number_of_rows; row += 4) {
+      dft_rows<Blocks, 4>(basis + row * number_of_samples + first,
+                          number_of_samples, samples + first, hop,
+                          number_of_frames, length, dft + row, number_of_rows);
+    }
+    for (; row != number_of_rows; ++row) {
+      dft_rows<Blocks, 1>(basis + row * number_of_samples + first,
+                          number_of_samples, samples + first, hop,
+                          number_of_frames, length, dft + row, number_of_rows);
+    }
+  }
+}
+
+/**
+ * Averages the spectra within the index range [first, last).
+ */
+void average_scalar(const double *const *spectra, VectorSize number_of_spectra,
+                    VectorSize first, VectorSize last, double *average) {
+  for (VectorSize index = first; index != last; ++index) {
+    double accumulator = 0.;
+    for (VectorSize spectrum = 0; spectrum != number_of_spectra; ++spectrum) {
+      accumulator += spectra[spectrum][index];
+    }
+    average[index] = accumulator / number_of_spectra;
+  }
+}
+
+#ifdef OVERTONE_X86_KERNELS
+// The recurrence of a Goertzel filter is a chain of dependent FMAs, so each
+// block runs several independent vectors to hide the latency of the FMAs.
+
+template <VectorSize vectors>
+__attribute__((target("avx2,fma"))) void
+goertzel_block_avx2(const double *samples, VectorSize number_of_samples,
+                    const double *coefficients, double *spectrum) {
+  __m256d coefficient[vectors], state_1[vectors], state_2[vectors];
+  for (VectorSize vector = 0; vector != vectors; ++vector) {
+    coefficient[vector] = _mm256_loadu_pd(coefficients + 4 * vector);
+    state_1[vector] = _mm256_setzero_pd();
+    state_2[vector] = _mm256_setzero_pd();
+  }
+  for (VectorSize time_index = 0; time_index != number_of_samples;
+       ++time_index) {
+    __m256d sample = _mm256_broadcast_sd(samples + time_index);
+    for (VectorSize vector = 0; vector != vectors; ++vector) {
+      __m256d state_0 = _mm256_fmadd_pd(coefficient[vector], state_1[vector],
+                                        _mm256_sub_pd(sample, state_2[vector]));
+      state_2[vector] = state_1[vector];
+      state_1[vector] = state_0;
+    }
+  }
+  __m256d normalization = _mm256_set1_pd(2. / number_of_samples);
+  for (VectorSize vector = 0; vector != vectors; ++vector) {
+    __m256d cross = _mm256_mul_pd(
+        coefficient[vector], _mm256_mul_pd(state_1[vector], state_2[vector]));
+    __m256d power = _mm256_fmadd_pd(
+        state_1[vector], state_1[vector],
+        _mm256_fmsub_pd(state_2[vector], state_2[vector], cross));
+    power = _mm256_max_pd(power, _mm256_setzero_pd());
+    _mm256_storeu_pd(spectrum + 4 * vector,
+                     _mm256_mul_pd(_mm256_sqrt_pd(power), normalization));
+  }
+}
+
+__attribute__((target("avx2,fma"))) void
+goertzel_avx2(const double *samples, VectorSize number_of_samples,
+              const double *coefficients, VectorSize number_of_bins,
+              double *spectrum) {
+  VectorSize bin = 0;
+  for (; bin + 16 <= number_of_bins; bin += 16) {
+    goertzel_block_avx2<4>(samples, number_of_samples, coefficients + bin,
+                           spectrum + bin);
+  }
+  for (; bin + 8 <= number_of_bins; bin += 8) {
+    goertzel_block_avx2<2>(samples, number_of_samples, coefficients + bin,
+                           spectrum + bin);
+  }
+  for (; bin + 4 <= number_of_bins; bin += 4) {
+    goertzel_block_avx2<1>(samples, number_of_samples, coefficients + bin,
+                           spectrum + bin);
+  }
+  goertzel_scalar(samples, number_of_samples, coefficients + bin,
+                  number_of_bins - bin, spectrum + bin);
+}
+
+// The phasors of the direct DFT are another chain of dependent operations,
+// each vector keeps the phasors and sums of its bins in 6 registers.
+
+template <VectorSize vectors>
+__attribute__((target("avx2,fma"))) void
+direct_block_avx2(const double *samples, VectorSize number_of_samples,
+                  VectorSize first_bin, double *spectrum) {
+  constexpr VectorSize block_size = 4 * vectors;
+  double real_values[block_size], imaginary_values[block_size];
+  evaluate_phasors(first_bin, block_size, 1, number_of_samples, real_values,
+                   imaginary_values);
+  __m256d rotation_real[vectors], rotation_imaginary[vectors];
+  __m256d phasor_real[vectors], phasor_imaginary[vectors];
+  __m256d real_part[vectors], imaginary_part[vectors];
+  for (VectorSize vector = 0; vector != vectors; ++vector) {
+    rotation_real[vector] = _mm256_loadu_pd(real_values + 4 * vector);
+    rotation_imaginary[vector] =
+        _mm256_loadu_pd(imaginary_values + 4 * vector);
+    real_part[vector] = _mm256_setzero_pd();
+    imaginary_part[vector] = _mm256_setzero_pd();
+  }
+  constexpr VectorSize period = SpectrumKernels::direct_phasor_period;
+  for (VectorSize first = 0; first < number_of_samples; first += period) {
+    evaluate_phasors(first_bin, block_size, first, number_of_samples,
+                     real_values, imaginary_values);
+    for (VectorSize vector = 0; vector != vectors; ++vector) {
+      phasor_real[vector] = _mm256_loadu_pd(real_values + 4 * vector);
+      phasor_imaginary[vector] =
+          _mm256_loadu_pd(imaginary_values + 4 * vector);
+    }
+    VectorSize last = std::min(first + period, number_of_samples);
+    for (VectorSize time_index = first; time_index != last; ++time_index) {
+      __m256d sample = _mm256_broadcast_sd(samples + time_index);
+      for (VectorSize vector = 0; vector != vectors; ++vector) {
+        real_part[vector] =
+            _mm256_fmadd_pd(sample, phasor_real[vector], real_part[vector]);
+        imaginary_part[vector] = _mm256_fmadd_pd(
+            sample, phasor_imaginary[vector], imaginary_part[vector]);
+        __m256d real = phasor_real[vector];
+        phasor_real[vector] =
+            _mm256_fmsub_pd(real, rotation_real[vector],
+                            _mm256_mul_pd(phasor_imaginary[vector],
+                                          rotation_imaginary[vector]));
+        phasor_imaginary[vector] = _mm256_fmadd_pd(
+            real, rotation_imaginary[vector],
+            _mm256_mul_pd(phasor_imaginary[vector], rotation_real[vector]));
+      }
+    }
+  }
+  __m256d normalization = _mm256_set1_pd(2. / number_of_samples);
+  for (VectorSize vector = 0; vector != vectors; ++vector) {
+    __m256d power = _mm256_fmadd_pd(
+        real_part[vector], real_part[vector],
+        _mm256_mul_pd(imaginary_part[vector], imaginary_part[vector]));
+    _mm256_storeu_pd(spectrum + 4 * vector,
+                     _mm256_mul_pd(_mm256_sqrt_pd(power), normalization));
+  }
+}
+
+__attribute__((target("avx2,fma"))) void
+direct_avx2(const double *samples, VectorSize number_of_samples,
+            VectorSize first_bin, VectorSize number_of_bins,
+            double *spectrum) {
+  VectorSize bin = 0;
+  for (; bin + 8 <= number_of_bins; bin += 8) {
+    direct_block_avx2<2>(samples, number_of_samples, first_bin + bin,
+                         spectrum + bin);
+  }
+  for (; bin + 4 <= number_of_bins; bin += 4) {
+    direct_block_avx2<1>(samples, number_of_samples, first_bin + bin,
+                         spectrum + bin);
+  }
+  direct_scalar(samples, number_of_samples, first_bin + bin,
+                number_of_bins - bin, spectrum + bin);
+}
+
+// The magnitudes are evaluated without FMAs, so they are the same as the
+// ones of the scalar implementation.
+__attribute__((target("avx2"))) void
+magnitudes_avx2(const double *values, VectorSize number_of_values,
+                VectorSize number_of_samples, double *magnitudes) {
+  __m256d two = _mm256_set1_pd(2.);
+  __m256d number = _mm256_set1_pd(static_cast<double>(number_of_samples));
+  VectorSize index = 0;
+  for (; index + 4 <= number_of_values; index += 4) {
+    __m256d first = _mm256_loadu_pd(values + 2 * index);
+    __m256d second = _mm256_loadu_pd(values + 2 * index + 4);
+    // |X_0|^2, |X_2|^2, |X_1|^2, |X_3|^2
+    __m256d powers = _mm256_hadd_pd(_mm256_mul_pd(first, first),
+                                    _mm256_mul_pd(second, second));
+    powers = _mm256_permute4x64_pd(powers, 0xD8);
+    _mm256_storeu_pd(
+        magnitudes + index,
+        _mm256_div_pd(_mm256_mul_pd(two, _mm256_sqrt_pd(powers)), number));
+  }
+  magnitudes_scalar(values, index, number_of_values, number_of_samples,
+                    magnitudes);
+}
+
+__attribute__((target("avx2"))) void
+average_avx2(const double *const *spectra, VectorSize number_of_spectra,
+             VectorSize size, double *average) {
+  __m256d number = _mm256_set1_pd(static_cast<double>(number_of_spectra));
+  VectorSize index = 0;
+  for (; index + 4 <= size; index += 4) {
+    __m256d accumulator = _mm256_setzero_pd();
+    for (VectorSize spectrum = 0; spectrum != number_of_spectra; ++spectrum) {
+      accumulator = _mm256_add_pd(accumulator,
+                                  _mm256_loadu_pd(spectra[spectrum] + index));
+    }
+    _mm256_storeu_pd(average + index, _mm256_div_pd(accumulator, number));
+  }
+  average_scalar(spectra, number_of_spectra, index, size, average);
+}
+
+__attribute__((target("avx2"))) inline double sum_avx2(__m256d vector) {
+  __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(vector),
+                           _mm256_extractf128_pd(vector, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+struct AVX2DFTBlocks {
+  template <VectorSize rows, VectorSize frames>
+  __attribute__((target("avx2,fma"))) static void
+  block(const double *basis, VectorSize number_of_samples,
+        const double *samples, VectorSize hop, VectorSize length, double *dft,
+        VectorSize number_of_rows) {
+    __m256d accumulators[rows][frames];
+    for (VectorSize row = 0; row != rows; ++row) {
+      for (VectorSize frame = 0; frame != frames; ++frame) {
+        accumulators[row][frame] = _mm256_setzero_pd();
+      }
+    }
+    VectorSize time_index = 0;
+    for (; time_index + 4 <= length; time_index += 4) {
+      __m256d frame_samples[frames];
+      for (VectorSize frame = 0; frame != frames; ++frame) {
+        frame_samples[frame] =
+            _mm256_loadu_pd(samples + frame * hop + time_index);
+      }
+      for (VectorSize row = 0; row != rows; ++row) {
+        __m256d value =
+            _mm256_loadu_pd(basis + row * number_of_samples + time_index);
+        for (VectorSize frame = 0; frame != frames; ++frame) {
+          accumulators[row][frame] = _mm256_fmadd_pd(
+              value, frame_samples[frame], accumulators[row][frame]);
+        }
+      }
+    }
+    for (VectorSize row = 0; row != rows; ++row) {
+      for (VectorSize frame = 0; frame != frames; ++frame) {
+        double sum = sum_avx2(accumulators[row][frame]);
+        for (VectorSize index = time_index; index != length; ++index) {
+          sum += basis[row * number_of_samples + index] *
+                 samples[frame * hop + index];
+        }
+        dft[frame * number_of_rows + row] += sum;
+      }
+    }
+  }
+};
+
+// GCC 12 reports the undefined pass-through operands of the AVX-512
+// intrinsics (e.g., _mm512_sqrt_pd and _mm512_reduce_add_pd) as uninitialized
+// at -O2, which is a false positive of the compiler.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+template <VectorSize vectors>
+__attribute__((target("avx512f"))) void
+goertzel_block_avx512(const double *samples, VectorSize number_of_samples,
+                      const double *coefficients, double *spectrum) {
+  __m512d coefficient[vectors], state_1[vectors], state_2[vectors];
+  for (VectorSize vector = 0; vector != vectors; ++vector) {
+    coefficient[vector] = _mm512_loadu_pd(coefficients + 8 * vector);
+    state_1[vector] = _mm512_setzero_pd();
+    state_2[vector] = _mm512_setzero_pd();
+  }
+  for (VectorSize time_index = 0; time_index != number_of_samples;
+       ++time_index) {
+    __m512d sample = _mm512_set1_pd(samples[time_index]);
+    for (VectorSize vector = 0; vector != vectors; ++vector) {
+      __m512d state_0 = _mm512_fmadd_pd(coefficient[vector], state_1[vector],
+                                        _mm512_sub_pd(sample, state_2[vector]));
+      state_2[vector] = state_1[vector];
+      state_1[vector] = state_0;
+    }
+  }
+  __m512d normalization = _mm512_set1_pd(2. / number_of_samples);
+  for (VectorSize vector = 0; vector != vectors; ++vector) {
+    __m512d cross = _mm512_mul_pd(
+        coefficient[vector], _mm512_mul_pd(state_1[vector], state_2[vector]));
+    __m512d power = _mm512_fmadd_pd(
+        state_1[vector], state_1[vector],
+        _mm512_fmsub_pd(state_2[vector], state_2[vector], cross));
+    power = _mm512_max_pd(power, _mm512_setzero_pd());
+    _mm512_storeu_pd(spectrum + 8 * vector,
+                     _mm512_mul_pd(_mm512_sqrt_pd(power), normalization));
+  }
+}
+
+__attribute__((target("avx512f"))) void
+goertzel_avx512(const double *samples, VectorSize number_of_samples,
+                const double *coefficients, VectorSize number_of_bins,
+                double *spectrum) {
+  VectorSize bin = 0;
+  for (; bin + 32 <= number_of_bins; bin += 32) {
+    goertzel_block_avx512<4>(samples, number_of_samples, coefficients + bin,
+                             spectrum + bin);
+  }
+  for (; bin + 16 <= number_of_bins; bin += 16) {
+    goertzel_block_avx512<2>(samples, number_of_samples, coefficients + bin,
+                             spectrum + bin);
+  }
+  for (; bin + 8 <= number_of_bins; bin += 8) {
+    goertzel_block_avx512<1>(samples, number_of_samples, coefficients + bin,
+                             spectrum + bin);
+  }
+  // Every CPU with AVX-512 supports AVX2 as well.
+  goertzel_avx2(samples, number_of_samples, coefficients + bin,
+                number_of_bins - bin, spectrum + bin);
+}
+
+template <VectorSize vectors>
+__attribute__((target("avx512f"))) void
+direct_block_avx512(const double *samples, VectorSize number_of_samples,
+                    VectorSize first_bin, double *spectrum) {
+  constexpr VectorSize block_size = 8 * vectors;
+  double real_values[block_size], imaginary_values[block_size];
+  evaluate_phasors(first_bin, block_size, 1, number_of_samples, real_values,
+                   imaginary_values);
+  __m512d rotation_real[vectors], rotation_imaginary[vectors];
+  __m512d phasor_real[vectors], phasor_imaginary[vectors];
+  __m512d real_part[vectors], imaginary_part[vectors];
+  for (VectorSize vector = 0; vector != vectors; ++vector) {
+    rotation_real[vector] = _mm512_loadu_pd(real_values + 8 * vector);
+    rotation_imaginary[vector] =
+        _mm512_loadu_pd(imaginary_values + 8 * vector);
+    real_part[vector] = _mm512_setzero_pd();
+    imaginary_part[vector] = _mm512_setzero_pd();
+  }
+  constexpr VectorSize period = SpectrumKernels::direct_phasor_period;
+  for (VectorSize first = 0; first < number_of_samples; first += period) {
+    evaluate_phasors(first_bin, block_size, first, number_of_samples,
+                     real_values, imaginary_values);
+    for (VectorSize vector = 0; vector != vectors; ++vector) {
+      phasor_real[vector] = _mm512_loadu_pd(real_values + 8 * vector);
+      phasor_imaginary[vector] =
+          _mm512_loadu_pd(imaginary_values + 8 * vector);
+    }
+    VectorSize last = std::min(first + period, number_of_samples);
+    for (VectorSize time_index = first; time_index != last; ++time_index) {
+      __m512d sample = _mm512_set1_pd(samples[time_index]);
+      for (VectorSize vector = 0; vector != vectors; ++vector) {
+        real_part[vector] =
+            _mm512_fmadd_pd(sample, phasor_real[vector], real_part[vector]);
+        imaginary_part[vector] = _mm512_fmadd_pd(
+            sample, phasor_imaginary[vector], imaginary_part[vector]);
+        __m512d real = phasor_real[vector];
+        phasor_real[vector] =
+            _mm512_fmsub_pd(real, rotation_real[vector],
+                            _mm512_mul_pd(phasor_imaginary[vector],
+                                          rotation_imaginary[vector]));
+        phasor_imaginary[vector] = _mm512_fmadd_pd(
+            real, rotation_imaginary[vector],
+            _mm512_mul_pd(phasor_imaginary[vector], rotation_real[vector]));
+      }
+    }
+  }
+  __m512d normalization = _mm512_set1_pd(2. / number_of_samples);
+  for (VectorSize vector = 0; vector != vectors; ++vector) {
+    __m512d power = _mm512_fmadd_pd(
+        real_part[vector], real_part[vector],
+        _mm512_mul_pd(imaginary_part[vector], imaginary_part[vector]));
+    _mm512_storeu_pd(spectrum + 8 * vector,
+                     _mm512_mul_pd(_mm512_sqrt_pd(power), normalization));
+  }
+}
+
+__attribute__((target("avx512f"))) void
+direct_avx512(const double *samples, VectorSize number_of_samples,
+              VectorSize first_bin, VectorSize number_of_bins,
+              double *spectrum) {
+  VectorSize bin = 0;
+  for (; bin + 32 <= number_of_bins; bin += 32) {
+    direct_block_avx512<4>(samples, number_of_samples, first_bin + bin,
+                           spectrum + bin);
+  }
+  for (; bin + 16 <= number_of_bins; bin += 16) {
+    direct_block_avx512<2>(samples, number_of_samples, first_bin + bin,
+                           spectrum + bin);
+  }
+  for (; bin + 8 <= number_of_bins; bin += 8) {
+    direct_block_avx512<1>(samples, number_of_samples, first_bin + bin,
+                           spectrum + bin);
+  }
+  direct_avx2(samples, number_of_samples, first_bin + bin,
+              number_of_bins - bin, spectrum + bin);
+}
+
+__attribute__((target("avx512f"))) void
+average_avx512(const double *const *spectra, VectorSize number_of_spectra,
+               VectorSize size, double *average) {
+  __m512d number = _mm512_set1_pd(static_cast<double>(number_of_spectra));
+  VectorSize index = 0;
+  for (; index + 8 <= size; index += 8) {
+    __m512d accumulator = _mm512_setzero_pd();
+    for (VectorSize spectrum = 0; spectrum != number_of_spectra; ++spectrum) {
+      accumulator = _mm512_add_pd(accumulator,
+                                  _mm512_loadu_pd(spectra[spectrum] + index));
+    }
+    _mm512_storeu_pd(average + index, _mm512_div_pd(accumulator, number));
+  }
+  average_scalar(spectra, number_of_spectra, index, size, average);
+}
+
+struct AVX512DFTBlocks {
+  template <VectorSize rows, VectorSize frames>
+  __attribute__((target("avx512f"))) static void
+  block(const double *basis, VectorSize number_of_samples,
+        const double *samples, VectorSize hop, VectorSize length, double *dft,
+        VectorSize number_of_rows) {
+    __m512d accumulators[rows][frames];
+    for (VectorSize row = 0; row != rows; ++row) {
+      for (VectorSize frame = 0; frame != frames; ++frame) {
+        accumulators[row][frame] = _mm512_setzero_pd();
+      }
+    }
+    VectorSize time_index = 0;
+    for (; time_index + 8 <= length; time_index += 8) {
+      __m512d frame_samples[frames];
+      for (VectorSize frame = 0; frame != frames; ++frame) {
+        frame_samples[frame] =
+            _mm512_loadu_pd(samples + frame * hop + time_index);
+      }
+      for (VectorSize row = 0; row != rows; ++row) {
+        __m512d value =
+            _mm512_loadu_pd(basis + row * number_of_samples + time_index);
+        for (VectorSize frame = 0; frame != frames; ++frame) {
+          accumulators[row][frame] = _mm512_fmadd_pd(
+              value, frame_samples[frame], accumulators[row][frame]);
+        }
+      }
+    }
+    for (VectorSize row = 0; row != rows; ++row) {
+      for (VectorSize frame = 0; frame != frames; ++frame) {
+        double sum = _mm512_reduce_add_pd(accumulators[row][frame]);
+        for (VectorSize index = time_index; index != length; ++index) {
+          sum += basis[row * number_of_samples + index] *
+                 samples[frame * hop + index];
+        }
+        dft[frame * number_of_rows + row] += sum;
+      }
+    }
+  }
+};
+#pragma GCC diagnostic pop
+#endif
+
+/**
+ * The kernels of the selected implementation.
+ */
+struct Dispatch {
+  Implementation implementation;
+  GoertzelKernel goertzel;
+  DirectKernel direct;
+  MagnitudesKernel magnitudes;
+  AverageKernel average;
+  DFTBatchKernel dft_batch;
+};
+
+Dispatch make_dispatch(Implementation implementation) {
+  switch (implementation) {
+#ifdef OVERTONE_X86_KERNELS
+  case Implementation::avx512:
+    // The magnitudes are bound by the memory bandwidth, so AVX-512 uses the
+    // AVX2 kernel.
+    return {implementation, goertzel_avx512, direct_avx512, magnitudes_avx2,
+            average_avx512, dft_batch_blocked<AVX512DFTBlocks>};
+  case Implementation::avx2:
+    return {implementation, goertzel_avx2, direct_avx2, magnitudes_avx2,
+            average_avx2, dft_batch_blocked<AVX2DFTBlocks>};
+#endif
+  default:
+    return {Implementation::scalar, goertzel_scalar, direct_scalar,
+            [](const double *values, VectorSize number_of_values,
+               VectorSize number_of_samples, double *magnitudes) {
+              magnitudes_scalar(values, 0, number_of_values,
+                                number_of_samples, magnitudes);
+            },
+            [](const double *const *spectra, VectorSize number_of_spectra,
+               VectorSize size, double *average) {
+              average_scalar(spectra, number_of_spectra, 0, size, average);
+            },
+            dft_batch_blocked<ScalarDFTBlocks>};
+  }
+}
+
+/**
+ * The kernels of each implementation.
+ */
+const Dispatch &get_dispatch(Implementation implementation) {
+  static const Dispatch dispatches[] = {make_dispatch(Implementation::scalar),
+                                        make_dispatch(Implementation::avx2),
+                                        make_dispatch(Implementation::avx512)};
+  return dispatches[static_cast<int>(implementation)];
+}
+
+/**
+ * The kernels of the selected implementation. The selection is atomic, so it
+ * may change while other threads run the kernels.
+ */
+std::atomic<const Dispatch *> &get_selected_dispatch() {
+  static std::atomic<const Dispatch *> selected_dispatch = [] {
+    for (Implementation implementation :
+         {Implementation::avx512, Implementation::avx2}) {
+      if (SpectrumKernels::is_supported(implementation)) {
+        return &get_dispatch(implementation);
+      }
+    }
+    return &get_dispatch(Implementation::scalar);
+  }();
+  return selected_dispatch;
+}
+
+const Dispatch &get_dispatch() {
+  return *get_selected_dispatch().load(std::memory_order_acquire);
+}
+} // namespace
+
+SpectrumKernels::Implementation SpectrumKernels::get_implementation() {
+  return get_dispatch().implementation;
+}
+
+void SpectrumKernels::set_implementation(Implementation implementation) {
+  if (!is_supported(implementation)) {
+    throw std::invalid_argument("The CPU doesn't support the implementation '" +
+                                implementation_to_name(implementation) + "'.");
+  }
+  get_selected_dispatch().store(&get_dispatch(implementation),
+                                std::memory_order_release);
+}
+
+bool SpectrumKernels::is_supported(Implementation implementation) {
+  switch (implementation) {
+  case Implementation::scalar:
+    return true;
+#ifdef OVERTONE_X86_KERNELS
+  case Implementation::avx2:
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  case Implementation::avx512:
+    return __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+  default:
+    return false;
+  }
+}
+
+std::string
+SpectrumKernels::implementation_to_name(Implementation implementation) {
+  switch (implementation) {
+  case Implementation::avx2:
+    return "avx2";
+  case Implementation::avx512:
+    return "avx512";
+  default:
+    return "scalar";
+  }
+}
+
+SpectrumKernels::Vector
+SpectrumKernels::evaluate_goertzel_coefficients(const Vector &frequencies,
+                                                VectorSize number_of_samples) {
+  Vector coefficients;
+  coefficients.reserve(frequencies.size());
+  for (const double &frequency : frequencies) {
+    coefficients.push_back(2. *
+                           std::cos(2. * M_PI * frequency / number_of_samples));
+  }
+  return coefficients;
+}
+
+SpectrumKernels::Vector
+SpectrumKernels::evaluate_dft_basis(const Vector &frequencies,
+                                    VectorSize number_of_samples) {
+  Vector basis;
+  basis.reserve(2 * frequencies.size() * number_of_samples);
+  for (const double &frequency : frequencies) {
+    for (bool sine : {false, true}) {
+      for (VectorSize time_index = 0; time_index != number_of_samples;
+           ++time_index) {
+        // The phase is reduced modulo 2 pi before the multiplication by
+        // 2 pi / N, so it stays accurate for long audio frames.
+        double cycles = std::fmod(frequency * time_index, number_of_samples);
+        double phase = 2. * M_PI * cycles / number_of_samples;
+        basis.push_back(sine ? std::sin(phase) : std::cos(phase));
+      }
+    }
+  }
+  return basis;
+}
+
+void SpectrumKernels::dft_batch(const double *samples, VectorSize hop,
+                                VectorSize number_of_frames,
+                                const double *basis, VectorSize number_of_rows,
+                                VectorSize number_of_samples, double *dft) {
+  get_dispatch().dft_batch(samples, hop, number_of_frames, basis,
+                           number_of_rows, number_of_samples, dft);
+}
+
+void SpectrumKernels::goertzel(const double *samples,
+                               VectorSize number_of_samples,
+                               const double *coefficients,
+                               VectorSize number_of_bins, double *spectrum) {
+  get_dispatch().goertzel(samples, number_of_samples, coefficients,
+                          number_of_bins, spectrum);
+}
+
+void SpectrumKernels::direct(const double *samples,
+                             VectorSize number_of_samples,
+                             VectorSize first_bin, VectorSize number_of_bins,
+                             double *spectrum) {
+  get_dispatch().direct(samples, number_of_samples, first_bin, number_of_bins,
+                        spectrum);
+}
+
+void SpectrumKernels::magnitudes(const double *values,
+                                 VectorSize number_of_values,
+                                 VectorSize number_of_samples,
+                                 double *magnitudes) {
+  get_dispatch().magnitudes(values, number_of_values, number_of_samples,
+                            magnitudes);
+}
+
+void SpectrumKernels::average(const double *const *spectra,
+                              VectorSize number_of_spectra, VectorSize size,
+                              double *average) {
+  get_dispatch().average(spectra, number_of_spectra, size, average);
+}
@@ -0,0 +1,178 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    SpectrumKernels.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_SPECTRUMKERNELS_H
+#define OVERTONE_SPECTRUMKERNELS_H
+
+#include <string>
+#include <vector>
+
+/**
+ * Inner loops of the spectrum evaluation.
+ *
+ * Each kernel has a scalar implementation and vectorized implementations for
+ * AVX2 and AVX-512. The fastest implementation that the CPU supports gets
+ * selected via cpuid when the kernels are used for the first time, so the same
+ * binary runs on every x86-64 CPU.
+ */
+class SpectrumKernels {
+public:
+  using Vector = std::vector<double>;
+  using VectorSize = Vector::size_type;
+
+  /**
+   * Implementations of the kernels.
+   */
+  enum class Implementation { scalar, avx2, avx512 };
+
+  /**
+   * @return implementation that is currently used by the kernels
+   */
+  static Implementation get_implementation();
+
+  /**
+   * Selects the implementation of the kernels, e.g., for comparing them. The
+   * selection is atomic, so other threads may run kernels meanwhile. A kernel
+   * that is already running finishes with the previous implementation.
+   * @param implementation implementation (has to be supported by the CPU)
+   */
+  static void set_implementation(Implementation implementation);
+
+  /**
+   * @param implementation implementation
+   * @return true if the CPU supports the implementation
+   */
+  static bool is_supported(Implementation implementation);
+
+  /**
+   * @param implementation implementation
+   * @return name of the implementation, e.g., "avx2"
+   */
+  static std::string implementation_to_name(Implementation implementation);
+
+  // number of bins that a Goertzel pass evaluates simultaneously
+  static constexpr VectorSize goertzel_block_size = 8;
+
+  /**
+   * Evaluates the Goertzel coefficients 2 cos(2 pi k / N).
+   * @param frequencies bin indices k (may be non-integer)
+   * @param number_of_samples number of samples N
+   * @return coefficients
+   */
+  static Vector evaluate_goertzel_coefficients(const Vector &frequencies,
+                                               VectorSize number_of_samples);
+
+  /**
+   * Evaluates the spectrum 2 |X_k| / N via Goertzel filters. The bins are
+   * processed in blocks of goertzel_block_size, so each sample is used for
+   * all the bins of a block while it's in a register and no trigonometric
+   * functions get evaluated within the loops.
+   * @param samples pointer to the first sample of the audio frame
+   * @param number_of_samples number of samples N of the audio frame
+   * @param coefficients Goertzel coefficients of the bins
+   * @param number_of_bins number of bins
+   * @param spectrum output (number_of_bins values)
+   */
+  static void goertzel(const double *samples, VectorSize number_of_samples,
+                       const double *coefficients, VectorSize number_of_bins,
+                       double *spectrum);
+
+  // number of samples after which the direct DFT re-evaluates its phasors
+  static constexpr VectorSize direct_phasor_period = 1024;
+
+  /**
+   * Evaluates the spectrum 2 |X_k| / N of the consecutive bins
+   * k = first_bin, ..., first_bin + number_of_bins - 1 directly. Each bin
+   * keeps a phasor exp(i 2 pi k n / N) that gets rotated from sample to
+   * sample, so no trigonometric functions get evaluated within the loops,
+   * and the bins are processed in blocks like the Goertzel filters. The
+   * phasors get re-evaluated every direct_phasor_period samples, so the
+   * rounding errors of the rotations don't accumulate.
+   * @param samples pointer to the first sample of the audio frame
+   * @param number_of_samples number of samples N of the audio frame
+   * @param first_bin first bin index
+   * @param number_of_bins number of bins
+   * @param spectrum output (number_of_bins values)
+   */
+  static void direct(const double *samples, VectorSize number_of_samples,
+                     VectorSize first_bin, VectorSize number_of_bins,
+                     double *spectrum);
+
+  /**
+   * Evaluates the magnitudes 2 |X_k| / N of interleaved complex values,
+   * e.g., of an FFT or of the DFTs of dft_batch().
+   * @param values real and imaginary parts of the values
+   * @param number_of_values number of complex values
+   * @param number_of_samples number of samples N of the audio frame
+   * @param magnitudes output (number_of_values values)
+   */
+  static void magnitudes(const double *values, VectorSize number_of_values,
+                         VectorSize number_of_samples, double *magnitudes);
+
+  // number of samples per cache block of the batched DFT
+  static constexpr VectorSize dft_block_size = 256;
+
+  /**
+   * Evaluates the basis of the batched DFT, whose rows 2 b and 2 b + 1 are
+   * cos(2 pi k_b n / N) and sin(2 pi k_b n / N) for n = 0, ..., N - 1.
+   * @param frequencies bin indices k_b (may be non-integer)
+   * @param number_of_samples number of samples N
+   * @return basis (2 * frequencies.size() rows of N values)
+   */
+  static Vector evaluate_dft_basis(const Vector &frequencies,
+                                   VectorSize number_of_samples);
+
+  /**
+   * Evaluates the DFTs of several audio frames that are `hop` samples apart
+   * as a matrix product of the basis and the audio frames, i.e.,
+   * dft[f * number_of_rows + r] = sum_n basis[r * N + n] samples[f hop + n].
+   * The product is evaluated in blocks of dft_block_size samples, so the
+   * rows of the basis stay in the L1 cache while they are applied to all the
+   * audio frames, and each block of 4 rows and 4 audio frames accumulates
+   * in registers.
+   * @param samples pointer to the first sample of the first audio frame
+   * @param hop distance of consecutive audio frames in samples
+   * @param number_of_frames number of audio frames
+   * @param basis basis of evaluate_dft_basis()
+   * @param number_of_rows number of rows of the basis
+   * @param number_of_samples number of samples N per audio frame
+   * @param dft output (number_of_frames * number_of_rows values)
+   */
+  static void dft_batch(const double *samples, VectorSize hop,
+                        VectorSize number_of_frames, const double *basis,
+                        VectorSize number_of_rows, VectorSize number_of_samples,
+                        double *dft);
+
+  /**
+   * Evaluates the average of several spectra of the same size.
+   * @param spectra pointers to the first values of the spectra
+   * @param number_of_spectra number of spectra (> 0)
+   * @param size number of values per spectrum
+   * @param average output (size values)
+   */
+  static void average(const double *const *spectra,
+                      VectorSize number_of_spectra, VectorSize size,
+                      double *average);
+};
+
+#endif // OVERTONE_SPECTRUMKERNELS_H
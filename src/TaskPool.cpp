@@ -0,0 +1,137 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    TaskPool.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "TaskPool.h"
+#include <stdexcept>
+
+TaskPool::TaskPool(unsigned number_of_threads) {
+  if (number_of_threads == 0) {
+    throw std::invalid_argument("The number of threads has to be nonzero.");
+  }
+  for (unsigned thread = 0; thread != number_of_threads; ++thread) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  workers.reserve(number_of_threads - 1);
+  for (unsigned thread = 1; thread != number_of_threads; ++thread) {
+    workers.emplace_back(&TaskPool::work, this, thread);
+  }
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake_up.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void TaskPool::run(std::size_t number_of_tasks,
+                   const std::function<void(std::size_t)> &task) {
+  if (number_of_tasks == 0) {
+    return;
+  }
+  // The tasks have to be visible before they can be taken.
+  current_task = &task;
+  remaining_tasks.store(number_of_tasks);
+  for (std::size_t thread = 0; thread != queues.size(); ++thread) {
+    Queue &queue = *queues[thread];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.clear();
+    queue.front = 0;
+    for (std::size_t index = thread; index < number_of_tasks;
+         index += queues.size()) {
+      queue.tasks.push_back(index);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++batch;
+  }
+  wake_up.notify_all();
+
+  execute(0);
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [&] { return remaining_tasks.load() == 0; });
+  if (task_exception) {
+    std::exception_ptr exception = task_exception;
+    task_exception = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+void TaskPool::work(unsigned thread) {
+  std::size_t seen_batch = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake_up.wait(lock, [&] { return stopping || batch != seen_batch; });
+      if (stopping) {
+        return;
+      }
+      seen_batch = batch;
+    }
+    execute(thread);
+  }
+}
+
+void TaskPool::execute(unsigned thread) {
+  std::size_t task;
+  while (take_task(thread, task)) {
+    try {
+      (*current_task)(task);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!task_exception) {
+        task_exception = std::current_exception();
+      }
+    }
+    if (remaining_tasks.fetch_sub(1) == 1) {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished.notify_all();
+    }
+  }
+}
+
+bool TaskPool::take_task(unsigned thread, std::size_t &task) {
+  {
+    Queue &queue = *queues[thread];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.front != queue.tasks.size()) {
+      task = queue.tasks[queue.front++];
+      return true;
+    }
+  }
+  for (std::size_t offset = 1; offset != queues.size(); ++offset) {
+    Queue &queue = *queues[(thread + offset) % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.front != queue.tasks.size()) {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
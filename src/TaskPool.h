@@ -0,0 +1,129 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    TaskPool.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_TASKPOOL_H
+#define OVERTONE_TASKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing thread pool for short batches of independent tasks, e.g.,
+ * the (band, channel) pairs of a single video frame.
+ *
+ * Each thread owns a deque of task indices. The tasks of a batch are dealt
+ * out round-robin in the given order, so the caller should pass the most
+ * expensive tasks first. A thread takes the tasks from the front of its own
+ * deque, and once it's empty, steals from the back of the other deques,
+ * where the cheapest tasks are. The calling thread works on the batch as
+ * well.
+ */
+class TaskPool {
+public:
+  /**
+   * Starts number_of_threads - 1 worker threads.
+   * @param number_of_threads number of threads including the calling thread
+   *                          (> 0)
+   */
+  explicit TaskPool(unsigned number_of_threads);
+
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  /**
+   * Stops the worker threads.
+   */
+  ~TaskPool();
+
+  unsigned get_number_of_threads() const { return queues.size(); }
+
+  /**
+   * Runs task(0), ..., task(number_of_tasks - 1) and waits until all of them
+   * have finished. If tasks throw, the first exception gets rethrown after
+   * all tasks have finished.
+   * @param number_of_tasks number of tasks
+   * @param task task that gets called with the index of the task
+   */
+  void run(std::size_t number_of_tasks,
+           const std::function<void(std::size_t)> &task);
+
+private:
+  // Unlike std::deque, the vector keeps its memory between the batches.
+  struct Queue {
+    std::mutex mutex;
+    std::vector<std::size_t> tasks;
+
+    // index of the front of the deque within `tasks`
+    std::size_t front{};
+  };
+
+  // deque of each thread (0: the calling thread)
+  std::vector<std::unique_ptr<Queue>> queues;
+
+  std::vector<std::thread> workers;
+
+  // task of the current batch
+  const std::function<void(std::size_t)> *current_task{};
+
+  // number of tasks of the current batch that haven't finished yet
+  std::atomic<std::size_t> remaining_tasks{};
+
+  std::mutex mutex;
+
+  // wakes up the worker threads for a new batch or for stopping
+  std::condition_variable wake_up;
+
+  // notifies the calling thread that the batch has finished
+  std::condition_variable finished;
+
+  // number of batches that have been started
+  std::size_t batch{};
+
+  bool stopping{};
+
+  // exception of the first task of the current batch that has thrown
+  std::exception_ptr task_exception;
+
+  void work(unsigned thread);
+
+  /**
+   * Runs tasks until all deques are empty.
+   */
+  void execute(unsigned thread);
+
+  /**
+   * Takes a task from the front of the own deque or steals one from the back
+   * of another deque.
+   * @return false if all deques are empty
+   */
+  bool take_task(unsigned thread, std::size_t &task);
+};
+
+#endif // OVERTONE_TASKPOOL_H
@@ -0,0 +1,81 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    VideoEncoder.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "VideoEncoder.h"
+#include <csignal>
+#include <stdexcept>
+
+VideoEncoder::VideoEncoder(const FFmpeg &ffmpeg, unsigned width,
+                           unsigned height)
+    : width(width) {
+  // If FFmpeg exits early, writing into the pipe should fail with an error
+  // instead of terminating Overtone.
+  std::signal(SIGPIPE, SIG_IGN);
+  std::string command = ffmpeg.get_encoder_command(width, height);
+  pipe = popen(command.c_str(), "w");
+  if (pipe == nullptr) {
+    throw FFmpeg::file_conversion_error("FFmpeg couldn't be started.");
+  }
+}
+
+VideoEncoder::~VideoEncoder() {
+  if (pipe != nullptr) {
+    pclose(pipe);
+  }
+}
+
+void VideoEncoder::write_rows(const FrameBuffer &buffer, unsigned first_row,
+                              unsigned number_of_rows) {
+  if (buffer.get_width() != width) {
+    throw std::invalid_argument("The width of the frame doesn't match the "
+                                "width of the video.");
+  }
+  if (number_of_rows == 0) {
+    return;
+  }
+  if (buffer.is_contiguous()) {
+    write(buffer.get_row(first_row), 3ul * width * number_of_rows);
+    return;
+  }
+  for (unsigned row = first_row; row != first_row + number_of_rows; ++row) {
+    write(buffer.get_row(row), 3ul * width);
+  }
+}
+
+void VideoEncoder::write(const unsigned char *bytes, std::size_t size) {
+  if (pipe == nullptr || std::fwrite(bytes, 1, size, pipe) != size) {
+    throw FFmpeg::file_conversion_error(
+        "FFmpeg failed to encode a video frame.");
+  }
+}
+
+void VideoEncoder::finish() {
+  if (pipe == nullptr) {
+    return;
+  }
+  int exit_code = pclose(pipe);
+  pipe = nullptr;
+  if (exit_code) {
+    throw FFmpeg::file_conversion_error("FFmpeg failed to create the video.");
+  }
+}
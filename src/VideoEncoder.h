@@ -0,0 +1,82 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    VideoEncoder.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_VIDEOENCODER_H
+#define OVERTONE_VIDEOENCODER_H
+
+#include "FFmpeg.h"
+#include "FrameBuffer.h"
+#include <cstddef>
+#include <cstdio>
+
+/**
+ * A single FFmpeg process that encodes the video frames, which get streamed
+ * into its standard input as raw RGB images, together with the audio.
+ */
+class VideoEncoder {
+public:
+  /**
+   * Starts the FFmpeg process.
+   * @param ffmpeg FFmpeg configuration (file paths and frame rate)
+   * @param width width of the frames in pixels
+   * @param height height of the frames in pixels
+   */
+  VideoEncoder(const FFmpeg &ffmpeg, unsigned width, unsigned height);
+
+  VideoEncoder(const VideoEncoder &) = delete;
+  VideoEncoder &operator=(const VideoEncoder &) = delete;
+
+  /**
+   * Closes the pipe if finish() hasn't been called, e.g., due to an
+   * exception, which lets FFmpeg finish the incomplete video.
+   */
+  ~VideoEncoder();
+
+  /**
+   * Writes rows of a frame into the pipe. A frame may be written in several
+   * parts from different buffers, as long as the parts add up to the height
+   * of the frames in scan order. Contiguous rows are written directly from
+   * the buffer, padded rows one at a time.
+   * @param buffer buffer of the width passed to the constructor
+   * @param first_row index of the first written row of the buffer
+   * @param number_of_rows number of written rows
+   */
+  void write_rows(const FrameBuffer &buffer, unsigned first_row,
+                  unsigned number_of_rows);
+
+  /**
+   * Closes the pipe and waits until FFmpeg has finished the video.
+   */
+  void finish();
+
+private:
+  // width of the frames in pixels
+  unsigned width;
+
+  // standard input of the FFmpeg process
+  FILE *pipe;
+
+  void write(const unsigned char *bytes, std::size_t size);
+};
+
+#endif // OVERTONE_VIDEOENCODER_H
@@ -22,264 +22,168 @@
 ******************************************************************************/
 
 #include "VideoFrame.h"
-#include <iomanip>
-#include <iostream>
-
-VideoFrame::VideoFrame(FFmpeg ffmpeg, double gain, double gate,
-                       std::string theme, unsigned history_speed,
-                       Keyboard keyboard)
-    : frame(), tmp_row(), history_speed(history_speed),
-      ffmpeg(std::move(ffmpeg)), frame_width(1920), frame_height(1080),
-      white_keys({0,  2,  3,  5,  7,  8,  10, 12, 14, 15, 17, 19, 20,
-                  22, 24, 26, 27, 29, 31, 32, 34, 36, 38, 39, 41, 43,
-                  44, 46, 48, 50, 51, 53, 55, 56, 58, 60, 62, 63, 65,
-                  67, 68, 70, 72, 74, 75, 77, 79, 80, 82, 84, 86, 87}),
-      black_keys({1,  4,  6,  9,  11, 13, 16, 18, 21, 23, 25, 28,
-                  30, 33, 35, 37, 40, 42, 45, 47, 49, 52, 54, 57,
-                  59, 61, 64, 66, 69, 71, 73, 76, 78, 81, 83, 85}),
-      red(0), green(0), blue(0), keyboard(std::move(keyboard)),
-      color_map(std::move(theme), gain, gate) {
-  if (history_speed == 0 || history_speed > 786) {
+#include <algorithm>
+#include <stdexcept>
+
+VideoFrame::VideoFrame(double gain, double gate, std::string theme,
+                       unsigned history_speed)
+    : history_speed(history_speed), geometry(),
+      frame(Geometry::frame_width, Geometry::frame_height),
+      history_length(history_speed < Geometry::history_height
+                         ? Geometry::history_height - history_speed
+                         : 0),
+      history_head(0), number_of_frames(0),
+      color_map(std::move(theme), gain, gate),
+      background_color(color_map(0)), edge_color(color_map.get_edge_color()),
+      key_colors(), previous_key_colors() {
+  if (history_speed == 0 || history_speed > Geometry::history_height) {
     throw std::out_of_range(
         "The argument `history_speed` is not within the interval [1, 786].");
   }
-  initialize_video_frame();
   layer_0_background();
   layer_1_frame();
-}
-
-void VideoFrame::initialize_video_frame() {
-  for (FrameSize row_index = 0; row_index < frame_height; ++row_index) {
-    Pixel pixel({0, 0, 0});
-    Row row;
-    for (RowSize column_index = 0; column_index < frame_width; ++column_index) {
-      row.push_back(pixel);
-    }
-    frame.push_back(row);
-  }
-  Pixel pixel({0, 0, 0});
-  Row row;
-  for (RowSize column_index = 0; column_index < frame_width; ++column_index) {
-    tmp_row.push_back(pixel);
+  layer_2_static_keyboard();
+  for (unsigned row = 1; row < history_length; ++row) {
+    frame.copy_rows(Geometry::history_row + row, Geometry::history_row, 1);
   }
 }
 
-bool VideoFrame::evaluate_frame(const unsigned &frame_index) {
-  layer_2_history();
-  layer_3_white_keys();
-  layer_4_black_keys();
-  layer_5_horizontal_separator();
-  save_frame(frame_index);
-  return keyboard.go_to_next_frame();
+void VideoFrame::render(const Vector &keyboard) {
+  color_map.evaluate_colors(keyboard, key_colors);
+  layer_3_history();
+  layer_4_keys();
+  ++number_of_frames;
 }
 
-void VideoFrame::save_frame(const unsigned &frame_index) {
-  std::string ppm_file_path =
-      ffmpeg.get_frames_directory_path() + "/current_frame.ppm";
-  std::ofstream ppm_file(ppm_file_path);
-  if (!ppm_file) {
-    throw std::invalid_argument("Can't access '" + ppm_file_path + "'.");
+void VideoFrame::render(const Vector &keyboard, FrameBuffer &destination) {
+  render(keyboard);
+  // The current key colors are in previous_key_colors after layer_4_keys().
+  auto match = std::find_if(destinations.begin(), destinations.end(),
+                            [&](const Destination &candidate) {
+                              return candidate.frame == &destination;
+                            });
+  if (match == destinations.end()) {
+    for (unsigned row = 0; row != Geometry::frame_height; ++row) {
+      destination.copy_row(row, frame, row);
+    }
+    destinations.push_back({&destination, number_of_frames,
+                            previous_key_colors});
+    return;
   }
-  ppm_file << "P6\n"
-           << frame_width << ' ' << frame_height << '\n'
-           << "255" << '\n';
-  for (FrameSize row = 0; row < frame_height; ++row)
-    for (RowSize column = 0; column < frame_width; ++column) {
-      ppm_file << frame[row][column][0] << frame[row][column][1]
-               << frame[row][column][2];
-    }
-  ppm_file << std::flush;
 
-  std::ostringstream png_file_path;
-  png_file_path << ffmpeg.get_frames_directory_path() << "/"
-                << std::setfill('0') << std::setw(7) << frame_index << ".png";
-  std::string command = "'" + ffmpeg.get_ffmpeg_executable_path() + "' -i '" +
-                        ppm_file_path + "' '" + png_file_path.str() +
-                        "' -y 1>/dev/null 2>&1";
-  if (std::system(command.c_str())) {
-    throw FFmpeg::file_conversion_error("Conversion from '" + ppm_file_path +
-                                        "' to '" + png_file_path.str() +
-                                        " failed.");
+  // the rows that have been pushed into the history since the last update
+  FrameIndex pushed_rows =
+      (number_of_frames - match->number_of_frames) *
+      std::min(history_speed, history_length);
+  if (pushed_rows >= history_length) {
+    pushed_rows = history_length;
+  }
+  for (FrameIndex counter = 0; counter != pushed_rows; ++counter) {
+    unsigned row = (history_head + history_length - pushed_rows + counter) %
+                   history_length;
+    destination.copy_row(Geometry::history_row + row, frame,
+                         Geometry::history_row + row);
   }
+  for (unsigned row = Geometry::separator_row - history_speed;
+       row != Geometry::separator_row; ++row) {
+    destination.copy_row(row, frame, row);
+  }
+
+  // the keys whose colors have changed since the last update
+  const auto &runs = geometry.get_key_runs();
+  for (unsigned key = 0; key != Geometry::number_of_keys; ++key) {
+    const Color &color = previous_key_colors[key];
+    if (color == match->key_colors[key]) {
+      continue;
+    }
+    auto last_run = geometry.get_first_run(key + 1);
+    for (auto run = geometry.get_first_run(key); run != last_run; ++run) {
+      destination.fill_span(runs[run].row, runs[run].column, runs[run].length,
+                            color);
+    }
+    match->key_colors[key] = color;
+  }
+  match->number_of_frames = number_of_frames;
 }
 
-inline void VideoFrame::set_pixel(const FrameSize &row,
-                                  const FrameSize &column) {
-  frame[row][column].assign({red, green, blue});
+void VideoFrame::write(VideoEncoder &encoder) const {
+  write_frame(encoder, frame, history_head);
 }
 
-void VideoFrame::set_color(double input_value) {
-  auto rgb_color = color_map(input_value);
-  red = rgb_color[0];
-  green = rgb_color[1];
-  blue = rgb_color[2];
+void VideoFrame::write(VideoEncoder &encoder, const FrameBuffer &buffer,
+                       FrameIndex frame_index) const {
+  // Each video frame pushes the same number of rows into the history.
+  unsigned head = 0;
+  if (history_length != 0) {
+    head = (frame_index + 1) % history_length *
+           std::min(history_speed, history_length) % history_length;
+  }
+  write_frame(encoder, buffer, head);
 }
 
-void VideoFrame::set_edge_color() {
-  auto rgb_color = color_map.get_edge_color();
-  red = rgb_color[0];
-  green = rgb_color[1];
-  blue = rgb_color[2];
+void VideoFrame::write_frame(VideoEncoder &encoder, const FrameBuffer &buffer,
+                             unsigned history_head) const {
+  encoder.write_rows(buffer, 0, Geometry::history_row);
+  encoder.write_rows(buffer, Geometry::history_row + history_head,
+                     history_length - history_head);
+  encoder.write_rows(buffer, Geometry::history_row, history_head);
+  unsigned first_row = Geometry::separator_row - history_speed;
+  encoder.write_rows(buffer, first_row, Geometry::frame_height - first_row);
 }
 
 void VideoFrame::layer_0_background() {
-  set_color(0);
-  for (FrameSize row = 0; row < frame_height; ++row) {
-    for (RowSize column = 0; column < frame_width; ++column) {
-      frame[row][column].assign({red, green, blue});
-    }
-  }
+  frame.fill_rectangle(0, 0, Geometry::frame_height, Geometry::frame_width,
+                       background_color);
 }
 
 void VideoFrame::layer_1_frame() {
-  set_edge_color();
-  for (FrameSize row = 0; row != frame_height; ++row) {
-    for (FrameSize column = 0; column != 24; ++column) {
-      set_pixel(row, column);
-    }
-    for (FrameSize column = frame_width - 24; column != frame_width; ++column) {
-      set_pixel(row, column);
-    }
-  }
-  for (FrameSize column = 0; column != frame_width; ++column) {
-    for (FrameSize row = 0; row != 24; ++row) {
-      set_pixel(row, column);
-    }
-    for (FrameSize row = frame_height - 24; row != frame_height; ++row) {
-      set_pixel(row, column);
-    }
-  }
+  const unsigned width = Geometry::frame_width;
+  const unsigned height = Geometry::frame_height;
+  const unsigned border = Geometry::border;
+  frame.fill_rectangle(0, 0, border, width, edge_color);
+  frame.fill_rectangle(border, 0, height - 2 * border, border, edge_color);
+  frame.fill_rectangle(border, width - border, height - 2 * border, border,
+                       edge_color);
+  frame.fill_rectangle(height - border, 0, border, width, edge_color);
 }
 
-inline void VideoFrame::layer_2_history() {
-  for (FrameSize row = 809; row != 809 - history_speed + 1; --row) {
-    frame[row - 1] = frame[row];
-  }
-  for (FrameSize row = 24; row != 810 - history_speed; ++row) {
-    frame[row] = frame[row + history_speed];
+void VideoFrame::layer_2_static_keyboard() {
+  for (const auto &run : geometry.get_static_runs()) {
+    frame.fill_span(run.row, run.column, run.length,
+                    run.role == Geometry::edge ? edge_color
+                                               : background_color);
   }
 }
 
-void VideoFrame::layer_3_white_keys() {
-  FrameSize column = 24;
-  for (VectorSize white_key : white_keys) {
-    set_edge_color();
-    for (FrameSize column_counter = 0; column_counter != 2; ++column_counter) {
-      for (FrameSize row = 822; row != 1056; ++row) {
-        set_pixel(row, column);
-      }
-      ++column;
-    }
-    set_color((*keyboard.get_keyboard())[white_key]);
-    for (FrameSize column_counter = 0; column_counter != 32; ++column_counter) {
-      for (FrameSize row = 809; row != 1056; ++row) {
-        set_pixel(row, column);
-      }
-      ++column;
-    }
-    set_edge_color();
-    for (FrameSize column_counter = 0; column_counter != 2; ++column_counter) {
-      for (FrameSize row = 822; row != 1056; ++row) {
-        set_pixel(row, column);
-      }
-      ++column;
-    }
+inline void VideoFrame::layer_3_history() {
+  // The key row is the newest row of the history. Before the keys overwrite
+  // it, it's repeated history_speed - 1 times above itself and pushed
+  // history_speed times into the ring buffer.
+  const unsigned key_row = Geometry::key_row;
+  for (unsigned row = key_row + 1 - history_speed; row != key_row; ++row) {
+    frame.copy_rows(row, key_row, 1);
   }
-}
-
-void VideoFrame::layer_4_black_keys() {
-  FrameSize column = 51;
-
-  unsigned c_sharp = 0;
-  unsigned f_sharp = 2;
-  unsigned a_sharp = 4;
-
-  unsigned note = a_sharp;
-
-  for (VectorSize key : black_keys) {
-    if (note == c_sharp || note == f_sharp) {
-      // There are no black keys between H & C and E & F.
-      column += 36;
-      ++note;
-    } else if (note == a_sharp) {
-      note = c_sharp;
-    } else {
-      ++note;
-    }
-
-    set_edge_color();
-
-    // Left black line
-    for (FrameSize column_counter = 0; column_counter != 4; ++column_counter) {
-      for (FrameSize row = 822; row != 980; ++row) {
-        set_pixel(row, column);
-      }
-      ++column;
-    }
-
-    column -= 4;
-
-    // Left side of the first row of the history
-    set_color(0);
-    {
-      FrameSize row = 809;
-      for (FrameSize column_counter = 0; column_counter != 4;
-           ++column_counter) {
-        set_pixel(row, column);
-        ++column;
-      }
-    }
-
-    set_color((*keyboard.get_keyboard())[key]);
-
-    // Colored part in the middle
-    for (FrameSize column_counter = 0; column_counter != 10; ++column_counter) {
-      for (FrameSize row = 809; row != 976; ++row) {
-        set_pixel(row, column);
-      }
-      ++column;
-    }
-
-    set_edge_color();
-
-    // Black line at the bottom
-    column -= 10;
-    for (FrameSize column_counter = 0; column_counter != 10; ++column_counter) {
-      for (FrameSize row = 976; row != 980; ++row) {
-        set_pixel(row, column);
-      }
-      ++column;
-    }
-
-    // Right black line
-    for (FrameSize column_counter = 0; column_counter != 4; ++column_counter) {
-      for (FrameSize row = 822; row != 980; ++row) {
-        set_pixel(row, column);
-      }
-      ++column;
-    }
-
-    column -= 4;
-    // Left side of the first row of the history
-    set_color(0);
-    {
-      FrameSize row = 809;
-      for (FrameSize column_counter = 0; column_counter != 4;
-           ++column_counter) {
-        set_pixel(row, column);
-        ++column;
-      }
-    }
-
-    column += 18;
+  for (unsigned counter = 0; counter != std::min(history_speed, history_length);
+       ++counter) {
+    frame.copy_rows(Geometry::history_row + history_head, key_row, 1);
+    history_head = (history_head + 1) % history_length;
   }
 }
 
-void VideoFrame::layer_5_horizontal_separator() {
-  set_edge_color();
-  for (FrameSize row = 810; row != 822; ++row) {
-    for (FrameSize column = 0; column != frame_width; ++column) {
-      set_pixel(row, column);
+void VideoFrame::layer_4_keys() {
+  // Only the keys whose colors have changed are repainted.
+  const auto &runs = geometry.get_key_runs();
+  for (unsigned key = 0; key != Geometry::number_of_keys; ++key) {
+    const Color &color = key_colors[key];
+    if (key < previous_key_colors.size() &&
+        color == previous_key_colors[key]) {
+      continue;
+    }
+    auto last_run = geometry.get_first_run(key + 1);
+    for (auto run = geometry.get_first_run(key); run != last_run; ++run) {
+      frame.fill_span(runs[run].row, runs[run].column, runs[run].length,
+                      color);
     }
   }
+  std::swap(key_colors, previous_key_colors);
 }
@@ -25,78 +25,121 @@
 #define OVERTONE_VIDEOFRAME_H
 
 #include "ColorMap.h"
-#include "FFmpeg.h"
-#include "Keyboard.h"
+#include "FrameBuffer.h"
+#include "KeyboardGeometry.h"
+#include "VideoEncoder.h"
+#include <cstddef>
 #include <string>
 #include <vector>
 
+/**
+ * Renders the video frames one after another. Each video frame is rendered
+ * on top of the previous one, so only the history and the keys whose colors
+ * have changed are redrawn.
+ *
+ * The history is stored as a ring buffer of rows within the rows of the
+ * history. A video frame can also be rendered into another frame buffer of
+ * this layout, e.g., into the buffers of a queue, which receives only the
+ * rows and keys that have changed since the buffer was rendered last.
+ */
 class VideoFrame {
 public:
+  using Vector = std::vector<double>;
+  using FrameIndex = std::size_t;
+
   /**
-   * @param ffmpeg
    * @param gain multiplies each key of the keyboard by this value
    * @param gate all keys below this threshold are set to 0
    *             (0.0 <= gate <= 1.0)
    * @param theme name of the color theme
    * @param history_speed speed of the history in pixel rows per video frame
-   * @param keyboard
    */
-  VideoFrame(FFmpeg ffmpeg, double gain, double gate, std::string theme,
-             unsigned history_speed, Keyboard keyboard);
+  VideoFrame(double gain, double gate, std::string theme,
+             unsigned history_speed);
+
+  /**
+   * Renders the next video frame.
+   * @param keyboard keyboard of the video frame
+   */
+  void render(const Vector &keyboard);
+
+  /**
+   * Renders the next video frame and updates a frame buffer to it.
+   * @param keyboard keyboard of the video frame
+   * @param destination frame buffer of the size of the video frames, which
+   *                    only gets updated by this function (it doesn't
+   *                    contain the video frame in scan order)
+   */
+  void render(const Vector &keyboard, FrameBuffer &destination);
 
   /**
-   * Evaluates the current video frame.
-   * @param frame_index saves the video frame into frame_index.png
-   * @return false if it's the last frame of the video
+   * Passes the current video frame to the encoder.
+   * @param encoder encodes the video frames
    */
-  bool evaluate_frame(const unsigned &frame_index);
+  void write(VideoEncoder &encoder) const;
+
+  /**
+   * Passes a video frame that has been rendered into a frame buffer to the
+   * encoder. Unlike the other functions, it may be called concurrently with
+   * render().
+   * @param encoder encodes the video frames
+   * @param buffer frame buffer that has been passed to render()
+   * @param frame_index index of the video frame in the frame buffer
+   */
+  void write(VideoEncoder &encoder, const FrameBuffer &buffer,
+             FrameIndex frame_index) const;
 
 private:
-  using Vector = std::vector<double>;
   using VectorSize = Vector::size_type;
-  using Pixel = std::vector<unsigned char>;
-  using Row = std::vector<Pixel>;
-  using RowSize = Row::size_type;
-  using Frame = std::vector<Row>;
-  using FrameSize = Frame::size_type;
-  Frame frame;
-  Row tmp_row;
+  using Color = FrameBuffer::Color;
+  using Geometry = KeyboardGeometry;
 
   // speed of the history in pixel rows per video frame
   unsigned history_speed;
 
-  FFmpeg ffmpeg;
-  unsigned frame_width;
-  unsigned frame_height;
+  Geometry geometry;
+  FrameBuffer frame;
+
+  // The history scrolls up by history_speed rows per video frame. The rows
+  // Geometry::history_row ... Geometry::key_row - history_speed of the video
+  // frame are stored as a ring buffer in the first history_length rows of
+  // the history of `frame`, which avoids moving the whole history every
+  // frame. The oldest row is at history_head.
+  unsigned history_length;
+  unsigned history_head;
+
+  // number of rendered video frames
+  FrameIndex number_of_frames;
+
+  // a frame buffer that has been passed to render(), the number of video
+  // frames at that time, and the colors of its keys
+  struct Destination {
+    const FrameBuffer *frame;
+    FrameIndex number_of_frames;
+    std::vector<Color> key_colors;
+  };
+  std::vector<Destination> destinations;
 
-  // indices of the white_keys
-  const std::vector<VectorSize> white_keys;
-
-  // indices of the black keys
-  const std::vector<VectorSize> black_keys;
-
-  // RGB color of the current pixel
-  unsigned char red, green, blue;
-
-  Keyboard keyboard;
   ColorMap color_map;
+  Color background_color;
+  Color edge_color;
+
+  // colors of the keys of the current and of the previous video frame
+  std::vector<Color> key_colors;
+  std::vector<Color> previous_key_colors;
 
-  void initialize_video_frame();
-  inline void set_pixel(const FrameSize &row, const FrameSize &column);
-  inline void set_color(double input_value);
-  inline void set_edge_color();
   inline void layer_0_background();
   inline void layer_1_frame();
-  inline void layer_2_history();
-  inline void layer_3_white_keys();
-  inline void layer_4_black_keys();
-  inline void layer_5_horizontal_separator();
+  inline void layer_2_static_keyboard();
+  inline void layer_3_history();
+  inline void layer_4_keys();
 
   /**
-   * Saves the current video frame into the file frame_index.png.
-   * @param frame_index
+   * Passes a frame buffer in the layout of `frame` to the encoder.
+   * @param history_head position of the oldest row of the history
    */
-  void save_frame(const unsigned &frame_index);
+  void write_frame(VideoEncoder &encoder, const FrameBuffer &buffer,
+                   unsigned history_head) const;
 };
 
 #endif // OVERTONE_VIDEOFRAME_H
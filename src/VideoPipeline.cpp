@@ -0,0 +1,145 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    VideoPipeline.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "VideoPipeline.h"
+#include "KeyboardGeometry.h"
+#include <thread>
+
+namespace {
+std::vector<FrameBuffer> allocate_frames(unsigned number_of_frames) {
+  if (number_of_frames == 0) {
+    throw std::invalid_argument("The frame queue needs at least one frame.");
+  }
+  std::vector<FrameBuffer> frames;
+  frames.reserve(number_of_frames);
+  for (unsigned frame = 0; frame != number_of_frames; ++frame) {
+    frames.emplace_back(KeyboardGeometry::frame_width,
+                        KeyboardGeometry::frame_height);
+  }
+  return frames;
+}
+} // namespace
+
+VideoPipeline::VideoPipeline(std::shared_ptr<KeyboardSource> keyboard,
+                             std::shared_ptr<VideoFrame> video_frame,
+                             std::shared_ptr<VideoEncoder> encoder,
+                             unsigned keyboard_queue_size,
+                             unsigned frame_queue_size)
+    : keyboard(std::move(keyboard)), video_frame(std::move(video_frame)),
+      encoder(std::move(encoder)),
+      keyboards(std::vector<Vector>(keyboard_queue_size,
+                                    Vector(KeyboardGeometry::number_of_keys))),
+      frames(allocate_frames(frame_queue_size)) {
+  statistics.keyboard_queue.capacity = keyboards.get_capacity();
+  statistics.frame_queue.capacity = frames.get_capacity();
+}
+
+void VideoPipeline::run(const std::function<void(FrameIndex)> &frame_written) {
+  const auto start = Clock::now();
+  std::thread analysis_thread(&VideoPipeline::run_stage, this,
+                              VideoStatistics::analysis,
+                              [this] { analyse(); });
+  std::thread rendering_thread(&VideoPipeline::run_stage, this,
+                               VideoStatistics::rendering,
+                               [this] { render(); });
+  run_stage(VideoStatistics::encoding, [&] { encode(frame_written); });
+  analysis_thread.join();
+  rendering_thread.join();
+  statistics.wall_clock_time = Clock::now() - start;
+
+  auto &stages = statistics.stages;
+  stages[VideoStatistics::analysis].waiting_time =
+      keyboards.get_producer_waiting_time();
+  stages[VideoStatistics::rendering].waiting_time =
+      keyboards.get_consumer_waiting_time() +
+      frames.get_producer_waiting_time();
+  stages[VideoStatistics::encoding].waiting_time =
+      frames.get_consumer_waiting_time();
+  for (auto &stage : stages) {
+    stage.busy_time -= stage.waiting_time;
+  }
+  statistics.keyboard_queue.mean_depth = keyboards.get_mean_depth();
+  statistics.frame_queue.mean_depth = frames.get_mean_depth();
+
+  if (stage_exception) {
+    std::rethrow_exception(stage_exception);
+  }
+}
+
+void VideoPipeline::run_stage(Stage stage,
+                              const std::function<void()> &function) {
+  const auto start = Clock::now();
+  try {
+    function();
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(exception_mutex);
+      if (!stage_exception) {
+        stage_exception = std::current_exception();
+      }
+    }
+    keyboards.cancel();
+    frames.cancel();
+  }
+  // The waiting time gets subtracted in run().
+  statistics.stages[stage].busy_time = Clock::now() - start;
+}
+
+void VideoPipeline::analyse() {
+  do {
+    Vector *slot = keyboards.get_free_slot();
+    if (!slot) {
+      return;
+    }
+    const Vector &current_keyboard = *keyboard->get_keyboard();
+    slot->assign(current_keyboard.cbegin(), current_keyboard.cend());
+    keyboards.push();
+  } while (keyboard->go_to_next_frame());
+  keyboards.close();
+}
+
+void VideoPipeline::render() {
+  // The video frames are rendered directly into the slots of the queue, which
+  // only receive the parts that have changed since their previous video
+  // frame.
+  while (const Vector *current_keyboard = keyboards.front()) {
+    FrameBuffer *frame = frames.get_free_slot();
+    if (!frame) {
+      return;
+    }
+    video_frame->render(*current_keyboard, *frame);
+    keyboards.pop();
+    frames.push();
+  }
+  frames.close();
+}
+
+void VideoPipeline::encode(
+    const std::function<void(FrameIndex)> &frame_written) {
+  FrameIndex number_of_written_frames = 0;
+  while (const FrameBuffer *frame = frames.front()) {
+    video_frame->write(*encoder, *frame, number_of_written_frames);
+    frames.pop();
+    frame_written(++number_of_written_frames);
+  }
+}
@@ -0,0 +1,106 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    VideoPipeline.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_VIDEOPIPELINE_H
+#define OVERTONE_VIDEOPIPELINE_H
+
+#include "FrameBuffer.h"
+#include "KeyboardSource.h"
+#include "SPSCQueue.h"
+#include "VideoEncoder.h"
+#include "VideoFrame.h"
+#include "VideoStatistics.h"
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+/**
+ * Analyses, renders and encodes the video frames in three concurrent stages.
+ *
+ * The analysis thread reads the keyboards into a queue of keyboards, the
+ * rendering thread renders the video frames from them with a VideoFrame into
+ * a queue of frames, and the calling thread passes these frames to the
+ * encoder. The stages are connected by bounded lock-free queues of
+ * preallocated buffers, so the wall-clock time approaches the time of the
+ * slowest stage instead of the sum of the times of all stages.
+ */
+class VideoPipeline {
+public:
+  using Vector = KeyboardSource::Vector;
+  using FrameIndex = std::size_t;
+  using Clock = VideoStatistics::Clock;
+  using Stage = VideoStatistics::Stage;
+
+  /**
+   * @param keyboard provides the keyboard of each video frame
+   * @param video_frame renders the video frames
+   * @param encoder encodes the video frames
+   * @param keyboard_queue_size number of buffered keyboards (> 0)
+   * @param frame_queue_size number of buffered video frames (> 0)
+   */
+  VideoPipeline(std::shared_ptr<KeyboardSource> keyboard,
+                std::shared_ptr<VideoFrame> video_frame,
+                std::shared_ptr<VideoEncoder> encoder,
+                unsigned keyboard_queue_size = 16,
+                unsigned frame_queue_size = 4);
+
+  VideoPipeline(const VideoPipeline &) = delete;
+  VideoPipeline &operator=(const VideoPipeline &) = delete;
+
+  /**
+   * Analyses, renders and encodes all video frames.
+   * @param frame_written gets called with the number of written video frames
+   *                      after each video frame
+   */
+  void run(const std::function<void(FrameIndex)> &frame_written);
+
+  /**
+   * @return statistics of the stages and queues after run()
+   */
+  const VideoStatistics &get_statistics() const { return statistics; }
+
+private:
+  std::shared_ptr<KeyboardSource> keyboard;
+  std::shared_ptr<VideoFrame> video_frame;
+  std::shared_ptr<VideoEncoder> encoder;
+  SPSCQueue<Vector> keyboards;
+  SPSCQueue<FrameBuffer> frames;
+  VideoStatistics statistics;
+
+  // the first exception thrown by a stage
+  std::mutex exception_mutex;
+  std::exception_ptr stage_exception;
+
+  void analyse();
+  void render();
+  void encode(const std::function<void(FrameIndex)> &frame_written);
+
+  /**
+   * Runs a stage, measures its time, and cancels the queues if the stage
+   * throws an exception.
+   */
+  void run_stage(Stage stage, const std::function<void()> &function);
+};
+
+#endif // OVERTONE_VIDEOPIPELINE_H
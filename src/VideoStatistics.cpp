@@ -0,0 +1,38 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    VideoStatistics.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "VideoStatistics.h"
+#include <stdexcept>
+
+std::string VideoStatistics::get_stage_name(Stage stage) {
+  switch (stage) {
+  case analysis:
+    return "analysis";
+  case rendering:
+    return "rendering";
+  case encoding:
+    return "encoding";
+  default:
+    throw std::out_of_range("Invalid stage.");
+  }
+}
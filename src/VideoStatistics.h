@@ -0,0 +1,75 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    VideoStatistics.h
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OVERTONE_VIDEOSTATISTICS_H
+#define OVERTONE_VIDEOSTATISTICS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+ * Times of the stages (analysis, rendering, encoding) and depths of the
+ * queues between them while a video gets rendered, e.g., by a VideoPipeline
+ * or a ParallelVideo.
+ */
+class VideoStatistics {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum Stage { analysis, rendering, encoding, number_of_stages };
+
+  struct StageStatistics {
+    // time that the stage has spent on its own work
+    Clock::duration busy_time{};
+
+    // time that the stage has waited for its input or for free space in its
+    // output queue
+    Clock::duration waiting_time{};
+  };
+
+  struct QueueStatistics {
+    std::size_t capacity{};
+
+    // mean number of buffers in the queue right after a push
+    double mean_depth{};
+  };
+
+  Clock::duration wall_clock_time{};
+  std::array<StageStatistics, number_of_stages> stages{};
+
+  // queue of the keyboards (analysis -> rendering)
+  QueueStatistics keyboard_queue;
+
+  // queue of the video frames (rendering -> encoding)
+  QueueStatistics frame_queue;
+
+  /**
+   * @param stage stage
+   * @return name of the stage
+   */
+  static std::string get_stage_name(Stage stage);
+};
+
+#endif // OVERTONE_VIDEOSTATISTICS_H
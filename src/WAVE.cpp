@@ -23,138 +23,232 @@
 
 #include "WAVE.h"
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
-void WAVE::read(std::ifstream &file, uint16_t &destination) {
-  char bytes[2];
-  file.read(bytes, 2);
-  destination = static_cast<unsigned char>(bytes[0]) |
-                static_cast<unsigned char>(bytes[1]) << 8;
+namespace {
+/**
+ * Converts the samples of one channel. The number of channels is a template
+ * parameter for the common cases, so the compiler can vectorize the strided
+ * loads.
+ */
+template <std::size_t NumberOfChannels>
+void deinterleave(const int16_t *block, std::size_t number_of_frames,
+                  std::size_t channel, double *destination) {
+  for (std::size_t frame = 0; frame != number_of_frames; ++frame) {
+    destination[frame] =
+        block[frame * NumberOfChannels + channel] * (1. / 32768.);
+  }
+}
+
+void deinterleave(const int16_t *block, std::size_t number_of_frames,
+                  std::size_t number_of_channels, std::size_t channel,
+                  double *destination) {
+  for (std::size_t frame = 0; frame != number_of_frames; ++frame) {
+    destination[frame] =
+        block[frame * number_of_channels + channel] * (1. / 32768.);
+  }
 }
+} // namespace
 
-void WAVE::read(std::ifstream &file, int16_t &destination) {
-  char bytes[2];
-  file.read(bytes, 2);
-  destination = static_cast<unsigned char>(bytes[0]) |
-                static_cast<unsigned char>(bytes[1]) << 8;
+void WAVE::read(Cursor &cursor, uint16_t &destination) {
+  if (cursor.end - cursor.position < 2) {
+    throw WAVE::parsing_error("Unexpected end of file.");
+  }
+  const unsigned char *bytes = cursor.position;
+  destination = bytes[0] | bytes[1] << 8;
+  cursor.position += 2;
 }
 
-void WAVE::read(std::ifstream &file, uint32_t &destination) {
-  char bytes[4];
-  file.read(bytes, 4);
-  destination = static_cast<unsigned char>(bytes[0]) |
-                static_cast<unsigned char>(bytes[1]) << 8 |
-                static_cast<unsigned char>(bytes[2]) << 16 |
-                static_cast<unsigned char>(bytes[3]) << 24;
+void WAVE::read(Cursor &cursor, uint32_t &destination) {
+  if (cursor.end - cursor.position < 4) {
+    throw WAVE::parsing_error("Unexpected end of file.");
+  }
+  const unsigned char *bytes = cursor.position;
+  destination = bytes[0] | bytes[1] << 8 | bytes[2] << 16 |
+                static_cast<uint32_t>(bytes[3]) << 24;
+  cursor.position += 4;
 }
 
-void WAVE::read(std::ifstream &file, std::string &destination) {
-  char bytes[5];
-  file.read(bytes, 4);
-  bytes[4] = '\0';
-  destination.assign(bytes);
+void WAVE::read(Cursor &cursor, std::string &destination) {
+  if (cursor.end - cursor.position < 4) {
+    throw WAVE::parsing_error("Unexpected end of file.");
+  }
+  destination.assign(reinterpret_cast<const char *>(cursor.position), 4);
+  cursor.position += 4;
 }
 
-void WAVE::search_chunk(std::ifstream &file, const std::string &wanted_chunk_id,
+void WAVE::search_chunk(Cursor &cursor, const std::string &wanted_chunk_id,
                         uint32_t &found_chunk_size) {
   std::string current_chunk_id;
-  while (current_chunk_id != wanted_chunk_id && file) {
-    read(file, current_chunk_id);
-    read(file, found_chunk_size);
-    if (current_chunk_id != wanted_chunk_id) {
-      for (uint32_t byte_index = 0; byte_index != found_chunk_size;
-           ++byte_index) {
-        char tmp;
-        file.get(tmp);
-      }
+  while (cursor.end - cursor.position >= 8) {
+    read(cursor, current_chunk_id);
+    read(cursor, found_chunk_size);
+    if (current_chunk_id == wanted_chunk_id) {
+      return;
     }
+    // Chunks are padded to an even number of bytes.
+    std::size_t skipped_bytes = found_chunk_size + (found_chunk_size & 1);
+    if (static_cast<std::size_t>(cursor.end - cursor.position) <
+        skipped_bytes) {
+      break;
+    }
+    cursor.position += skipped_bytes;
   }
-  if (!file) {
-    throw WAVE::parsing_error("Chunk '" + wanted_chunk_id + "' not found.");
-  }
+  throw WAVE::parsing_error("Chunk '" + wanted_chunk_id + "' not found.");
 }
 
-void WAVE::parse_riff_chunk_head(std::ifstream &file) {
-  read(file, chunk_id);
+void WAVE::parse_riff_chunk_head(Cursor &cursor) {
+  read(cursor, chunk_id);
   if (chunk_id != "RIFF") {
     throw WAVE::parsing_error("File is not a RIFF file.");
   }
 
-  read(file, chunk_size);
-  read(file, format);
+  read(cursor, chunk_size);
+  read(cursor, format);
   if (format != "WAVE") {
     throw WAVE::parsing_error("The RIFF file is not a WAVE file.");
   }
-  if (!file) {
-    throw WAVE::parsing_error("Parsing of the chunk '" + chunk_id +
-                              "' failed.");
-  }
 }
 
-void WAVE::parse_format_chunk(std::ifstream &file) {
+void WAVE::parse_format_chunk(Cursor &cursor) {
   format_chunk_id = "fmt ";
-  search_chunk(file, format_chunk_id, format_chunk_size);
+  search_chunk(cursor, format_chunk_id, format_chunk_size);
 
   if (format_chunk_size != 16) {
     throw WAVE::parsing_error("The size of the format chunk isn't 16 bytes.");
   }
-  read(file, audio_format);
+  read(cursor, audio_format);
   if (audio_format != 1) {
     throw WAVE::parsing_error("The audio format isn't PCM.");
   }
-  read(file, number_of_channels);
-  read(file, sample_rate);
-  read(file, byte_rate);
-  read(file, block_align);
-  read(file, bits_per_sample);
+  read(cursor, number_of_channels);
+  read(cursor, sample_rate);
+  read(cursor, byte_rate);
+  read(cursor, block_align);
+  read(cursor, bits_per_sample);
   if (bits_per_sample != 16) {
     throw WAVE::parsing_error("The bit depth isn't 16 bit.");
   }
-  if (!file) {
-    throw WAVE::parsing_error("Parsing of the chunk '" + format_chunk_id +
-                              "' failed.");
+  if (number_of_channels == 0) {
+    throw WAVE::parsing_error("The WAVE file doesn't contain any channel.");
   }
 }
 
-void WAVE::parse_data_chunk(std::ifstream &file) {
+void WAVE::parse_data_chunk(Cursor &cursor) {
   data_chunk_id = "data";
-  search_chunk(file, data_chunk_id, data_chunk_size);
-  if (!file) {
-    throw WAVE::parsing_error("Parsing of the chunk '" + data_chunk_id +
-                              "' failed.");
-  }
+  search_chunk(cursor, data_chunk_id, data_chunk_size);
+
+  // A truncated data chunk gets decoded up to the last complete sample frame.
+  std::size_t frame_size = number_of_channels * (bits_per_sample / 8);
+  std::size_t available_bytes = std::min<std::size_t>(
+      data_chunk_size, cursor.end - cursor.position);
+  number_of_samples = available_bytes / frame_size;
+  pcm_samples = cursor.position;
+}
 
-  using DataSize = std::vector<std::vector<double>>::size_type;
-  using ChannelSize = std::vector<double>::size_type;
+const double *WAVE::get_samples(VectorSize channel,
+                                const VectorRange &time_range) {
+  if (!data.empty()) {
+    return data.at(channel)->data() + time_range.first;
+  }
+  decoded_samples.resize(number_of_channels);
+  Vector &samples = decoded_samples.at(channel);
+  samples.resize(time_range.second - time_range.first);
+  destinations.assign(number_of_channels, nullptr);
+  destinations[channel] = samples.data();
+  decode_samples(time_range, destinations.data());
+  return samples.data();
+}
 
-  ChannelSize number_of_samples_per_channel =
-      data_chunk_size / number_of_channels / (bits_per_sample / 8);
+void WAVE::read(const VectorRange &time_range, double *const *destinations) {
+  if (data.empty()) {
+    decode_samples(time_range, destinations);
+    // Reads on demand move forward, so the samples in front of the range
+    // aren't needed anymore.
+    std::size_t frame_size = number_of_channels * sizeof(int16_t);
+    mapped_file->release(pcm_samples - mapped_file->get_data() +
+                         time_range.first * frame_size);
+  } else {
+    AudioSource::read(time_range, destinations);
+  }
+}
 
-  for (DataSize channel = 0; channel != number_of_channels; ++channel) {
-    data.emplace_back(
-        std::make_shared<std::vector<double>>(std::vector<double>()));
-    data.back()->reserve(number_of_samples_per_channel);
+void WAVE::decode_samples(const VectorRange &time_range,
+                          double *const *destinations) {
+  if (pcm_samples == nullptr || time_range.second > number_of_samples) {
+    throw std::out_of_range("The samples aren't available.");
   }
-  int16_t current_sample;
-  for (ChannelSize sample = 0; sample != number_of_samples_per_channel;
-       ++sample) {
-    for (DataSize channel = 0; channel != number_of_channels; ++channel) {
-      read(file, current_sample);
-      data[channel]->push_back(current_sample / 32768.0);
+  std::size_t frame_size = number_of_channels * sizeof(int16_t);
+  block.resize(block_size * number_of_channels);
+  std::vector<double *> block_destinations(number_of_channels);
+  for (VectorSize first = time_range.first; first < time_range.second;
+       first += block_size) {
+    std::size_t number_of_frames =
+        std::min<std::size_t>(block_size, time_range.second - first);
+    for (uint16_t channel = 0; channel != number_of_channels; ++channel) {
+      block_destinations[channel] =
+          destinations[channel] == nullptr
+              ? nullptr
+              : destinations[channel] + (first - time_range.first);
     }
+    decode_block(pcm_samples + first * frame_size, number_of_frames,
+                 block_destinations.data());
+  }
+}
+
+void WAVE::decode_block(const unsigned char *samples,
+                        std::size_t number_of_frames,
+                        double *const *destinations) {
+  // The copy aligns the samples, which may start at an odd address.
+  std::size_t number_of_samples_in_block =
+      number_of_frames * number_of_channels;
+  std::memcpy(block.data(), samples,
+              number_of_samples_in_block * sizeof(int16_t));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  for (std::size_t index = 0; index != number_of_samples_in_block; ++index) {
+    block[index] = static_cast<int16_t>(
+        __builtin_bswap16(static_cast<uint16_t>(block[index])));
   }
-  if (!file) {
-    throw WAVE::parsing_error("Parsing of the chunk '" + data_chunk_id +
-                              "' failed.");
+#endif
+
+  for (uint16_t channel = 0; channel != number_of_channels; ++channel) {
+    double *destination = destinations[channel];
+    if (destination == nullptr) {
+      continue;
+    }
+    switch (number_of_channels) {
+    case 1:
+      deinterleave<1>(block.data(), number_of_frames, channel, destination);
+      break;
+    case 2:
+      deinterleave<2>(block.data(), number_of_frames, channel, destination);
+      break;
+    default:
+      deinterleave(block.data(), number_of_frames, number_of_channels, channel,
+                   destination);
+      break;
+    }
   }
 }
 
-void WAVE::decode() {
-  std::ifstream file(audio_file_path);
-  if (!file) {
-    throw std::runtime_error("Couldn't open file: " + audio_file_path);
+void WAVE::decode(bool decode_all_samples) {
+  auto file = std::make_shared<MappedFile>(audio_file_path);
+  Cursor cursor{file->get_data(), file->get_data() + file->get_size()};
+  parse_riff_chunk_head(cursor);
+  parse_format_chunk(cursor);
+  parse_data_chunk(cursor);
+  if (!decode_all_samples) {
+    // The samples get decoded on demand, so the file has to stay mapped.
+    mapped_file = file;
+    return;
+  }
+
+  std::vector<double *> channel_destinations;
+  for (uint16_t channel = 0; channel != number_of_channels; ++channel) {
+    data.emplace_back(std::make_shared<Vector>(number_of_samples));
+    channel_destinations.push_back(data.back()->data());
   }
-  parse_riff_chunk_head(file);
-  parse_format_chunk(file);
-  parse_data_chunk(file);
+  decode_samples({0, number_of_samples}, channel_destinations.data());
+  pcm_samples = nullptr;
 }
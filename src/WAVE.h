@@ -24,17 +24,31 @@
 #ifndef OVERTONE_WAVE_H
 #define OVERTONE_WAVE_H
 
-#include <fstream>
+#include "AudioSource.h"
+#include "MappedFile.h"
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 /**
  * Open and decodes a WAVE file that contains a 16 bit linear-PCM signal
- * (signed and little endian).
+ * (signed and little endian), or wraps a PCM signal that has already been
+ * decoded.
+ *
+ * The file gets memory-mapped, so the headers are parsed in place, unknown
+ * chunks are skipped without reading them, and the samples get de-interleaved
+ * and converted block by block. The samples are either decoded at once or, to
+ * keep the memory independent of the length of the file, on demand via
+ * read() (e.g., by an AudioStream).
+ *
+ * The application decodes its input via an AudioPipe and only uses the
+ * wrapper of decoded signals. The decoding of WAVE files is kept as a library
+ * API for WAVE files on disk, which doesn't need an FFmpeg process.
  */
-class WAVE {
+class WAVE : public AudioSource {
 public:
   /**
    * A parsing exception occurs if the parsing of the WAVE file fails, e.g.,
@@ -53,16 +67,33 @@ public:
   /**
    * Decodes the WAVE file `audio_file_path`.
    * @param audio_file_path path of the WAVE file
+   * @param decode_all_samples if false, only the headers get parsed, and the
+   *                           samples get decoded on demand
    */
-  explicit WAVE(std::string audio_file_path) try
+  explicit WAVE(std::string audio_file_path, bool decode_all_samples = true) try
       : audio_file_path(std::move(audio_file_path)) {
-    decode();
+    decode(decode_all_samples);
   } catch (parsing_error &parsing_error) {
     std::cerr << parsing_error.what() << std::endl;
   }
 
   /**
-   * Returns the audio signal.
+   * Wraps a PCM signal that has already been decoded.
+   * @param data PCM signal of each channel
+   * @param sample_rate sample rate
+   */
+  WAVE(std::vector<std::shared_ptr<std::vector<double>>> data,
+       unsigned sample_rate)
+      : number_of_channels(data.size()), sample_rate(sample_rate),
+        data(std::move(data)) {
+    if (!this->data.empty()) {
+      number_of_samples = this->data[0]->size();
+    }
+  }
+
+  /**
+   * Returns the audio signal, which is empty if the samples get decoded on
+   * demand.
    * @return audio signal
    */
   std::vector<std::shared_ptr<std::vector<double>>> get_signal() const {
@@ -73,20 +104,61 @@ public:
    * Returns the sample rate.
    * @return sample rate
    */
-  const unsigned int &get_sample_rate() const { return sample_rate; }
+  unsigned get_sample_rate() const override { return sample_rate; }
+
+  VectorSize get_number_of_channels() const override {
+    return number_of_channels;
+  }
+
+  VectorSize get_number_of_samples() const override {
+    return number_of_samples;
+  }
+
+  const double *get_samples(VectorSize channel,
+                            const VectorRange &time_range) override;
+
+  void read(const VectorRange &time_range,
+            double *const *destinations) override;
 
 private:
-  void decode();
-  static void read(std::ifstream &file, uint16_t &destination);
-  static void read(std::ifstream &file, int16_t &destination);
-  static void read(std::ifstream &file, uint32_t &destination);
-  static void read(std::ifstream &file, std::string &destination);
-  static void search_chunk(std::ifstream &file,
-                           const std::string &wanted_chunk_id,
+  // read position within the memory-mapped file
+  struct Cursor {
+    const unsigned char *position;
+    const unsigned char *end;
+  };
+
+  // number of sample frames that get de-interleaved per block
+  static constexpr std::size_t block_size = 4096;
+
+  void decode(bool decode_all_samples);
+  static void read(Cursor &cursor, uint16_t &destination);
+  static void read(Cursor &cursor, uint32_t &destination);
+  static void read(Cursor &cursor, std::string &destination);
+  static void search_chunk(Cursor &cursor, const std::string &wanted_chunk_id,
                            uint32_t &found_chunk_size);
-  void parse_riff_chunk_head(std::ifstream &file);
-  void parse_format_chunk(std::ifstream &file);
-  void parse_data_chunk(std::ifstream &file);
+  void parse_riff_chunk_head(Cursor &cursor);
+  void parse_format_chunk(Cursor &cursor);
+  void parse_data_chunk(Cursor &cursor);
+
+  /**
+   * De-interleaves and converts the samples within a time index range.
+   * @param time_range time index range
+   * @param destinations destination of each channel (nullptr if the channel
+   *                     should be skipped)
+   */
+  void decode_samples(const VectorRange &time_range,
+                      double *const *destinations);
+
+  /**
+   * De-interleaves and converts a block of 16 bit samples.
+   * @param samples interleaved little-endian samples
+   * @param number_of_frames number of sample frames within the block
+   * @param destinations destination of each channel (nullptr if the channel
+   *                     should be skipped)
+   */
+  void decode_block(const unsigned char *samples,
+                    std::size_t number_of_frames,
+                    double *const *destinations);
 
   std::string audio_file_path;
 
@@ -111,6 +183,20 @@ private:
   // Each uint16_t vector contains the data of a channel respectively
   // (Mono = 1 Channel, Stereo = 2 Channels, ...)
   std::vector<std::shared_ptr<std::vector<double>>> data;
+
+  // the mapped file if the samples get decoded on demand
+  std::shared_ptr<MappedFile> mapped_file;
+
+  // the first sample within the data chunk of the mapped file
+  const unsigned char *pcm_samples{};
+
+  // number of samples per channel
+  VectorSize number_of_samples{};
+
+  // working buffers of decode_block() and of get_samples()
+  std::vector<int16_t> block;
+  std::vector<Vector> decoded_samples;
+  std::vector<double *> destinations;
 };
 
 #endif // OVERTONE_WAVE_H
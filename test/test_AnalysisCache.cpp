@@ -0,0 +1,144 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_AnalysisCache.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AnalysisCache.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+class CountingKeyboard : public KeyboardSource {
+public:
+  explicit CountingKeyboard(unsigned number_of_frames)
+      : number_of_frames(number_of_frames),
+        keyboard(std::make_shared<Vector>(88)) {
+    evaluate();
+  }
+
+  std::shared_ptr<Vector> get_keyboard() const override { return keyboard; }
+
+  bool go_to_next_frame() override {
+    if (frame + 1 == number_of_frames) {
+      return false;
+    }
+    ++frame;
+    evaluate();
+    return true;
+  }
+
+private:
+  unsigned number_of_frames;
+  unsigned frame{};
+  std::shared_ptr<Vector> keyboard;
+
+  void evaluate() {
+    for (unsigned key = 0; key != keyboard->size(); ++key) {
+      (*keyboard)[key] = frame + key / 100.;
+    }
+  }
+};
+
+std::string create_directory() {
+  char directory_template[] = "/tmp/test_AnalysisCache.XXXXXX";
+  return mkdtemp(directory_template);
+}
+} // namespace
+
+TEST(test_AnalysisCache, record_and_load) {
+  std::string directory = create_directory();
+  std::string input_path = directory + "/input.wav";
+  std::ofstream(input_path) << "input";
+
+  AnalysisCache cache(directory, input_path, "frame rate 25");
+  EXPECT_EQ(cache.load(), nullptr);
+  auto recorder = cache.record(std::make_shared<CountingKeyboard>(5));
+  // The entry is only visible after the last video frame.
+  EXPECT_EQ(cache.load(), nullptr);
+  unsigned number_of_frames = 1;
+  while (recorder->go_to_next_frame()) {
+    ++number_of_frames;
+  }
+  EXPECT_EQ(number_of_frames, 5);
+
+  std::uint64_t number_of_cached_frames = 0;
+  auto cached = cache.load(&number_of_cached_frames);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_EQ(number_of_cached_frames, 5);
+  CountingKeyboard expected(5);
+  do {
+    EXPECT_EQ(*cached->get_keyboard(), *expected.get_keyboard());
+  } while (cached->go_to_next_frame() && expected.go_to_next_frame());
+
+  // other parameters or another input file
+  EXPECT_EQ(AnalysisCache(directory, input_path, "frame rate 30").load(),
+            nullptr);
+  std::ofstream(input_path) << "other input";
+  EXPECT_EQ(AnalysisCache(directory, input_path, "frame rate 25").load(),
+            nullptr);
+
+  // truncated entry
+  std::string entry_path = cache.get_path();
+  std::ifstream entry(entry_path, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(entry)),
+                      std::istreambuf_iterator<char>());
+  std::ofstream(entry_path, std::ios::binary)
+      << content.substr(0, content.size() - 8);
+  std::ofstream(input_path) << "input";
+  EXPECT_EQ(cache.load(), nullptr);
+
+  std::remove(entry_path.c_str());
+  std::remove(input_path.c_str());
+  std::remove(directory.c_str());
+}
+
+TEST(test_AnalysisCache, version) {
+  std::string directory = create_directory();
+  std::string input_path = directory + "/input.wav";
+  std::ofstream(input_path) << "input";
+
+  // The key contains the version, so an entry of another version isn't
+  // found.
+  std::string input = "input";
+  std::string parameters = "frame rate 25, cache version " +
+                           std::to_string(AnalysisCache::version);
+  std::uint64_t expected_key = AnalysisCache::hash(
+      reinterpret_cast<const unsigned char *>(parameters.data()),
+      parameters.size(),
+      AnalysisCache::hash(
+          reinterpret_cast<const unsigned char *>(input.data()),
+          input.size()));
+  EXPECT_EQ(AnalysisCache(directory, input_path, "frame rate 25").get_key(),
+            expected_key);
+
+  std::remove(input_path.c_str());
+  std::remove(directory.c_str());
+}
+
+TEST(test_AnalysisCache, hash) {
+  // FNV-1a test vectors
+  EXPECT_EQ(AnalysisCache::hash(nullptr, 0), 0xcbf29ce484222325ull);
+  const unsigned char a[] = {'a'};
+  EXPECT_EQ(AnalysisCache::hash(a, 1), 0xaf63dc4c8601ec8cull);
+}
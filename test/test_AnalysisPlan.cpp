@@ -0,0 +1,111 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_AnalysisPlan.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AnalysisPlan.h"
+#include "KeyboardFrequencies.h"
+#include <gtest/gtest.h>
+#include <iterator>
+
+TEST(test_AnalysisPlan, project) {
+  double tolerance = 1e-12;
+  AnalysisPlan::KeyRange key_range{40, 50};
+  AnalysisPlan plan(key_range, 8000, 44100);
+
+  const auto &keys = plan.get_keys();
+  auto frequency_range = plan.get_frequency_range();
+  ASSERT_EQ(keys.size(), frequency_range.second - frequency_range.first);
+  ASSERT_EQ(plan.get_goertzel_coefficients().size(), keys.size());
+  EXPECT_NEAR(keys.front(),
+              KeyboardFrequencies::frequency_to_key(frequency_range.first *
+                                                    44100. / 8000),
+              tolerance);
+
+  // A constant spectrum is projected onto the same constant, since each key
+  // is the weighted average of its bins.
+  std::vector<double> spectrum(keys.size(), 0.25);
+  std::vector<double> keyboard(88, 0.);
+  plan.project(spectrum.data(), keyboard.data());
+  for (unsigned key = 0; key != 88; ++key) {
+    double expected = key_range.first <= key && key < key_range.second ? 0.25
+                                                                        : 0.;
+    EXPECT_NEAR(keyboard[key], expected, tolerance) << "key " << key;
+  }
+}
+
+TEST(test_AnalysisPlan, key_centered) {
+  double tolerance = 1e-12;
+  AnalysisPlan::KeyRange key_range{40, 50};
+  AnalysisPlan::VectorSize number_of_samples = 8000;
+  AnalysisPlan plan(key_range, number_of_samples, 44100,
+                    AnalysisPlan::Frequencies::key_centered);
+  const auto &keys = plan.get_keys();
+  ASSERT_EQ(plan.get_goertzel_coefficients().size(), keys.size());
+
+  // The nodes are evenly spaced within each key, and their spacing doesn't
+  // exceed the bin width.
+  double bin_width = 44100. / number_of_samples;
+  std::size_t index = 0;
+  for (unsigned key = key_range.first; key != key_range.second; ++key) {
+    unsigned number_of_nodes =
+        AnalysisPlan::evaluate_number_of_nodes(key, number_of_samples, 44100);
+    EXPECT_GE(number_of_nodes, AnalysisPlan::minimum_nodes_per_key);
+    for (unsigned node = 0; node != number_of_nodes; ++node, ++index) {
+      ASSERT_LT(index, keys.size());
+      EXPECT_NEAR(keys[index],
+                  key - 0.5 + (node + 0.5) / number_of_nodes, tolerance);
+      if (node != 0) {
+        EXPECT_LE(KeyboardFrequencies::key_to_frequency(keys[index]) -
+                      KeyboardFrequencies::key_to_frequency(keys[index - 1]),
+                  bin_width)
+            << "key " << key << ", node " << node;
+      }
+    }
+  }
+  EXPECT_EQ(index, keys.size());
+
+  // The nodes of the low keys are denser than the bins, the ones of the high
+  // keys get denser with the number of samples.
+  EXPECT_EQ(AnalysisPlan::evaluate_number_of_nodes(40, 8000, 44100), 3);
+  EXPECT_EQ(AnalysisPlan::evaluate_number_of_nodes(49, 8000, 44100), 6);
+  EXPECT_EQ(AnalysisPlan::evaluate_number_of_nodes(49, 80000, 44100), 51);
+
+  std::vector<double> spectrum(keys.size(), 0.25);
+  std::vector<double> keyboard(88, 0.);
+  plan.project(spectrum.data(), keyboard.data());
+  for (unsigned key = 0; key != 88; ++key) {
+    double expected = key_range.first <= key && key < key_range.second ? 0.25
+                                                                        : 0.;
+    EXPECT_NEAR(keyboard[key], expected, tolerance) << "key " << key;
+  }
+
+  // The frequencies end below the Nyquist frequency, which is at the key
+  // 74.2 for the sample rate 4000 Hz.
+  AnalysisPlan clipped_plan({60, 88}, 2000, 4000,
+                            AnalysisPlan::Frequencies::key_centered);
+  double nyquist_key = KeyboardFrequencies::frequency_to_key(2000.);
+  double last_key = clipped_plan.get_keys().back();
+  EXPECT_LT(last_key, nyquist_key);
+  EXPECT_GT(last_key,
+            nyquist_key -
+                1. / AnalysisPlan::evaluate_number_of_nodes(74, 2000, 4000));
+}
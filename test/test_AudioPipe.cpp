@@ -0,0 +1,223 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_AudioPipe.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AudioPipe.h"
+#include "MultirateSignal.h"
+#include "WAVE.h"
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace {
+using Signal = std::vector<std::shared_ptr<std::vector<double>>>;
+
+void write_uint32(std::ofstream &file, std::uint32_t value) {
+  unsigned char bytes[] = {static_cast<unsigned char>(value),
+                           static_cast<unsigned char>(value >> 8),
+                           static_cast<unsigned char>(value >> 16),
+                           static_cast<unsigned char>(value >> 24)};
+  file.write(reinterpret_cast<const char *>(bytes), 4);
+}
+
+void write_uint16(std::ofstream &file, std::uint16_t value) {
+  unsigned char bytes[] = {static_cast<unsigned char>(value),
+                           static_cast<unsigned char>(value >> 8)};
+  file.write(reinterpret_cast<const char *>(bytes), 2);
+}
+
+/**
+ * Writes a WAVE stream like FFmpeg does into a pipe: 32 bit float samples,
+ * a LIST chunk, and unknown sizes of the RIFF and data chunks (unless
+ * data_size is given).
+ */
+std::string write_stream(const std::string &name, const Signal &signal,
+                         unsigned sample_rate, std::uint16_t audio_format = 3,
+                         std::uint32_t data_size = 0xFFFFFFFF) {
+  std::string path = "/tmp/test_AudioPipe." + std::to_string(getpid()) +
+                     "." + name + ".wav";
+  std::ofstream file(path, std::ios::binary);
+  std::uint16_t number_of_channels = signal.size();
+  file.write("RIFF", 4);
+  write_uint32(file, 0xFFFFFFFF);
+  file.write("WAVEfmt ", 8);
+  write_uint32(file, 18);
+  write_uint16(file, audio_format);
+  write_uint16(file, number_of_channels);
+  write_uint32(file, sample_rate);
+  write_uint32(file, 4 * number_of_channels * sample_rate);
+  write_uint16(file, 4 * number_of_channels);
+  write_uint16(file, 32);
+  write_uint16(file, 0);
+  file.write("LIST", 4);
+  write_uint32(file, 3);
+  file.write("abc\0", 4);
+  file.write("data", 4);
+  write_uint32(file, data_size);
+  for (std::size_t index = 0; index != signal[0]->size(); ++index) {
+    for (const auto &channel : signal) {
+      float sample = (*channel)[index];
+      file.write(reinterpret_cast<const char *>(&sample), 4);
+    }
+  }
+  return path;
+}
+
+/**
+ * A stereo signal whose samples are exact as floats.
+ */
+Signal test_signal(std::size_t size) {
+  auto left = std::make_shared<std::vector<double>>();
+  auto right = std::make_shared<std::vector<double>>();
+  for (std::size_t index = 0; index != size; ++index) {
+    left->push_back(static_cast<float>(std::sin(0.01 * index)));
+    right->push_back(static_cast<float>(std::cos(0.37 * index)));
+  }
+  return {left, right};
+}
+} // namespace
+
+TEST(test_AudioPipe, read) {
+  Signal signal = test_signal(10000);
+  std::string path = write_stream("read", signal, 8000);
+  AudioPipe pipe("cat '" + path + "'");
+  EXPECT_EQ(pipe.get_sample_rate(), 8000);
+  EXPECT_EQ(pipe.get_number_of_channels(), 2);
+  EXPECT_EQ(pipe.count_samples(100), 100);
+
+  const double *samples = pipe.get_samples(1, {50, 150});
+  for (std::size_t index = 50; index != 150; ++index) {
+    ASSERT_EQ(samples[index - 50], (*signal[1])[index]);
+  }
+  std::vector<double> left(4000);
+  std::vector<double> right(4000);
+  double *destinations[] = {left.data(), right.data()};
+  pipe.read({6000, 10000}, destinations);
+  for (std::size_t index = 6000; index != 10000; ++index) {
+    ASSERT_EQ(left[index - 6000], (*signal[0])[index]);
+    ASSERT_EQ(right[index - 6000], (*signal[1])[index]);
+  }
+
+  // released samples, and samples beyond the end of the stream
+  EXPECT_THROW(pipe.get_samples(0, {100, 200}), std::out_of_range);
+  EXPECT_THROW(pipe.get_samples(0, {9000, 10001}), std::out_of_range);
+  EXPECT_EQ(pipe.count_samples(20000), 10000);
+  EXPECT_EQ(pipe.get_number_of_samples(), 10000);
+  std::remove(path.c_str());
+}
+
+TEST(test_AudioPipe, read_all) {
+  Signal signal = test_signal(100000);
+  std::string path = write_stream("read_all", signal, 8000);
+  AudioPipe pipe("cat '" + path + "'");
+  Signal result = pipe.read_all();
+  ASSERT_EQ(result.size(), 2);
+  for (std::size_t channel = 0; channel != 2; ++channel) {
+    EXPECT_EQ(*result[channel], *signal[channel]);
+  }
+  std::remove(path.c_str());
+}
+
+// A multirate stream of the pipe only reads the pipe as far as the analysis
+// has progressed, and it yields the same samples as the decoded signal.
+TEST(test_AudioPipe, streaming) {
+  unsigned sample_rate = 8000;
+  Signal signal = test_signal(3 * sample_rate + 123);
+  std::string path = write_stream("streaming", signal, sample_rate);
+  auto pipe = std::make_shared<AudioPipe>("cat '" + path + "'");
+  MultirateSignal decoded_signal(std::make_shared<WAVE>(signal, sample_rate),
+                                 25);
+  std::size_t window = 1000;
+  std::size_t hop = 320;
+  MultirateSignal streamed_signal(pipe, 25, window + hop);
+  ASSERT_EQ(streamed_signal.find_level({0, 30}), 4);
+  ASSERT_EQ(decoded_signal.find_level({0, 30}), 4);
+
+  for (std::size_t center = 0; center < signal[0]->size(); center += hop) {
+    for (unsigned level = 0; level != 5; ++level) {
+      auto decoded = decoded_signal.get_source(level);
+      auto streamed = streamed_signal.get_source(level);
+      std::size_t half_window = window / 2 >> level;
+      std::size_t level_center = center >> level;
+      MultirateSignal::VectorRange time_range(
+          level_center > half_window ? level_center - half_window : 0,
+          streamed->count_samples(level_center + half_window));
+      ASSERT_EQ(time_range.second,
+                std::min(level_center + half_window,
+                         decoded->get_number_of_samples()));
+      for (std::size_t channel = 0; channel != 2; ++channel) {
+        const double *expected = decoded->get_samples(channel, time_range);
+        const double *result = streamed->get_samples(channel, time_range);
+        for (std::size_t index = 0;
+             index != time_range.second - time_range.first; ++index) {
+          ASSERT_EQ(result[index], expected[index])
+              << "level " << level << ", time index "
+              << time_range.first + index;
+        }
+      }
+    }
+  }
+  std::remove(path.c_str());
+}
+
+TEST(test_AudioPipe, errors) {
+  Signal signal = test_signal(10);
+  std::string path = write_stream("errors", signal, 8000, 1);
+  EXPECT_THROW(AudioPipe("cat '" + path + "'"), std::runtime_error);
+  EXPECT_THROW(AudioPipe("true"), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(test_AudioPipe, truncated) {
+  Signal signal = test_signal(1000);
+  std::string path = write_stream("truncated", signal, 8000, 3, 4 * 2 * 1000);
+  std::string unknown_size_path = write_stream("unknown_size", signal, 8000);
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  std::size_t size = file.tellg();
+  auto head = [size](const std::string &stream_path,
+                     std::size_t removed_bytes) {
+    return "head -c " + std::to_string(size - removed_bytes) + " '" +
+           stream_path + "'";
+  };
+
+  // complete streams
+  EXPECT_EQ(AudioPipe(head(path, 0)).get_number_of_samples(), 1000);
+  EXPECT_EQ(AudioPipe(head(unknown_size_path, 0)).get_number_of_samples(),
+            1000);
+
+  // The stream ends before the end of its data chunk.
+  EXPECT_THROW(AudioPipe(head(path, 800)).get_number_of_samples(),
+               std::runtime_error);
+
+  // The stream of unknown size ends within a sample frame.
+  EXPECT_THROW(AudioPipe(head(unknown_size_path, 3)).read_all(),
+               std::runtime_error);
+
+  // The process fails after it has written the stream.
+  EXPECT_THROW(AudioPipe(head(unknown_size_path, 0) + "; exit 3").read_all(),
+               std::runtime_error);
+
+  std::remove(path.c_str());
+  std::remove(unknown_size_path.c_str());
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_AudioStream.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AudioStream.h"
+#include "WAVE.h"
+#include <gtest/gtest.h>
+
+TEST(test_AudioStream, get_samples) {
+  auto left = std::make_shared<std::vector<double>>();
+  auto right = std::make_shared<std::vector<double>>();
+  for (unsigned index = 0; index != 1000; ++index) {
+    left->push_back(index);
+    right->push_back(-1. * index);
+  }
+  auto wave = std::make_shared<WAVE>(
+      std::vector<std::shared_ptr<std::vector<double>>>{left, right}, 8000);
+  AudioStream stream(wave, 100);
+  EXPECT_EQ(stream.get_sample_rate(), 8000);
+  EXPECT_EQ(stream.get_number_of_channels(), 2);
+  EXPECT_EQ(stream.get_number_of_samples(), 1000);
+
+  // overlapping windows that wrap around the ring buffer, and a jump
+  std::vector<AudioStream::VectorRange> time_ranges{
+      {0, 60}, {30, 90}, {60, 150}, {150, 150}, {140, 240}, {500, 580},
+      {520, 600}, {940, 1000}};
+  for (const auto &time_range : time_ranges) {
+    for (unsigned channel = 0; channel != 2; ++channel) {
+      const double *samples = stream.get_samples(channel, time_range);
+      for (auto index = time_range.first; index != time_range.second;
+           ++index) {
+        ASSERT_EQ(samples[index - time_range.first],
+                  channel == 0 ? 1. * index : -1. * index);
+      }
+    }
+  }
+
+  // evicted samples, ranges beyond the capacity, and beyond the signal
+  EXPECT_THROW(stream.get_samples(0, {800, 900}), std::out_of_range);
+  EXPECT_THROW(stream.get_samples(0, {900, 1001}), std::out_of_range);
+  EXPECT_THROW(stream.get_samples(0, {950, 1010}), std::out_of_range);
+}
+
+TEST(test_AudioStream, read) {
+  auto channel = std::make_shared<std::vector<double>>();
+  for (unsigned index = 0; index != 300; ++index) {
+    channel->push_back(index);
+  }
+  auto wave = std::make_shared<WAVE>(
+      std::vector<std::shared_ptr<std::vector<double>>>{channel}, 8000);
+  AudioStream stream(wave, 64);
+  std::vector<double> destination(50);
+  double *destinations[] = {destination.data()};
+  stream.read({100, 150}, destinations);
+  for (unsigned index = 0; index != 50; ++index) {
+    EXPECT_EQ(destination[index], 100. + index);
+  }
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_ColorMap.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ColorMap.h"
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+TEST(test_ColorMap, lookup_table) {
+  // The theme "gray" interpolates linearly between 0x20 and 0xff, and the
+  // interpolated values are truncated.
+  ColorMap color_map("gray", 1., 0.);
+  for (unsigned index = 0; index <= 1000; ++index) {
+    double value = index / 1000.;
+    double expected = std::floor(32. + (255. - 32.) * value);
+    auto color = color_map(value);
+    for (unsigned channel = 0; channel != 3; ++channel) {
+      ASSERT_NEAR(color[channel], expected, 1.);
+    }
+  }
+  EXPECT_EQ(color_map(-1.)[0], 32);
+  EXPECT_EQ(color_map(std::numeric_limits<double>::quiet_NaN())[0], 32);
+  EXPECT_EQ(color_map(2.)[0], 255);
+  EXPECT_EQ(color_map.get_edge_color(), (ColorMap::Color{0, 0, 0}));
+}
+
+TEST(test_ColorMap, gain_and_gate) {
+  ColorMap color_map("gray", 2., 0.5);
+  EXPECT_EQ(color_map(0.2)[0], 32);
+  EXPECT_EQ(color_map(0.3), ColorMap("gray", 1., 0.)(0.6));
+
+  std::vector<double> keyboard{0., 0.3, 1.};
+  std::vector<ColorMap::Color> colors;
+  color_map.evaluate_colors(keyboard, colors);
+  ASSERT_EQ(colors.size(), keyboard.size());
+  for (unsigned key = 0; key != keyboard.size(); ++key) {
+    EXPECT_EQ(colors[key], color_map(keyboard[key]));
+  }
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_FFT.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "FFT.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <random>
+
+namespace {
+FFT::ComplexVector direct_transform(const FFT::Vector &signal) {
+  auto size = signal.size();
+  FFT::ComplexVector transform;
+  for (FFT::VectorSize frequency = 0; frequency <= size / 2; ++frequency) {
+    FFT::Complex accumulator;
+    for (FFT::VectorSize time = 0; time != size; ++time) {
+      double phase = -2. * M_PI * ((frequency * time) % size) / size;
+      accumulator += signal[time] * std::polar(1., phase);
+    }
+    transform.push_back(accumulator);
+  }
+  return transform;
+}
+} // namespace
+
+TEST(test_FFT, transform) {
+  double tolerance = 1e-9;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-1., 1.);
+  for (FFT::VectorSize size : {1, 2, 3, 8, 999, 1000, 1024, 1900}) {
+    FFT::Vector signal;
+    for (FFT::VectorSize index = 0; index != size; ++index) {
+      signal.push_back(distribution(generator));
+    }
+    FFT fft(size);
+    FFT::ComplexVector result;
+    fft.transform(signal.data(), result);
+    auto expected = direct_transform(signal);
+    ASSERT_EQ(result.size(), expected.size());
+    for (FFT::VectorSize index = 0; index != expected.size(); ++index) {
+      EXPECT_NEAR(2. * std::abs(result[index]) / size,
+                  2. * std::abs(expected[index]) / size, tolerance)
+          << "size = " << size << ", index = " << index;
+    }
+  }
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_FrameBuffer.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "FrameBuffer.h"
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+TEST(test_FrameBuffer, layout) {
+  FrameBuffer contiguous(1920, 1080);
+  EXPECT_EQ(contiguous.get_stride(), 5760);
+  EXPECT_TRUE(contiguous.is_contiguous());
+
+  FrameBuffer padded(5, 2);
+  EXPECT_EQ(padded.get_stride(), FrameBuffer::alignment);
+  EXPECT_FALSE(padded.is_contiguous());
+  for (unsigned row = 0; row != 2; ++row) {
+    auto address = reinterpret_cast<std::uintptr_t>(padded.get_row(row));
+    EXPECT_EQ(address % FrameBuffer::alignment, 0);
+  }
+
+  EXPECT_THROW(FrameBuffer(0, 1), std::invalid_argument);
+}
+
+TEST(test_FrameBuffer, fill_rectangle) {
+  FrameBuffer frame(40, 6);
+  FrameBuffer::Color color{1, 2, 3};
+  frame.fill_rectangle(1, 3, 4, 29, color);
+  for (unsigned row = 0; row != 6; ++row) {
+    for (unsigned column = 0; column != 40; ++column) {
+      bool inside = row >= 1 && row < 5 && column >= 3 && column < 32;
+      for (unsigned channel = 0; channel != 3; ++channel) {
+        ASSERT_EQ(frame.get_row(row)[3 * column + channel],
+                  inside ? color[channel] : 0);
+      }
+    }
+  }
+}
+
+TEST(test_FrameBuffer, copy_rows) {
+  FrameBuffer frame(3, 5);
+  for (unsigned row = 0; row != 5; ++row) {
+    frame.fill_span(row, 0, 3, {static_cast<unsigned char>(row), 0, 0});
+  }
+  // overlapping rows
+  frame.copy_rows(0, 2, 3);
+  const unsigned char expected[] = {2, 3, 4, 3, 4};
+  for (unsigned row = 0; row != 5; ++row) {
+    EXPECT_EQ(frame.get_row(row)[6], expected[row]);
+  }
+}
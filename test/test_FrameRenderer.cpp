@@ -0,0 +1,92 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_FrameRenderer.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "FrameRenderer.h"
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace {
+bool equal_frames(const FrameBuffer &a, const FrameBuffer &b) {
+  for (unsigned row = 0; row != a.get_height(); ++row) {
+    if (std::memcmp(a.get_row(row), b.get_row(row), 3 * a.get_width())) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+// Compares the rendered video frames with the scrolling of VideoFrame, which
+// repeats the key row of the previous frame and moves the history up.
+TEST(test_FrameRenderer, history) {
+  using Geometry = KeyboardGeometry;
+  const unsigned key_row = Geometry::key_row;
+  for (unsigned history_speed : {13u, 400u, 786u}) {
+    FrameRenderer renderer(1., 0., "fire", history_speed);
+    std::vector<std::vector<double>> keyboards;
+    FrameBuffer expected(Geometry::frame_width, Geometry::frame_height);
+    FrameBuffer frame(Geometry::frame_width, Geometry::frame_height);
+    Geometry geometry;
+    const unsigned number_of_frames = renderer.get_window_size() + 3;
+    for (unsigned index = 0; index != number_of_frames; ++index) {
+      std::vector<double> keyboard(Geometry::number_of_keys);
+      for (unsigned key = 0; key != keyboard.size(); ++key) {
+        keyboard[key] = ((index * 31 + key * 7) % 50) / 49.;
+      }
+      keyboards.push_back(keyboard);
+
+      std::vector<const std::vector<double> *> window;
+      unsigned first = index + 1 >= renderer.get_window_size()
+                           ? index + 1 - renderer.get_window_size()
+                           : 0;
+      for (unsigned frame_index = first; frame_index <= index; ++frame_index) {
+        window.push_back(&keyboards[frame_index]);
+      }
+
+      if (index == 0) {
+        renderer.render(window, expected);
+      } else {
+        for (unsigned row = key_row + 1 - history_speed; row != key_row;
+             ++row) {
+          expected.copy_rows(row, key_row, 1);
+        }
+        expected.copy_rows(Geometry::history_row,
+                           Geometry::history_row + history_speed,
+                           Geometry::history_height - history_speed);
+        FrameRenderer::Color colors[Geometry::number_of_keys];
+        ColorMap color_map("fire", 1., 0.);
+        for (unsigned key = 0; key != Geometry::number_of_keys; ++key) {
+          colors[key] = color_map(keyboard[key]);
+        }
+        for (const auto &run : geometry.get_key_runs()) {
+          expected.fill_span(run.row, run.column, run.length,
+                             colors[run.role]);
+        }
+      }
+      renderer.render(window, frame);
+      ASSERT_TRUE(equal_frames(frame, expected))
+          << "history speed " << history_speed << ", frame " << index;
+    }
+  }
+}
@@ -0,0 +1,337 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_Keyboard.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AudioStream.h"
+#include "Keyboard.h"
+#include "KeyboardFrequencies.h"
+#include "ParallelKeyboard.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <new>
+#include <numeric>
+#include <random>
+
+namespace {
+// number of calls of the replaced operator new
+std::atomic<std::size_t> number_of_allocations{};
+} // namespace
+
+void *operator new(std::size_t size) {
+  ++number_of_allocations;
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+/**
+ * One second of a stereo signal with a few tones and some noise.
+ */
+WAVE test_wave() {
+  unsigned sample_rate = 4000;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-0.05, 0.05);
+  auto left = std::make_shared<std::vector<double>>();
+  auto right = std::make_shared<std::vector<double>>();
+  for (unsigned index = 0; index != sample_rate; ++index) {
+    double time = 1. * index / sample_rate;
+    left->push_back(0.3 * std::sin(2. * M_PI * 440. * time) +
+                    0.2 * std::sin(2. * M_PI * 55. * time) +
+                    distribution(generator));
+    right->push_back(0.3 * std::sin(2. * M_PI * 261.6 * time) +
+                     0.1 * std::sin(2. * M_PI * 1500. * time));
+  }
+  return WAVE({left, right}, sample_rate);
+}
+
+Keyboard test_keyboard(const WAVE &wave, Spectrum::Algorithm algorithm) {
+  std::vector<unsigned> channels;
+  unsigned frame_rate = 25;
+  return Keyboard(
+      {Spectrum(wave, channels, frame_rate, {0, 30}, 2000, algorithm),
+       Spectrum(wave, channels, frame_rate, {30, 60}, 500, algorithm),
+       Spectrum(wave, channels, frame_rate, {60, 88}, 200, algorithm)});
+}
+
+/**
+ * Keyboard of test_keyboard() that reads the wave through an AudioStream.
+ */
+Keyboard test_streaming_keyboard(const WAVE &wave,
+                                 Spectrum::Algorithm algorithm) {
+  // largest audio frame plus one video frame or plus a batch of video frames
+  unsigned frame_rate = 25;
+  Spectrum::VectorSize samples_per_video_frame =
+      wave.get_sample_rate() / frame_rate;
+  Spectrum::VectorSize video_frames =
+      algorithm == Spectrum::Algorithm::batched ? Spectrum::batch_size : 1;
+  Spectrum::VectorSize capacity = 2000 + video_frames * samples_per_video_frame;
+  auto stream =
+      std::make_shared<AudioStream>(std::make_shared<WAVE>(wave), capacity);
+  std::vector<unsigned> channels;
+  return Keyboard(
+      {Spectrum(stream, channels, frame_rate, {0, 30}, 2000, algorithm),
+       Spectrum(stream, channels, frame_rate, {30, 60}, 500, algorithm),
+       Spectrum(stream, channels, frame_rate, {60, 88}, 200, algorithm)});
+}
+
+std::vector<Keyboard::Vector> evaluate_all_frames(KeyboardSource &keyboard) {
+  std::vector<Keyboard::Vector> frames;
+  do {
+    frames.push_back(*keyboard.get_keyboard());
+  } while (keyboard.go_to_next_frame());
+  return frames;
+}
+} // namespace
+
+TEST(test_Keyboard, go_to_frame) {
+  WAVE wave = test_wave();
+  Keyboard keyboard = test_keyboard(wave, Spectrum::Algorithm::fft);
+  auto frames = evaluate_all_frames(keyboard);
+  ASSERT_EQ(frames.size(), keyboard.get_number_of_frames());
+
+  Keyboard seeking_keyboard = test_keyboard(wave, Spectrum::Algorithm::fft);
+  for (Keyboard::FrameIndex frame_index : {13, 7, 0, 24}) {
+    ASSERT_TRUE(seeking_keyboard.go_to_frame(frame_index));
+    EXPECT_EQ(*seeking_keyboard.get_keyboard(), frames[frame_index]);
+  }
+  EXPECT_FALSE(seeking_keyboard.go_to_frame(frames.size()));
+}
+
+TEST(test_Keyboard, algorithms) {
+  double tolerance = 1e-9;
+  WAVE wave = test_wave();
+  // The FFT is compared with the direct evaluation in test_FFT, and the
+  // centered algorithm evaluates other frequencies (see below).
+  Keyboard fft_keyboard = test_keyboard(wave, Spectrum::Algorithm::fft);
+  auto expected = evaluate_all_frames(fft_keyboard);
+  for (const std::string &name : Spectrum::get_algorithm_names()) {
+    if (name == "direct" || name == "centered") {
+      continue;
+    }
+    Keyboard keyboard =
+        test_keyboard(wave, Spectrum::name_to_algorithm(name));
+    auto frames = evaluate_all_frames(keyboard);
+    ASSERT_EQ(frames.size(), expected.size()) << name;
+    for (std::size_t frame = 0; frame != frames.size(); ++frame) {
+      for (std::size_t key = 0; key != 88; ++key) {
+        EXPECT_NEAR(frames[frame][key], expected[frame][key], tolerance)
+            << name << ", frame " << frame << ", key " << key;
+      }
+    }
+  }
+}
+
+TEST(test_Keyboard, centered) {
+  // tones at the centers of some keys and some noise
+  unsigned sample_rate = 4000;
+  std::vector<unsigned> tone_keys{12, 30, 48, 60};
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-0.05, 0.05);
+  auto signal = std::make_shared<std::vector<double>>();
+  for (unsigned index = 0; index != sample_rate; ++index) {
+    double time = 1. * index / sample_rate;
+    double sample = distribution(generator);
+    for (unsigned key : tone_keys) {
+      sample += 0.2 * std::sin(2. * M_PI *
+                               KeyboardFrequencies::key_to_frequency(key) *
+                               time);
+    }
+    signal->push_back(sample);
+  }
+  WAVE wave({signal}, sample_rate);
+  auto frames = [&](Spectrum::Algorithm algorithm) {
+    std::vector<unsigned> channels;
+    Keyboard keyboard({Spectrum(wave, channels, 25, {0, 40}, 2000, algorithm),
+                       Spectrum(wave, channels, 25, {40, 88}, 500, algorithm)});
+    return evaluate_all_frames(keyboard);
+  };
+  auto expected = frames(Spectrum::Algorithm::goertzel);
+  auto centered = frames(Spectrum::Algorithm::centered);
+
+  // Both find the same tones in each frame. The two analyses sample the main
+  // lobe of a tone at different frequencies, so the tones are compared via
+  // the strongest keys.
+  ASSERT_EQ(centered.size(), expected.size());
+  auto strongest_keys = [&](const Keyboard::Vector &keyboard) {
+    std::vector<unsigned> keys(88);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::partial_sort(
+        keys.begin(), keys.begin() + tone_keys.size(), keys.end(),
+        [&](unsigned left, unsigned right) {
+          return keyboard[left] > keyboard[right];
+        });
+    keys.resize(tone_keys.size());
+    std::sort(keys.begin(), keys.end());
+    return keys;
+  };
+  for (std::size_t frame = 0; frame != centered.size(); ++frame) {
+    EXPECT_EQ(strongest_keys(expected[frame]), tone_keys) << "frame " << frame;
+    EXPECT_EQ(strongest_keys(centered[frame]), tone_keys) << "frame " << frame;
+    for (unsigned key = 75; key != 88; ++key) {
+      EXPECT_EQ(centered[frame][key], 0.) << "frame " << frame;
+    }
+  }
+
+  // Between the tones, the noise floors agree.
+  for (auto key_range : {std::make_pair(16u, 27u), std::make_pair(33u, 45u),
+                         std::make_pair(63u, 74u)}) {
+    double expected_sum = 0.;
+    double centered_sum = 0.;
+    for (std::size_t frame = 0; frame != centered.size(); ++frame) {
+      for (unsigned key = key_range.first; key != key_range.second; ++key) {
+        expected_sum += expected[frame][key];
+        centered_sum += centered[frame][key];
+      }
+    }
+    EXPECT_NEAR(centered_sum / expected_sum, 1., 0.2)
+        << "keys " << key_range.first << " to " << key_range.second;
+  }
+}
+
+TEST(test_Keyboard, centered_detuned) {
+  // Single tones at the centers of keys, detuned towards their borders, in
+  // both sections. The key-centered frequencies are as dense as the bins, so
+  // the keys around a tone stay close to the weighted average of the bins
+  // wherever the tone is within its key.
+  unsigned sample_rate = 4000;
+  double amplitude = 0.2;
+  double tolerance = 0.25 * amplitude;
+  for (unsigned tone_key : {20, 30, 45, 60, 70}) {
+    for (double detune : {0., 0.125, 0.25, 0.375, 0.5}) {
+      double frequency =
+          KeyboardFrequencies::key_to_frequency(tone_key + detune);
+      auto signal = std::make_shared<std::vector<double>>();
+      for (unsigned index = 0; index != sample_rate; ++index) {
+        signal->push_back(amplitude * std::sin(2. * M_PI * frequency * index /
+                                               sample_rate));
+      }
+      WAVE wave({signal}, sample_rate);
+      auto frames = [&](Spectrum::Algorithm algorithm) {
+        std::vector<unsigned> channels;
+        Keyboard keyboard(
+            {Spectrum(wave, channels, 25, {0, 40}, 2000, algorithm),
+             Spectrum(wave, channels, 25, {40, 88}, 500, algorithm)});
+        return evaluate_all_frames(keyboard);
+      };
+      auto expected = frames(Spectrum::Algorithm::goertzel);
+      auto centered = frames(Spectrum::Algorithm::centered);
+      ASSERT_EQ(centered.size(), expected.size());
+
+      // frames whose audio frames are within the signal
+      for (std::size_t frame = 5; frame != 20; ++frame) {
+        for (unsigned key = tone_key - 1; key <= tone_key + 1; ++key) {
+          EXPECT_NEAR(centered[frame][key], expected[frame][key], tolerance)
+              << "tone " << tone_key << " + " << detune << ", frame " << frame
+              << ", key " << key;
+        }
+      }
+    }
+  }
+}
+
+TEST(test_Keyboard, parallel_keyboard) {
+  WAVE wave = test_wave();
+  Keyboard keyboard = test_keyboard(wave, Spectrum::Algorithm::fft);
+  Keyboard prototype = keyboard;
+  auto expected = evaluate_all_frames(keyboard);
+  for (unsigned number_of_threads : {1, 3, 8}) {
+    ParallelKeyboard parallel_keyboard(prototype, number_of_threads, 4, 8);
+    EXPECT_EQ(evaluate_all_frames(parallel_keyboard), expected)
+        << number_of_threads << " threads";
+  }
+}
+
+TEST(test_Keyboard, streaming) {
+  WAVE wave = test_wave();
+  for (const std::string &name : {"fft", "sliding", "goertzel", "batched"}) {
+    Spectrum::Algorithm algorithm = Spectrum::name_to_algorithm(name);
+    Keyboard keyboard = test_keyboard(wave, algorithm);
+    auto expected = evaluate_all_frames(keyboard);
+
+    Keyboard streaming_keyboard = test_streaming_keyboard(wave, algorithm);
+    EXPECT_EQ(evaluate_all_frames(streaming_keyboard), expected) << name;
+  }
+}
+
+TEST(test_Keyboard, task_pool) {
+  WAVE wave = test_wave();
+  auto pool = std::make_shared<TaskPool>(3);
+  for (const std::string &name : {"fft", "sliding", "goertzel", "batched"}) {
+    Spectrum::Algorithm algorithm = Spectrum::name_to_algorithm(name);
+    Keyboard keyboard = test_keyboard(wave, algorithm);
+    Keyboard seeking_keyboard = keyboard;
+    Keyboard pooled_seeking_keyboard = keyboard;
+    auto expected = evaluate_all_frames(keyboard);
+
+    Keyboard streaming_keyboard = test_streaming_keyboard(wave, algorithm);
+    streaming_keyboard.set_task_pool(pool);
+    EXPECT_EQ(evaluate_all_frames(streaming_keyboard), expected) << name;
+
+    // The sliding DFTs depend on the previously evaluated frames.
+    pooled_seeking_keyboard.set_task_pool(pool);
+    for (Keyboard::FrameIndex frame_index : {13, 7, 0, 24}) {
+      ASSERT_TRUE(seeking_keyboard.go_to_frame(frame_index));
+      ASSERT_TRUE(pooled_seeking_keyboard.go_to_frame(frame_index));
+      EXPECT_EQ(*pooled_seeking_keyboard.get_keyboard(),
+                *seeking_keyboard.get_keyboard())
+          << name;
+    }
+    EXPECT_FALSE(pooled_seeking_keyboard.go_to_frame(expected.size()));
+  }
+}
+
+TEST(test_Keyboard, allocations) {
+  WAVE wave = test_wave();
+  auto pool = std::make_shared<TaskPool>(3);
+  for (const std::string &name : {"fft", "sliding", "goertzel", "batched"}) {
+    Spectrum::Algorithm algorithm = Spectrum::name_to_algorithm(name);
+    Keyboard keyboard = test_keyboard(wave, algorithm);
+    Keyboard pooled_keyboard = keyboard;
+    pooled_keyboard.set_task_pool(pool);
+    Keyboard streaming_keyboard = test_streaming_keyboard(wave, algorithm);
+
+    // The audio frames of the first 2000 samples section are clipped up to
+    // the frame 5 and from the frame 19 on, which changes their sizes.
+    for (Keyboard *current : {&keyboard, &pooled_keyboard,
+                              &streaming_keyboard}) {
+      for (unsigned frame = 0; frame != 8; ++frame) {
+        ASSERT_TRUE(current->go_to_next_frame());
+      }
+      std::size_t allocations_before = number_of_allocations;
+      for (unsigned frame = 8; frame != 18; ++frame) {
+        ASSERT_TRUE(current->go_to_next_frame());
+      }
+      EXPECT_EQ(number_of_allocations - allocations_before, 0u) << name;
+    }
+  }
+}
@@ -0,0 +1,131 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_KeyboardBroadcast.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "KeyboardBroadcast.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+/**
+ * Keyboard source whose keys contain the index of the video frame. It throws
+ * at the video frame throwing_frame if that is nonzero.
+ */
+class CountingKeyboard : public KeyboardSource {
+public:
+  explicit CountingKeyboard(unsigned number_of_frames,
+                            unsigned throwing_frame = 0)
+      : number_of_frames(number_of_frames), throwing_frame(throwing_frame),
+        keyboard(std::make_shared<Vector>(88)) {
+    evaluate();
+  }
+
+  std::shared_ptr<Vector> get_keyboard() const override { return keyboard; }
+
+  bool go_to_next_frame() override {
+    if (frame + 1 == number_of_frames) {
+      return false;
+    }
+    ++frame;
+    if (frame == throwing_frame) {
+      throw std::runtime_error("keyboard source failed");
+    }
+    evaluate();
+    return true;
+  }
+
+private:
+  unsigned number_of_frames;
+  unsigned throwing_frame;
+  unsigned frame{};
+  std::shared_ptr<Vector> keyboard;
+
+  void evaluate() {
+    for (unsigned key = 0; key != keyboard->size(); ++key) {
+      (*keyboard)[key] = frame + key / 100.;
+    }
+  }
+};
+
+std::vector<KeyboardSource::Vector>
+evaluate_all_frames(KeyboardSource &keyboard) {
+  std::vector<KeyboardSource::Vector> frames;
+  do {
+    frames.push_back(*keyboard.get_keyboard());
+  } while (keyboard.go_to_next_frame());
+  return frames;
+}
+} // namespace
+
+TEST(test_KeyboardBroadcast, subscribers) {
+  CountingKeyboard keyboard(50);
+  auto expected = evaluate_all_frames(keyboard);
+  unsigned number_of_subscribers = 3;
+  KeyboardBroadcast broadcast(std::make_shared<CountingKeyboard>(50),
+                              number_of_subscribers, 2);
+  std::vector<std::vector<KeyboardSource::Vector>> frames(
+      number_of_subscribers);
+  std::vector<std::thread> threads;
+  for (unsigned subscriber = 0; subscriber != number_of_subscribers;
+       ++subscriber) {
+    threads.emplace_back([&, subscriber] {
+      frames[subscriber] =
+          evaluate_all_frames(*broadcast.get_subscriber(subscriber));
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (unsigned subscriber = 0; subscriber != number_of_subscribers;
+       ++subscriber) {
+    EXPECT_EQ(frames[subscriber], expected) << "subscriber " << subscriber;
+  }
+}
+
+TEST(test_KeyboardBroadcast, unsubscribe) {
+  // A subscriber that has been destroyed doesn't hold back the others.
+  KeyboardBroadcast broadcast(std::make_shared<CountingKeyboard>(10), 2, 2);
+  broadcast.get_subscriber(0);
+  auto subscriber = broadcast.get_subscriber(1);
+  EXPECT_EQ(evaluate_all_frames(*subscriber).size(), 10);
+}
+
+TEST(test_KeyboardBroadcast, exception) {
+  // The exception of the source reaches every subscriber.
+  KeyboardBroadcast broadcast(std::make_shared<CountingKeyboard>(10, 4), 2);
+  auto first_subscriber = broadcast.get_subscriber(0);
+  auto second_subscriber = broadcast.get_subscriber(1);
+  for (unsigned frame = 1; frame != 4; ++frame) {
+    ASSERT_TRUE(first_subscriber->go_to_next_frame());
+  }
+  EXPECT_THROW(first_subscriber->go_to_next_frame(), std::runtime_error);
+  EXPECT_THROW(second_subscriber->go_to_next_frame(), std::runtime_error);
+}
+
+TEST(test_KeyboardBroadcast, invalid_arguments) {
+  auto source = std::make_shared<CountingKeyboard>(10);
+  EXPECT_THROW(KeyboardBroadcast(source, 0), std::invalid_argument);
+  EXPECT_THROW(KeyboardBroadcast(source, 1, 0), std::invalid_argument);
+  KeyboardBroadcast broadcast(source, 1);
+  EXPECT_THROW(broadcast.get_subscriber(1), std::out_of_range);
+}
@@ -0,0 +1,84 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_KeyboardGeometry.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "KeyboardGeometry.h"
+#include <gtest/gtest.h>
+
+static_assert(KeyboardGeometry::count_white_keys_below(88) == 52);
+static_assert(KeyboardGeometry::get_key_column(0) == 24);
+static_assert(KeyboardGeometry::get_key_column(1) == 51);
+static_assert(KeyboardGeometry::get_key_column(4) == 123);
+static_assert(KeyboardGeometry::get_key_column(87) == 1860);
+
+TEST(test_KeyboardGeometry, key_runs) {
+  using Geometry = KeyboardGeometry;
+  Geometry geometry;
+  const auto &runs = geometry.get_key_runs();
+  ASSERT_EQ(geometry.get_first_run(Geometry::number_of_keys), runs.size());
+
+  // A0# (black): the key row and the rows above the bottom edge
+  auto first_run = geometry.get_first_run(1);
+  ASSERT_EQ(geometry.get_first_run(2) - first_run, 1 + 976 - 822);
+  for (auto run = first_run; run != geometry.get_first_run(2); ++run) {
+    EXPECT_EQ(runs[run].column, 55);
+    EXPECT_EQ(runs[run].length, 10);
+    EXPECT_EQ(runs[run].role, 1);
+  }
+
+  // C8 (white, no black neighbours): the key row and the rows below the
+  // separator
+  first_run = geometry.get_first_run(87);
+  ASSERT_EQ(geometry.get_first_run(88) - first_run, 1 + 1056 - 822);
+  for (auto run = first_run; run != geometry.get_first_run(88); ++run) {
+    EXPECT_EQ(runs[run].column, 1862);
+    EXPECT_EQ(runs[run].length, 32);
+  }
+
+  // A0 (white): the black key A0# covers the right side of its upper part
+  EXPECT_EQ(runs[geometry.get_first_run(0)].length, 25);
+}
+
+TEST(test_KeyboardGeometry, coverage) {
+  using Geometry = KeyboardGeometry;
+  Geometry geometry;
+  std::vector<int> pixels(Geometry::frame_width * Geometry::frame_height);
+  for (const auto *runs : {&geometry.get_key_runs(),
+                           &geometry.get_static_runs()}) {
+    for (const auto &run : *runs) {
+      for (unsigned column = run.column; column != run.column + run.length;
+           ++column) {
+        ++pixels[run.row * Geometry::frame_width + column];
+      }
+    }
+  }
+  // The runs don't overlap, and the keyboard and the separator are covered
+  // completely except the edges of the white keys in the key row.
+  unsigned covered = 0;
+  for (int pixel : pixels) {
+    ASSERT_LE(pixel, 1);
+    covered += pixel;
+  }
+  unsigned width = Geometry::frame_width - 2 * Geometry::border;
+  unsigned key_row = width - 52 * 4 + 36 * 4;
+  EXPECT_EQ(covered, Geometry::frame_width * 12 + key_row + width * 234);
+}
@@ -0,0 +1,145 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_MultirateSignal.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "MultirateSignal.h"
+#include "WAVE.h"
+#include <cmath>
+#include <gtest/gtest.h>
+
+namespace {
+/**
+ * Amplitude of the frequency `frequency` within a signal, evaluated via the
+ * discrete Fourier transform of an integer number of periods.
+ */
+double amplitude(const std::vector<double> &signal, double frequency,
+                 double sample_rate, std::size_t first, std::size_t size) {
+  double real_part = 0.;
+  double imaginary_part = 0.;
+  for (std::size_t index = first; index != first + size; ++index) {
+    double phase = 2. * M_PI * frequency * index / sample_rate;
+    real_part += signal[index] * std::cos(phase);
+    imaginary_part += signal[index] * std::sin(phase);
+  }
+  return 2. * std::hypot(real_part, imaginary_part) / size;
+}
+
+std::vector<double> sine(double frequency, double sample_rate,
+                         std::size_t size) {
+  std::vector<double> signal;
+  for (std::size_t index = 0; index != size; ++index) {
+    signal.push_back(std::sin(2. * M_PI * frequency * index / sample_rate));
+  }
+  return signal;
+}
+} // namespace
+
+TEST(test_MultirateSignal, half_band_filter) {
+  double sample_rate = 8000.;
+  std::size_t size = 8000;
+
+  // passband: amplitude and phase are preserved
+  double passband_frequency = 1500.;
+  auto signal = sine(passband_frequency, sample_rate, size);
+  auto decimated = MultirateSignal::decimate(signal);
+  ASSERT_EQ(decimated.size(), size / 2);
+  EXPECT_NEAR(amplitude(decimated, passband_frequency, sample_rate / 2, 1000,
+                        2000),
+              1., 1e-4);
+  for (std::size_t index = 100; index != 3900; ++index) {
+    EXPECT_NEAR(decimated[index], signal[2 * index], 1e-4);
+  }
+
+  // stopband: the aliased frequency is attenuated by more than 80 dB
+  double stopband_frequency = 2500.;
+  decimated =
+      MultirateSignal::decimate(sine(stopband_frequency, sample_rate, size));
+  EXPECT_LT(amplitude(decimated, sample_rate / 2 - stopband_frequency,
+                      sample_rate / 2, 1000, 2000),
+            1e-4);
+}
+
+TEST(test_MultirateSignal, find_level) {
+  unsigned sample_rate = 44100;
+  auto channel = std::make_shared<std::vector<double>>(
+      sine(100., sample_rate, sample_rate));
+  auto wave = std::make_shared<WAVE>(
+      std::vector<std::shared_ptr<std::vector<double>>>{channel, channel},
+      sample_rate);
+  MultirateSignal multirate_signal(wave, 25);
+
+  // 44100 Hz -> 22050 Hz -> 11025 Hz, and 5512.5 Hz isn't available.
+  EXPECT_EQ(multirate_signal.find_level({0, 11}), 2);
+  EXPECT_EQ(multirate_signal.get_source(2)->get_sample_rate(), 11025);
+  EXPECT_EQ(multirate_signal.get_source(2)->get_number_of_channels(), 2);
+  EXPECT_EQ(multirate_signal.get_source(2)->get_number_of_samples(), 11025);
+
+  // The key 87 (4186 Hz) still fits into the passband of 11025 Hz (4410 Hz).
+  EXPECT_EQ(multirate_signal.find_level({81, 88}), 2);
+
+  // 22050 Hz isn't a multiple of 36 frames per second.
+  MultirateSignal unaligned_signal(wave, 36);
+  EXPECT_EQ(unaligned_signal.find_level({0, 11}), 0);
+  EXPECT_THROW(MultirateSignal(wave, 32), std::invalid_argument);
+}
+
+TEST(test_MultirateSignal, streaming) {
+  unsigned sample_rate = 8000;
+  auto left = std::make_shared<std::vector<double>>(
+      sine(440., sample_rate, 5 * sample_rate));
+  auto right = std::make_shared<std::vector<double>>(
+      sine(3000., sample_rate, 5 * sample_rate));
+  auto wave = std::make_shared<WAVE>(
+      std::vector<std::shared_ptr<std::vector<double>>>{left, right},
+      sample_rate);
+  MultirateSignal decoded_signal(wave, 25);
+  std::size_t window = 1000;
+  std::size_t hop = 320;
+  MultirateSignal streamed_signal(wave, 25, window + hop);
+  ASSERT_EQ(decoded_signal.find_level({0, 30}), 4);
+  ASSERT_EQ(streamed_signal.find_level({0, 30}), 4);
+
+  // The windows of all levels move forward together, like the audio frames of
+  // the keyboard sections.
+  for (std::size_t center = 0; center < 5 * sample_rate; center += hop) {
+    for (unsigned level = 0; level != 5; ++level) {
+      auto decoded = decoded_signal.get_source(level);
+      auto streamed = streamed_signal.get_source(level);
+      std::size_t half_window = window / 2 >> level;
+      std::size_t level_center = center >> level;
+      MultirateSignal::VectorRange time_range(
+          level_center > half_window ? level_center - half_window : 0,
+          std::min(level_center + half_window,
+                   decoded->get_number_of_samples()));
+      for (std::size_t channel = 0; channel != 2; ++channel) {
+        const double *expected = decoded->get_samples(channel, time_range);
+        const double *result = streamed->get_samples(channel, time_range);
+        for (std::size_t index = 0;
+             index != time_range.second - time_range.first; ++index) {
+          ASSERT_EQ(result[index], expected[index])
+              << "level " << level << ", time index "
+              << time_range.first + index;
+        }
+      }
+    }
+  }
+}
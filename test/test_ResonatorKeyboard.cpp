@@ -0,0 +1,245 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_ResonatorKeyboard.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "AudioStream.h"
+#include "Keyboard.h"
+#include "KeyboardFrequencies.h"
+#include "MultirateSignal.h"
+#include "ResonatorKeyboard.h"
+#include "WAVE.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+namespace {
+const std::vector<unsigned> tone_keys{12, 30, 48, 60};
+
+/**
+ * Two seconds of a stereo signal with tones at the centers of some keys and
+ * some noise, followed by some zeros.
+ */
+WAVE test_wave(unsigned sample_rate = 4000, unsigned number_of_zeros = 0) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-0.05, 0.05);
+  auto left = std::make_shared<std::vector<double>>();
+  auto right = std::make_shared<std::vector<double>>();
+  for (unsigned index = 0; index != 2 * sample_rate; ++index) {
+    double time = 1. * index / sample_rate;
+    double sample = 0.;
+    for (unsigned key : tone_keys) {
+      sample += 0.2 * std::sin(2. * M_PI *
+                               KeyboardFrequencies::key_to_frequency(key) *
+                               time);
+    }
+    left->push_back(sample + distribution(generator));
+    right->push_back(sample + distribution(generator));
+  }
+  left->resize(left->size() + number_of_zeros);
+  right->resize(right->size() + number_of_zeros);
+  return WAVE({left, right}, sample_rate);
+}
+
+const std::vector<ResonatorKeyboard::Section> test_sections{{{0, 40}, 2000},
+                                                            {{40, 88}, 500}};
+
+std::vector<KeyboardSource::Vector>
+evaluate_all_frames(KeyboardSource &keyboard) {
+  std::vector<KeyboardSource::Vector> frames;
+  do {
+    frames.push_back(*keyboard.get_keyboard());
+  } while (keyboard.go_to_next_frame());
+  return frames;
+}
+
+Keyboard test_keyboard(std::shared_ptr<AudioSource> source,
+                       Spectrum::Algorithm algorithm) {
+  std::vector<Spectrum> spectra;
+  for (const auto &section : test_sections) {
+    spectra.emplace_back(source, std::vector<unsigned>(), 25, section.first,
+                         section.second, algorithm);
+  }
+  return Keyboard(spectra);
+}
+
+std::vector<unsigned> strongest_keys(const KeyboardSource::Vector &keyboard) {
+  std::vector<unsigned> keys(88);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::partial_sort(keys.begin(), keys.begin() + tone_keys.size(), keys.end(),
+                    [&](unsigned left, unsigned right) {
+                      return keyboard[left] > keyboard[right];
+                    });
+  keys.resize(tone_keys.size());
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+} // namespace
+
+TEST(test_ResonatorKeyboard, tones) {
+  auto wave = std::make_shared<WAVE>(test_wave());
+  ResonatorKeyboard keyboard(wave, {}, 25, test_sections);
+  auto frames = evaluate_all_frames(keyboard);
+  ASSERT_EQ(frames.size(), keyboard.get_number_of_frames());
+  ASSERT_EQ(frames.size(), 50);
+
+  // After the resonators of the longest audio frame have settled (time
+  // constant of 1000 samples), and before they get sampled after the end of
+  // the signal (frame 44), the keys of the tones have the amplitudes of the
+  // tones.
+  for (std::size_t frame = 20; frame != 44; ++frame) {
+    EXPECT_EQ(strongest_keys(frames[frame]), tone_keys) << "frame " << frame;
+    for (unsigned key : tone_keys) {
+      EXPECT_NEAR(frames[frame][key], 0.2, 0.01)
+          << "frame " << frame << ", key " << key;
+    }
+    // keys at or above the Nyquist frequency
+    for (unsigned key = 75; key != 88; ++key) {
+      EXPECT_EQ(frames[frame][key], 0.) << "frame " << frame;
+    }
+  }
+}
+
+TEST(test_ResonatorKeyboard, spectrum) {
+  auto wave = std::make_shared<WAVE>(test_wave());
+  ResonatorKeyboard resonator_keyboard(wave, {}, 25, test_sections);
+  auto resonators = evaluate_all_frames(resonator_keyboard);
+  Keyboard keyboard = test_keyboard(wave, Spectrum::Algorithm::centered);
+  auto expected = evaluate_all_frames(keyboard);
+  ASSERT_EQ(resonators.size(), expected.size());
+
+  // The tones and the floors between them agree with the centered evaluation
+  // of the bands. The response of a resonator decays like the envelope of the
+  // response of a rectangular window, so the tones leak more into the floor,
+  // but by less than 40 %.
+  for (std::size_t frame = 0; frame != resonators.size(); ++frame) {
+    EXPECT_EQ(strongest_keys(resonators[frame]),
+              strongest_keys(expected[frame]))
+        << "frame " << frame;
+  }
+  for (auto key_range : {std::make_pair(16u, 27u), std::make_pair(33u, 45u),
+                         std::make_pair(63u, 74u)}) {
+    double expected_sum = 0.;
+    double resonator_sum = 0.;
+    for (std::size_t frame = 0; frame != resonators.size(); ++frame) {
+      for (unsigned key = key_range.first; key != key_range.second; ++key) {
+        expected_sum += expected[frame][key];
+        resonator_sum += resonators[frame][key];
+      }
+    }
+    EXPECT_GE(resonator_sum / expected_sum, 1.)
+        << "keys " << key_range.first << " to " << key_range.second;
+    EXPECT_LE(resonator_sum / expected_sum, 1.4)
+        << "keys " << key_range.first << " to " << key_range.second;
+  }
+}
+
+TEST(test_ResonatorKeyboard, streaming) {
+  auto wave = std::make_shared<WAVE>(test_wave());
+  ResonatorKeyboard keyboard(wave, {1}, 25, test_sections);
+  auto expected = evaluate_all_frames(keyboard);
+
+  // The samples are read once in chunks of one video frame.
+  auto stream = std::make_shared<AudioStream>(wave, 160);
+  ResonatorKeyboard streaming_keyboard(stream, {1}, 25, test_sections);
+  EXPECT_EQ(evaluate_all_frames(streaming_keyboard), expected);
+}
+
+TEST(test_ResonatorKeyboard, end_of_signal) {
+  auto wave = std::make_shared<WAVE>(test_wave());
+  ResonatorKeyboard keyboard(wave, {}, 25, test_sections);
+  auto frames = evaluate_all_frames(keyboard);
+
+  // The final frames get sampled after the end of the signal (by up to 920
+  // samples), where the resonators decay as if the signal was followed by
+  // zeros.
+  auto padded_wave = std::make_shared<WAVE>(test_wave(4000, 1000));
+  ResonatorKeyboard padded_keyboard(padded_wave, {}, 25, test_sections);
+  auto padded_frames = evaluate_all_frames(padded_keyboard);
+  ASSERT_GT(padded_frames.size(), frames.size());
+  for (std::size_t frame = 0; frame != frames.size(); ++frame) {
+    for (unsigned key = 0; key != 88; ++key) {
+      EXPECT_NEAR(frames[frame][key], padded_frames[frame][key], 1e-9)
+          << "frame " << frame << ", key " << key;
+    }
+  }
+  EXPECT_LT(frames.back()[tone_keys.front()], 0.15);
+}
+
+TEST(test_ResonatorKeyboard, invalid_arguments) {
+  auto wave = std::make_shared<WAVE>(test_wave());
+  EXPECT_THROW(ResonatorKeyboard(wave, {}, 30, test_sections),
+               std::invalid_argument);
+  EXPECT_THROW(ResonatorKeyboard(wave, {2}, 25, test_sections),
+               std::invalid_argument);
+  EXPECT_THROW(ResonatorKeyboard(wave, {1, 1}, 25, test_sections),
+               std::invalid_argument);
+  EXPECT_THROW(ResonatorKeyboard(wave, {}, 25, {{{0, 40}, 0}, {{39, 88}, 0}}),
+               std::invalid_argument);
+  EXPECT_THROW(ResonatorKeyboard(wave, {}, 25, {{{40, 40}, 0}}),
+               std::invalid_argument);
+}
+
+// A benchmark rather than a test, which only runs on request, e.g. via
+// test_ResonatorKeyboard --gtest_also_run_disabled_tests.
+TEST(test_ResonatorKeyboard, DISABLED_throughput) {
+  // The sections of the application at 48 kHz. The resonators cost O(88) per
+  // sample, the bands cost an evaluation of each audio frame per video frame,
+  // which the decimation of the low sections makes cheaper.
+  auto wave = std::make_shared<WAVE>(test_wave(48000));
+  std::vector<ResonatorKeyboard::Section> sections{
+      {{0, 11}, 67000}, {{11, 22}, 44000}, {{22, 33}, 29000},
+      {{33, 46}, 15500}, {{46, 56}, 8500}, {{56, 74}, 5000},
+      {{74, 81}, 2500}, {{81, 88}, 1900}};
+  auto measure = [](KeyboardSource &keyboard) {
+    auto start = std::chrono::steady_clock::now();
+    std::size_t number_of_frames = evaluate_all_frames(keyboard).size();
+    std::chrono::duration<double> duration =
+        std::chrono::steady_clock::now() - start;
+    return number_of_frames / duration.count();
+  };
+
+  ResonatorKeyboard resonator_keyboard(wave, {}, 30, sections);
+  std::cout << "resonators: " << measure(resonator_keyboard)
+            << " frames per second" << std::endl;
+  for (const std::string &name : {"goertzel", "centered", "fft"}) {
+    for (bool decimation : {false, true}) {
+      // as in OvertoneApp::OvertoneApp()
+      MultirateSignal multirate_signal(wave, 30);
+      std::vector<Spectrum> spectra;
+      for (const auto &section : sections) {
+        unsigned level =
+            decimation ? multirate_signal.find_level(section.first) : 0;
+        spectra.emplace_back(multirate_signal.get_source(level),
+                             std::vector<unsigned>(), 30, section.first,
+                             section.second >> level,
+                             Spectrum::name_to_algorithm(name));
+      }
+      Keyboard keyboard(spectra);
+      std::cout << name << (decimation ? " with decimation: " : ": ")
+                << measure(keyboard) << " frames per second" << std::endl;
+    }
+  }
+}
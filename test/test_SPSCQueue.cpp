@@ -0,0 +1,86 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_SPSCQueue.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "SPSCQueue.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(test_SPSCQueue, order) {
+  const unsigned number_of_items = 10000;
+  SPSCQueue<std::vector<unsigned>> queue(
+      std::vector<std::vector<unsigned>>(3, std::vector<unsigned>(2)));
+  std::thread producer([&] {
+    for (unsigned item = 0; item != number_of_items; ++item) {
+      std::vector<unsigned> *slot = queue.get_free_slot();
+      // The consumer stops as well if the producer fails.
+      EXPECT_NE(slot, nullptr);
+      if (slot == nullptr) {
+        queue.cancel();
+        return;
+      }
+      (*slot)[0] = item;
+      (*slot)[1] = 2 * item;
+      queue.push();
+    }
+    queue.close();
+  });
+  unsigned expected = 0;
+  while (const std::vector<unsigned> *item = queue.front()) {
+    EXPECT_EQ((*item)[0], expected);
+    EXPECT_EQ((*item)[1], 2 * expected);
+    queue.pop();
+    ++expected;
+  }
+  producer.join();
+  EXPECT_EQ(expected, number_of_items);
+  EXPECT_GE(queue.get_mean_depth(), 1.);
+  EXPECT_LE(queue.get_mean_depth(), 3.);
+}
+
+TEST(test_SPSCQueue, cancel) {
+  SPSCQueue<int> queue(std::vector<int>(2));
+  *queue.get_free_slot() = 1;
+  queue.push();
+  *queue.get_free_slot() = 2;
+  queue.push();
+  // The producer waits for a free slot until the consumer cancels.
+  std::thread consumer([&] {
+    EXPECT_EQ(*queue.front(), 1);
+    queue.cancel();
+  });
+  EXPECT_EQ(queue.get_free_slot(), nullptr);
+  consumer.join();
+  EXPECT_EQ(queue.front(), nullptr);
+}
+
+TEST(test_SPSCQueue, close) {
+  SPSCQueue<int> queue(std::vector<int>(4));
+  *queue.get_free_slot() = 7;
+  queue.push();
+  queue.close();
+  ASSERT_NE(queue.front(), nullptr);
+  EXPECT_EQ(*queue.front(), 7);
+  queue.pop();
+  EXPECT_EQ(queue.front(), nullptr);
+  EXPECT_THROW(SPSCQueue<int>(std::vector<int>()), std::invalid_argument);
+}
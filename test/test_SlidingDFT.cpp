@@ -0,0 +1,69 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_SlidingDFT.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "SlidingDFT.h"
+#include <gtest/gtest.h>
+#include <random>
+
+TEST(test_SlidingDFT, slide) {
+  using VectorSize = SlidingDFT::VectorSize;
+  using VectorRange = SlidingDFT::VectorRange;
+  double tolerance = 1e-10;
+  VectorSize size = 1000;
+  VectorSize hop = 96;
+  VectorRange frequency_range{3, 40};
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-1., 1.);
+  SlidingDFT::Vector channel;
+  for (VectorSize index = 0; index != size + 100 * hop; ++index) {
+    channel.push_back(distribution(generator));
+  }
+
+  FFT fft(size);
+  FFT::ComplexVector fourier_transform;
+  auto twiddles = SlidingDFT::evaluate_twiddles(size);
+  SlidingDFT sliding(size, frequency_range, twiddles);
+  SlidingDFT anchored(size, frequency_range, twiddles);
+
+  VectorRange time_range{0, size};
+  sliding.anchor(channel.data(), time_range, fft, fourier_transform);
+  for (unsigned frame = 0; frame != 100; ++frame) {
+    VectorRange next_time_range{time_range.first + hop,
+                                time_range.second + hop};
+    sliding.slide(channel.data() + time_range.first, time_range,
+                  next_time_range);
+    time_range = next_time_range;
+  }
+  anchored.anchor(channel.data() + time_range.first, time_range, fft,
+                  fourier_transform);
+
+  SlidingDFT::Vector result;
+  SlidingDFT::Vector expected;
+  sliding.evaluate_spectrum(result);
+  anchored.evaluate_spectrum(expected);
+  ASSERT_EQ(result.size(), frequency_range.second - frequency_range.first);
+  for (VectorSize index = 0; index != expected.size(); ++index) {
+    EXPECT_NEAR(result[index], expected[index], tolerance);
+  }
+}
@@ -0,0 +1,269 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_SpectrumKernels.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "SpectrumKernels.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+
+namespace {
+using Vector = SpectrumKernels::Vector;
+using VectorSize = SpectrumKernels::VectorSize;
+
+Vector random_signal(VectorSize size) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-1., 1.);
+  Vector signal;
+  for (VectorSize index = 0; index != size; ++index) {
+    signal.push_back(distribution(generator));
+  }
+  return signal;
+}
+
+double direct_spectrum(const Vector &signal, double frequency) {
+  double real_part = 0.;
+  double imaginary_part = 0.;
+  auto size = signal.size();
+  for (VectorSize time = 0; time != size; ++time) {
+    double phase = 2. * M_PI * frequency * time / size;
+    real_part += signal[time] * std::cos(phase);
+    imaginary_part += signal[time] * std::sin(phase);
+  }
+  return 2. * std::hypot(real_part, imaginary_part) / size;
+}
+} // namespace
+
+TEST(test_SpectrumKernels, goertzel) {
+  double tolerance = 1e-10;
+  VectorSize size = 5000;
+  auto signal = random_signal(size);
+
+  // 8 + 4 + 2 + 1 bins to cover all the block sizes
+  Vector frequencies;
+  for (VectorSize index = 0; index != 15; ++index) {
+    frequencies.push_back(10 + 7 * index);
+  }
+  auto coefficients =
+      SpectrumKernels::evaluate_goertzel_coefficients(frequencies, size);
+  Vector spectrum(frequencies.size());
+  SpectrumKernels::goertzel(signal.data(), size, coefficients.data(),
+                            frequencies.size(), spectrum.data());
+  for (VectorSize index = 0; index != frequencies.size(); ++index) {
+    EXPECT_NEAR(spectrum[index], direct_spectrum(signal, frequencies[index]),
+                tolerance);
+  }
+}
+
+TEST(test_SpectrumKernels, direct) {
+  double tolerance = 1e-10;
+  // several periods of the phasors and a partial one
+  VectorSize size = 5000;
+  auto signal = random_signal(size);
+
+  // 8 + 4 + 2 + 1 bins to cover all the block sizes
+  VectorSize first_bin = 1200;
+  Vector spectrum(15);
+  SpectrumKernels::direct(signal.data(), size, first_bin, spectrum.size(),
+                          spectrum.data());
+  for (VectorSize index = 0; index != spectrum.size(); ++index) {
+    EXPECT_NEAR(spectrum[index], direct_spectrum(signal, first_bin + index),
+                tolerance);
+  }
+}
+
+TEST(test_SpectrumKernels, magnitudes) {
+  // 4 + 3 values to cover the vectors and the remainder
+  Vector values = random_signal(14);
+  Vector magnitudes(7);
+  SpectrumKernels::magnitudes(values.data(), magnitudes.size(), 50,
+                              magnitudes.data());
+  for (VectorSize index = 0; index != magnitudes.size(); ++index) {
+    EXPECT_NEAR(magnitudes[index],
+                2. * std::hypot(values[2 * index], values[2 * index + 1]) / 50,
+                1e-15);
+  }
+}
+
+TEST(test_SpectrumKernels, dft_batch) {
+  double tolerance = 1e-10;
+  VectorSize size = 700;
+  VectorSize hop = 90;
+  VectorSize number_of_frames = 6;
+  auto signal = random_signal(size + (number_of_frames - 1) * hop);
+
+  // 4 + 1 rows and 4 + 1 + 1 frames to cover all the block sizes, and more
+  // samples than a cache block
+  Vector frequencies{3, 17.5, 40};
+  Vector basis = SpectrumKernels::evaluate_dft_basis(frequencies, size);
+  VectorSize number_of_rows = 5;
+  Vector dft(number_of_frames * number_of_rows);
+  SpectrumKernels::dft_batch(signal.data(), hop, number_of_frames,
+                             basis.data(), number_of_rows, size, dft.data());
+  for (VectorSize frame = 0; frame != number_of_frames; ++frame) {
+    Vector frame_signal(signal.begin() + frame * hop,
+                        signal.begin() + frame * hop + size);
+    const double *frame_dft = dft.data() + frame * number_of_rows;
+    for (VectorSize bin = 0; bin != 2; ++bin) {
+      EXPECT_NEAR(2. *
+                      std::hypot(frame_dft[2 * bin], frame_dft[2 * bin + 1]) /
+                      size,
+                  direct_spectrum(frame_signal, frequencies[bin]), tolerance)
+          << "frame " << frame << ", bin " << bin;
+    }
+    double cosine_sum = 0.;
+    for (VectorSize time = 0; time != size; ++time) {
+      cosine_sum += frame_signal[time] * basis[4 * size + time];
+    }
+    EXPECT_NEAR(frame_dft[4], cosine_sum, tolerance) << "frame " << frame;
+  }
+}
+
+TEST(test_SpectrumKernels, implementations) {
+  using Implementation = SpectrumKernels::Implementation;
+  double tolerance = 1e-12;
+  VectorSize size = 3000;
+  auto signal = random_signal(size);
+
+  // 37 bins cover the full blocks and the remainders of all implementations.
+  Vector frequencies;
+  for (VectorSize index = 0; index != 37; ++index) {
+    frequencies.push_back(5 + 3 * index);
+  }
+  auto coefficients =
+      SpectrumKernels::evaluate_goertzel_coefficients(frequencies, size);
+  std::vector<const double *> spectra{signal.data(), signal.data() + 1000,
+                                      signal.data() + 2000};
+  VectorSize first_bin = 20;
+
+  auto default_implementation = SpectrumKernels::get_implementation();
+  SpectrumKernels::set_implementation(Implementation::scalar);
+  Vector expected_spectrum(frequencies.size());
+  SpectrumKernels::goertzel(signal.data(), size, coefficients.data(),
+                            frequencies.size(), expected_spectrum.data());
+  Vector expected_direct(frequencies.size());
+  SpectrumKernels::direct(signal.data(), size, first_bin, frequencies.size(),
+                          expected_direct.data());
+  Vector expected_magnitudes(999);
+  SpectrumKernels::magnitudes(signal.data(), expected_magnitudes.size(), size,
+                              expected_magnitudes.data());
+  Vector expected_average(999);
+  SpectrumKernels::average(spectra.data(), spectra.size(),
+                           expected_average.size(), expected_average.data());
+  Vector basis = SpectrumKernels::evaluate_dft_basis(frequencies, 1000);
+  VectorSize number_of_rows = 2 * frequencies.size() - 1;
+  Vector expected_dft(7 * number_of_rows);
+  SpectrumKernels::dft_batch(signal.data(), 300, 7, basis.data(),
+                             number_of_rows, 1000, expected_dft.data());
+
+  for (Implementation implementation :
+       {Implementation::avx2, Implementation::avx512}) {
+    auto name = SpectrumKernels::implementation_to_name(implementation);
+    if (!SpectrumKernels::is_supported(implementation)) {
+      std::cout << "Skipping the unsupported implementation " << name
+                << std::endl;
+      continue;
+    }
+    SpectrumKernels::set_implementation(implementation);
+    EXPECT_EQ(SpectrumKernels::get_implementation(), implementation);
+
+    Vector spectrum(frequencies.size());
+    SpectrumKernels::goertzel(signal.data(), size, coefficients.data(),
+                              frequencies.size(), spectrum.data());
+    for (VectorSize index = 0; index != spectrum.size(); ++index) {
+      EXPECT_NEAR(spectrum[index], expected_spectrum[index], tolerance)
+          << name << ", bin " << index;
+    }
+
+    Vector direct(expected_direct.size());
+    SpectrumKernels::direct(signal.data(), size, first_bin,
+                            frequencies.size(), direct.data());
+    for (VectorSize index = 0; index != direct.size(); ++index) {
+      EXPECT_NEAR(direct[index], expected_direct[index], tolerance)
+          << name << ", bin " << index;
+    }
+
+    // The magnitudes are evaluated without FMAs, like the scalar ones.
+    Vector magnitudes(expected_magnitudes.size());
+    SpectrumKernels::magnitudes(signal.data(), magnitudes.size(), size,
+                                magnitudes.data());
+    for (VectorSize index = 0; index != magnitudes.size(); ++index) {
+      EXPECT_EQ(magnitudes[index], expected_magnitudes[index])
+          << name << ", index " << index;
+    }
+
+    Vector dft(expected_dft.size());
+    SpectrumKernels::dft_batch(signal.data(), 300, 7, basis.data(),
+                               number_of_rows, 1000, dft.data());
+    for (VectorSize index = 0; index != dft.size(); ++index) {
+      EXPECT_NEAR(dft[index], expected_dft[index], tolerance)
+          << name << ", index " << index;
+    }
+
+    Vector average(expected_average.size());
+    SpectrumKernels::average(spectra.data(), spectra.size(), average.size(),
+                             average.data());
+    for (VectorSize index = 0; index != average.size(); ++index) {
+      EXPECT_DOUBLE_EQ(average[index], expected_average[index])
+          << name << ", index " << index;
+    }
+  }
+  SpectrumKernels::set_implementation(default_implementation);
+}
+
+TEST(test_SpectrumKernels, concurrent_selection) {
+  using Implementation = SpectrumKernels::Implementation;
+  double tolerance = 1e-12;
+  VectorSize size = 3000;
+  auto signal = random_signal(size);
+  Vector frequencies{5, 17, 29, 41, 53, 65, 77, 89, 101, 113, 125};
+  auto coefficients =
+      SpectrumKernels::evaluate_goertzel_coefficients(frequencies, size);
+  Vector expected(frequencies.size());
+  SpectrumKernels::goertzel(signal.data(), size, coefficients.data(),
+                            frequencies.size(), expected.data());
+
+  // The implementation changes while another thread runs the kernels.
+  auto default_implementation = SpectrumKernels::get_implementation();
+  std::thread analysis([&] {
+    Vector spectrum(frequencies.size());
+    for (int repetition = 0; repetition != 200; ++repetition) {
+      SpectrumKernels::goertzel(signal.data(), size, coefficients.data(),
+                                frequencies.size(), spectrum.data());
+      for (VectorSize index = 0; index != spectrum.size(); ++index) {
+        EXPECT_NEAR(spectrum[index], expected[index], tolerance);
+      }
+    }
+  });
+  for (int repetition = 0; repetition != 200; ++repetition) {
+    for (Implementation implementation :
+         {Implementation::scalar, Implementation::avx2,
+          Implementation::avx512}) {
+      if (SpectrumKernels::is_supported(implementation)) {
+        SpectrumKernels::set_implementation(implementation);
+      }
+    }
+  }
+  analysis.join();
+  SpectrumKernels::set_implementation(default_implementation);
+}
@@ -0,0 +1,63 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_TaskPool.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "TaskPool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(test_TaskPool, run) {
+  for (unsigned number_of_threads : {1, 2, 5}) {
+    TaskPool pool(number_of_threads);
+    EXPECT_EQ(pool.get_number_of_threads(), number_of_threads);
+    // Every batch reuses the same threads.
+    for (std::size_t number_of_tasks : {0, 1, 3, 100}) {
+      std::vector<std::atomic<unsigned>> calls(number_of_tasks);
+      pool.run(number_of_tasks, [&](std::size_t task) { ++calls[task]; });
+      for (std::size_t task = 0; task != number_of_tasks; ++task) {
+        EXPECT_EQ(calls[task], 1u) << number_of_threads << " threads, task "
+                                   << task << " of " << number_of_tasks;
+      }
+    }
+  }
+  EXPECT_THROW(TaskPool(0), std::invalid_argument);
+}
+
+TEST(test_TaskPool, exception) {
+  TaskPool pool(3);
+  std::atomic<unsigned> number_of_calls{};
+  EXPECT_THROW(pool.run(20,
+                        [&](std::size_t task) {
+                          ++number_of_calls;
+                          if (task % 7 == 3) {
+                            throw std::runtime_error("task failed");
+                          }
+                        }),
+               std::runtime_error);
+  // The other tasks still run, and the pool remains usable.
+  EXPECT_EQ(number_of_calls, 20u);
+  number_of_calls = 0;
+  pool.run(20, [&](std::size_t) { ++number_of_calls; });
+  EXPECT_EQ(number_of_calls, 20u);
+}
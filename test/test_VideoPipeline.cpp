@@ -0,0 +1,232 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_VideoPipeline.cpp
+
+    Copyright (C) 2022 Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ParallelVideo.h"
+#include "VideoPipeline.h"
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+/**
+ * Keyboard source of a fixed sequence of keyboards.
+ */
+class TestKeyboard : public KeyboardSource {
+public:
+  explicit TestKeyboard(std::vector<Vector> keyboards)
+      : keyboards(std::move(keyboards)),
+        keyboard(std::make_shared<Vector>(this->keyboards[0])) {}
+
+  std::shared_ptr<Vector> get_keyboard() const override { return keyboard; }
+
+  bool go_to_next_frame() override {
+    if (frame + 1 == keyboards.size()) {
+      return false;
+    }
+    *keyboard = keyboards[++frame];
+    return true;
+  }
+
+private:
+  std::vector<Vector> keyboards;
+  std::size_t frame{};
+  std::shared_ptr<Vector> keyboard;
+};
+
+std::vector<KeyboardSource::Vector> test_keyboards(unsigned number_of_frames) {
+  std::vector<KeyboardSource::Vector> keyboards;
+  for (unsigned index = 0; index != number_of_frames; ++index) {
+    KeyboardSource::Vector keyboard(KeyboardGeometry::number_of_keys);
+    for (unsigned key = 0; key != keyboard.size(); ++key) {
+      // Some keys keep their colors for a few video frames.
+      keyboard[key] = ((index / (1 + key % 3) * 31 + key * 7) % 50) / 49.;
+    }
+    keyboards.push_back(keyboard);
+  }
+  return keyboards;
+}
+
+/**
+ * Creates an FFmpeg executable that stores the raw video frames in the video
+ * file instead of encoding them.
+ * @return path of the executable
+ */
+std::string create_encoder(const std::string &directory) {
+  std::string path = directory + "/ffmpeg";
+  std::ofstream(path) << "#!/bin/sh\n"
+                         "if [ \"$1\" = \"-version\" ]; then exit 0; fi\n"
+                         "for last; do :; done\n"
+                         "cat > \"$last\"\n";
+  chmod(path.c_str(), 0755);
+  return path;
+}
+
+std::string read_file(const std::string &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  std::string content(file.tellg(), '\0');
+  file.seekg(0);
+  file.read(&content[0], content.size());
+  return content;
+}
+} // namespace
+
+TEST(test_VideoPipeline, sequential_frames) {
+  char directory_template[] = "/tmp/test_VideoPipeline.XXXXXX";
+  std::string directory = mkdtemp(directory_template);
+  std::string ffmpeg_path = create_encoder(directory);
+  std::string input_path = directory + "/input.wav";
+  unsigned number_of_frames = 12;
+  auto keyboards = test_keyboards(number_of_frames);
+
+  for (unsigned history_speed : {1u, 13u, 400u, 786u}) {
+    // reference: VideoFrame renders and writes each video frame in turn
+    std::string expected_path = directory + "/expected.mp4";
+    {
+      FFmpeg ffmpeg(input_path, expected_path, ffmpeg_path, 25);
+      VideoEncoder encoder(ffmpeg, KeyboardGeometry::frame_width,
+                           KeyboardGeometry::frame_height);
+      VideoFrame video_frame(1., 0., "fire", history_speed);
+      for (const auto &keyboard : keyboards) {
+        video_frame.render(keyboard);
+        video_frame.write(encoder);
+      }
+      encoder.finish();
+    }
+
+    // Small queues let the slots get reused several times.
+    for (unsigned frame_queue_size : {1u, 3u}) {
+      std::string path = directory + "/pipeline.mp4";
+      FFmpeg ffmpeg(input_path, path, ffmpeg_path, 25);
+      auto encoder = std::make_shared<VideoEncoder>(
+          ffmpeg, KeyboardGeometry::frame_width,
+          KeyboardGeometry::frame_height);
+      VideoPipeline pipeline(
+          std::make_shared<TestKeyboard>(keyboards),
+          std::make_shared<VideoFrame>(1., 0., "fire", history_speed),
+          encoder, 2, frame_queue_size);
+      VideoPipeline::FrameIndex number_of_written_frames = 0;
+      pipeline.run([&](VideoPipeline::FrameIndex frame) {
+        number_of_written_frames = frame;
+      });
+      encoder->finish();
+      EXPECT_EQ(number_of_written_frames, number_of_frames);
+
+      std::string frames = read_file(path);
+      std::string expected = read_file(expected_path);
+      EXPECT_EQ(frames.size(), 3ul * KeyboardGeometry::frame_width *
+                                   KeyboardGeometry::frame_height *
+                                   number_of_frames);
+      EXPECT_TRUE(frames == expected)
+          << "history speed " << history_speed << ", frame queue size "
+          << frame_queue_size;
+      std::remove(path.c_str());
+    }
+    std::remove(expected_path.c_str());
+  }
+  std::remove(ffmpeg_path.c_str());
+  std::remove(directory.c_str());
+}
+
+TEST(test_VideoPipeline, exception) {
+  // Thrown by the analysis, the exception reaches the caller of run().
+  class FailingKeyboard : public TestKeyboard {
+  public:
+    using TestKeyboard::TestKeyboard;
+    bool go_to_next_frame() override {
+      throw std::runtime_error("analysis failed");
+    }
+  };
+
+  char directory_template[] = "/tmp/test_VideoPipeline.XXXXXX";
+  std::string directory = mkdtemp(directory_template);
+  std::string ffmpeg_path = create_encoder(directory);
+  std::string path = directory + "/video.mp4";
+  FFmpeg ffmpeg(directory + "/input.wav", path, ffmpeg_path, 25);
+  auto encoder = std::make_shared<VideoEncoder>(
+      ffmpeg, KeyboardGeometry::frame_width, KeyboardGeometry::frame_height);
+  VideoPipeline pipeline(std::make_shared<FailingKeyboard>(test_keyboards(1)),
+                         std::make_shared<VideoFrame>(1., 0., "fire", 10),
+                         encoder);
+  EXPECT_THROW(pipeline.run([](VideoPipeline::FrameIndex) {}),
+               std::runtime_error);
+  encoder->finish();
+  std::remove(path.c_str());
+  std::remove(ffmpeg_path.c_str());
+  std::remove(directory.c_str());
+}
+
+TEST(test_VideoPipeline, statistics) {
+  char directory_template[] = "/tmp/test_VideoPipeline.XXXXXX";
+  std::string directory = mkdtemp(directory_template);
+  std::string ffmpeg_path = create_encoder(directory);
+  std::string path = directory + "/video.mp4";
+  unsigned number_of_frames = 12;
+  auto keyboards = test_keyboards(number_of_frames);
+  auto check = [](const VideoStatistics &statistics) {
+    EXPECT_GT(statistics.wall_clock_time.count(), 0);
+    for (const auto &stage : statistics.stages) {
+      EXPECT_GE(stage.busy_time.count(), 0);
+      EXPECT_GE(stage.waiting_time.count(), 0);
+    }
+    for (const auto &queue :
+         {statistics.keyboard_queue, statistics.frame_queue}) {
+      EXPECT_GE(queue.mean_depth, 1.);
+      EXPECT_LE(queue.mean_depth, queue.capacity);
+    }
+  };
+
+  // Both ways of rendering a video report the same kind of statistics.
+  {
+    FFmpeg ffmpeg(directory + "/input.wav", path, ffmpeg_path, 25);
+    auto encoder = std::make_shared<VideoEncoder>(
+        ffmpeg, KeyboardGeometry::frame_width, KeyboardGeometry::frame_height);
+    VideoPipeline pipeline(std::make_shared<TestKeyboard>(keyboards),
+                           std::make_shared<VideoFrame>(1., 0., "fire", 10),
+                           encoder);
+    pipeline.run([](VideoPipeline::FrameIndex) {});
+    encoder->finish();
+    check(pipeline.get_statistics());
+    EXPECT_EQ(pipeline.get_statistics().keyboard_queue.capacity, 16);
+  }
+  {
+    FFmpeg ffmpeg(directory + "/input.wav", path, ffmpeg_path, 25);
+    auto encoder = std::make_shared<VideoEncoder>(
+        ffmpeg, KeyboardGeometry::frame_width, KeyboardGeometry::frame_height);
+    ParallelVideo video(std::make_shared<TestKeyboard>(keyboards),
+                        std::make_shared<FrameRenderer>(1., 0., "fire", 10),
+                        encoder, 3);
+    video.run([](ParallelVideo::FrameIndex) {});
+    encoder->finish();
+    const VideoStatistics &statistics = video.get_statistics();
+    check(statistics);
+    EXPECT_EQ(statistics.frame_queue.capacity, 3);
+    // The encoder either writes or waits.
+    const auto &encoding = statistics.stages[VideoStatistics::encoding];
+    EXPECT_EQ(encoding.busy_time + encoding.waiting_time,
+              statistics.wall_clock_time);
+  }
+  std::remove(path.c_str());
+  std::remove(ffmpeg_path.c_str());
+  std::remove(directory.c_str());
+}
@@ -0,0 +1,120 @@
+/******************************************************************************
+
+    Overtone: A Music Visualizer
+
+    test_WAVE.cpp
+
+    Copyright (C) 2022  Stefan Lepperdinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "WAVE.h"
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace {
+void append(std::string &bytes, uint32_t value, unsigned number_of_bytes) {
+  for (unsigned index = 0; index != number_of_bytes; ++index) {
+    bytes.push_back(static_cast<char>(value >> (8 * index) & 0xff));
+  }
+}
+
+/**
+ * Writes a WAVE file with an unknown chunk of an odd size in front of the
+ * format chunk and returns its path.
+ */
+std::string write_wave(const std::vector<int16_t> &samples,
+                       uint16_t number_of_channels, uint32_t data_size) {
+  std::string bytes = "RIFF";
+  append(bytes, 0, 4);
+  bytes += "WAVE";
+  bytes += "LIST";
+  append(bytes, 3, 4);
+  bytes += "abc";
+  bytes.push_back('\0');
+  bytes += "fmt ";
+  append(bytes, 16, 4);
+  append(bytes, 1, 2);
+  append(bytes, number_of_channels, 2);
+  append(bytes, 8000, 4);
+  append(bytes, 8000 * 2 * number_of_channels, 4);
+  append(bytes, 2 * number_of_channels, 2);
+  append(bytes, 16, 2);
+  bytes += "data";
+  append(bytes, data_size, 4);
+  for (int16_t sample : samples) {
+    append(bytes, static_cast<uint16_t>(sample), 2);
+  }
+
+  char path[] = "/tmp/test_WAVE.XXXXXX";
+  int file_descriptor = mkstemp(path);
+  close(file_descriptor);
+  std::ofstream file(path, std::ios::binary);
+  file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  return path;
+}
+} // namespace
+
+TEST(test_WAVE, decode) {
+  for (uint16_t number_of_channels : {1, 2, 3}) {
+    // more samples than a block, so the blocks and the remainder get tested
+    std::vector<int16_t> samples;
+    std::size_t number_of_frames = 10000;
+    for (std::size_t index = 0; index != number_of_frames * number_of_channels;
+         ++index) {
+      samples.push_back(static_cast<int16_t>(index * 7919 % 65536 - 32768));
+    }
+    std::string path =
+        write_wave(samples, number_of_channels, samples.size() * 2);
+    WAVE wave(path);
+    std::remove(path.c_str());
+
+    EXPECT_EQ(wave.get_sample_rate(), 8000);
+    auto signal = wave.get_signal();
+    ASSERT_EQ(signal.size(), number_of_channels);
+    for (uint16_t channel = 0; channel != number_of_channels; ++channel) {
+      ASSERT_EQ(signal[channel]->size(), number_of_frames);
+      for (std::size_t frame = 0; frame != number_of_frames; ++frame) {
+        ASSERT_EQ((*signal[channel])[frame],
+                  samples[frame * number_of_channels + channel] / 32768.);
+      }
+    }
+  }
+}
+
+TEST(test_WAVE, truncated_data_chunk) {
+  std::vector<int16_t> samples{1, 2, 3, 4, 5};
+  std::string path = write_wave(samples, 2, 0xffffffff);
+  WAVE wave(path);
+  std::remove(path.c_str());
+  auto signal = wave.get_signal();
+  ASSERT_EQ(signal.size(), 2);
+  EXPECT_EQ(*signal[0], std::vector<double>({1 / 32768., 3 / 32768.}));
+  EXPECT_EQ(*signal[1], std::vector<double>({2 / 32768., 4 / 32768.}));
+}
+
+TEST(test_WAVE, errors) {
+  EXPECT_THROW(WAVE("/nonexistent/file.wav"), std::runtime_error);
+
+  char path[] = "/tmp/test_WAVE.XXXXXX";
+  int file_descriptor = mkstemp(path);
+  close(file_descriptor);
+  std::ofstream(path) << "RIFF0000AVI ";
+  EXPECT_THROW(WAVE{std::string(path)}, WAVE::parsing_error);
+  std::remove(path);
+}